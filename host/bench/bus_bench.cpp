@@ -0,0 +1,229 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  I2C layer against the simulated bus: transaction counters, timing and
+  the clock policy of scd41.h, through the sensor task.
+
+  usage: bus_bench [--hours N] [--interval-ms N] [trace.csv]
+
+  Each scenario runs one sensor, or two behind the same mux, for --hours
+  (default 6) on the trace (default office_24h.csv), from
+  CONFIG_SENSOR_I2C_CLOCK_HZ with the Kconfig fallback window, error rate
+  and raise backoff. The sensors of a scenario share one scd41_clock_t,
+  as the sensors on a port do. The simulated wiring limits the clock some
+  scenarios can use: above the limit a share of the transactions fails,
+  writes NACKed and reads garbled into CRC errors.
+
+  khz is the bus clock at the end, fb its fallbacks and up its tries one
+  step up again; trans is what the driver counted for the first sensor
+  (wake_up left out), nack/crc its failures by kind. mean_us and max_us
+  are the time per transaction; the simulated bus takes each bit at the
+  clock, so they follow the rate. first_s is the first sample, alive
+  whether each sensor delivered within the last three intervals. A
+  scenario is ok when the clock, its fallbacks and the sensors that
+  deliver are the expected ones.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <scd4x_sensor.h>
+
+#include "host_clock.h"
+#include "scd41_sim.h"
+#include "trace.h"
+
+#define HOUR_US (3600 * 1000000LL)
+
+// a mux with one sensor absent is the most a scenario needs
+#define BUS_SENSORS_MAX 2
+
+typedef struct {
+    const char *name;
+    uint8_t sensors;
+    scd41_sim_faults_t faults[BUS_SENSORS_MAX];
+    // expected at the end
+    uint32_t expect_khz;
+    bool expect_fallback;
+    // bit per sensor delivering
+    uint8_t expect_alive;
+} bus_scenario_t;
+
+typedef struct {
+    uint32_t samples;
+    int64_t first_us;
+    int64_t last_us;
+} bus_run_t;
+
+typedef struct {
+    scd41_sim_t *sims;
+    size_t count;
+} bus_sims_t;
+
+static bus_run_t s_runs[BUS_SENSORS_MAX];
+
+// The task's callback fires for all sensors, the measurement says whose it is
+static void sensor_notification(void *user_data)
+{
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        if (measurement.sensor >= BUS_SENSORS_MAX) {
+            continue;
+        }
+        bus_run_t *run = &s_runs[measurement.sensor];
+        if (run->samples++ == 0) {
+            run->first_us = esp_timer_get_time();
+        }
+        run->last_us = esp_timer_get_time();
+    }
+}
+
+// The clock is the bus's: every sensor on it sees the new rate
+static esp_err_t bus_set_clock(void *ctx, uint32_t hz)
+{
+    bus_sims_t *bus = (bus_sims_t *) ctx;
+    for (size_t i = 0; i < bus->count; i++) {
+        esp_err_t err = scd41_sim_set_clock(&bus->sims[i], hz);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static bool run_scenario(const bus_scenario_t *scenario, const trace_t *trace, uint32_t hours, uint32_t interval_ms)
+{
+    host_clock_reset();
+    size_t count = scenario->sensors;
+    scd41_sim_t sims[BUS_SENSORS_MAX];
+    scd41_t devs[BUS_SENSORS_MAX];
+    scd4x_sensor_config_t configs[BUS_SENSORS_MAX];
+    bus_sims_t bus_sims = { sims, count };
+    for (size_t i = 0; i < count; i++) {
+        scd41_sim_init(&sims[i], trace, 0x5cd41 + (uint32_t)i);
+        scd41_sim_bind(&sims[i], &devs[i]);
+        scd41_sim_set_faults(&sims[i], &scenario->faults[i]);
+    }
+    scd41_clock_t clock;
+    scd41_clock_config_t clock_config;
+    scd41_clock_config_default(&clock_config);
+    ESP_ERROR_CHECK(scd41_clock_init(&clock, &clock_config, bus_set_clock, &bus_sims));
+    memset(s_runs, 0, sizeof(s_runs));
+    for (size_t i = 0; i < count; i++) {
+        scd41_clock_attach(&devs[i], &clock);
+        configs[i] = {};
+        configs[i].dev = &devs[i];
+        configs[i].cb = sensor_notification;
+        configs[i].slot = (uint8_t)i;
+        configs[i].interval_ms = interval_ms;
+    }
+    ESP_ERROR_CHECK(sensor_task_init(configs, count));
+    int64_t end_us = (int64_t)hours * HOUR_US;
+    for (int64_t t = 0; t < end_us;) {
+        t = t + HOUR_US < end_us ? t + HOUR_US : end_us;
+        host_timer_run_until(t);
+    }
+    scd41_bus_stats_t bus;
+    sensor_task_get_bus_stats(0, &bus);
+    sensor_task_deinit();
+
+    uint8_t alive = 0;
+    char alive_text[BUS_SENSORS_MAX + 1] = {};
+    for (size_t i = 0; i < count; i++) {
+        bool delivers = s_runs[i].samples && end_us - s_runs[i].last_us <= 3LL * interval_ms * 1000;
+        alive |= (uint8_t)(delivers << i);
+        alive_text[i] = delivers ? 'y' : 'n';
+    }
+    bool ok = bus.clock_hz == scenario->expect_khz * 1000 && (bus.clock_fallbacks != 0) == scenario->expect_fallback &&
+              alive == scenario->expect_alive;
+    const bus_run_t *run = &s_runs[0];
+    printf("%-16s %6lu %3lu %3lu %8lu %6lu %6lu %6lu %8.1f %7lu %8lu %8.1f %6s %6s\n", scenario->name,
+           (unsigned long)(bus.clock_hz / 1000), (unsigned long)bus.clock_fallbacks,
+           (unsigned long)bus.clock_raises, (unsigned long)bus.transactions, (unsigned long)bus.nacks,
+           (unsigned long)bus.crc_errors, (unsigned long)(bus.timeouts + bus.other_errors),
+           bus.transactions ? (double)bus.busy_us / bus.transactions : 0.0, (unsigned long)bus.max_us,
+           (unsigned long)run->samples, run->samples ? run->first_us / 1e6 : -1.0, alive_text, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hours = 6;
+    uint32_t interval_ms = 10000;
+    std::string path = HOST_TRACE_DIR "/office_24h.csv";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            hours = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            interval_ms = (uint32_t)atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (hours < 3) {
+        fprintf(stderr, "--hours takes at least 3\n");
+        return 1;
+    }
+    trace_t trace;
+    if (!trace_load(path.c_str(), &trace)) {
+        fprintf(stderr, "cannot load trace %s\n", path.c_str());
+        return 1;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    const uint32_t start_khz = CONFIG_SENSOR_I2C_CLOCK_HZ / 1000;
+    bus_scenario_t scenarios[] = {
+        { "clean", 1, {}, start_khz, false, 0x1 },
+        // 1 % of the reads, a tenth of the fallback rate
+        { "crc_noise", 1, {}, start_khz, false, 0x1 },
+        // 20 % of the transactions fail above 200 kHz: down once, the tries up fall back again
+        { "marginal_200k", 1, {}, 200, true, 0x1 },
+        // nothing gets through above 100 kHz: the silent sensor answers at the lowest clock, which climbs to 100 kHz
+        { "slow_wiring", 1, {}, 100, true, 0x1 },
+        // unplugged for an hour after working: health backs off, the clock stays
+        { "unplugged", 1, {}, start_khz, false, 0x1 },
+        // plugged in an hour after boot: silent at the lowest clock too, the start rate comes back, then it delivers
+        { "absent_at_boot", 1, {}, start_khz, false, 0x1 },
+        // a second mux channel never populated: the first sensor keeps the clock
+        { "mux_one_absent", 2, {}, start_khz, false, 0x1 },
+        // both sensors behind the mux on marginal wiring: one clock for both, both deliver
+        { "mux_marginal", 2, {}, 200, true, 0x3 },
+    };
+    scenarios[1].faults[0].crc_error_ppm = 10000;
+    scenarios[2].faults[0].clock_limit_hz = 200000;
+    scenarios[2].faults[0].over_limit_error_ppm = 200000;
+    scenarios[3].faults[0].clock_limit_hz = 100000;
+    scenarios[3].faults[0].over_limit_error_ppm = 1000000;
+    scenarios[4].faults[0].absent_from_us = HOUR_US;
+    scenarios[4].faults[0].absent_until_us = 2 * HOUR_US;
+    scenarios[5].faults[0].absent_until_us = HOUR_US;
+    scenarios[6].faults[1].absent_until_us = INT64_MAX;
+    for (size_t i = 0; i < 2; i++) {
+        scenarios[7].faults[i].clock_limit_hz = 200000;
+        scenarios[7].faults[i].over_limit_error_ppm = 200000;
+    }
+
+    printf("%s, %u h at %lu ms, start %lu kHz, fallback below %u kHz after %u transactions over %u %%, "
+           "up after %u clean\n", trace.name.c_str(), hours, (unsigned long)interval_ms, (unsigned long)start_khz,
+           CONFIG_SENSOR_I2C_MIN_CLOCK_HZ / 1000, CONFIG_SENSOR_I2C_FALLBACK_WINDOW,
+           CONFIG_SENSOR_I2C_FALLBACK_ERROR_PCT, CONFIG_SENSOR_I2C_RAISE_AFTER);
+    printf("%-16s %6s %3s %3s %8s %6s %6s %6s %8s %7s %8s %8s %6s %6s\n", "scenario", "khz", "fb", "up", "trans",
+           "nack", "crc", "other", "mean_us", "max_us", "samples", "first_s", "alive", "result");
+    bool ok = true;
+    for (const bus_scenario_t &scenario : scenarios) {
+        ok &= run_scenario(&scenario, &trace, hours, interval_ms);
+    }
+    return ok ? 0 : 1;
+}
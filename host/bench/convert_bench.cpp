@@ -0,0 +1,175 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Raw SCD4x ticks to Matter units: float path against the integer path,
+  and the bitwise CRC-8 against the table driven one.
+
+  usage: convert_bench [rounds]
+
+  Accuracy runs over every possible tick value and compares both paths
+  with the exact result in double precision. max_err is in Matter units
+  (0.01 °C, 0.01 %), off is the number of ticks not rounded to the
+  nearest unit. Timing is host time per conversion; the host has an FPU,
+  so the float path is far cheaper here than as soft-float on the
+  ESP32-C6/H2.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#include <scd41.h>
+
+#define TICKS 65536
+
+// The conversion as it was: float °C / %, then x100 and truncated
+static int16_t float_centi_celsius(uint16_t t_raw)
+{
+    float temp, humidity;
+    scd41_ticks_to_float(t_raw, 0, &temp, &humidity);
+    return static_cast<int16_t>(temp * 100);
+}
+
+static uint16_t float_centi_percent(uint16_t rh_raw)
+{
+    float temp, humidity;
+    scd41_ticks_to_float(0, rh_raw, &temp, &humidity);
+    return static_cast<uint16_t>(humidity * 100);
+}
+
+static int32_t fixed_centi_celsius(uint16_t t_raw)
+{
+    return scd41_ticks_to_centi_celsius(t_raw);
+}
+
+static int32_t fixed_centi_percent(uint16_t rh_raw)
+{
+    return scd41_ticks_to_centi_percent(rh_raw);
+}
+
+static int32_t float_celsius_i32(uint16_t t_raw)
+{
+    return float_centi_celsius(t_raw);
+}
+
+static int32_t float_percent_i32(uint16_t rh_raw)
+{
+    return float_centi_percent(rh_raw);
+}
+
+static double exact_centi_celsius(uint16_t t_raw)
+{
+    return (-45.0 + 175.0 * t_raw / 65536.0) * 100.0;
+}
+
+static double exact_centi_percent(uint16_t rh_raw)
+{
+    return 100.0 * rh_raw / 65536.0 * 100.0;
+}
+
+// Original bitwise CRC-8 for comparison
+static uint8_t crc8_bitwise(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+typedef struct {
+    double ns;
+    double cycles;
+} op_cost_t;
+
+static volatile uint32_t s_sink;
+
+template <typename F>
+static op_cost_t measure(F op, int rounds)
+{
+    auto start = std::chrono::steady_clock::now();
+#if HAVE_RDTSC
+    uint64_t tsc = __rdtsc();
+#endif
+    uint32_t acc = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t i = 0; i < TICKS; i++) {
+            // each input depends on the previous result, so calls cannot be vectorised or overlapped
+            acc += (uint32_t)op((uint16_t)(i ^ r ^ (acc & 1)));
+        }
+    }
+#if HAVE_RDTSC
+    uint64_t cycles = __rdtsc() - tsc;
+#else
+    uint64_t cycles = 0;
+#endif
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    s_sink = acc;
+
+    double ops = (double)rounds * TICKS;
+    return { std::chrono::duration<double, std::nano>(elapsed).count() / ops, cycles / ops };
+}
+
+static void report(const char *name, const char *path, int32_t (*convert)(uint16_t), double (*exact)(uint16_t),
+                   int rounds)
+{
+    double max_err = 0;
+    uint32_t off = 0;
+    for (uint32_t i = 0; i < TICKS; i++) {
+        double want = exact((uint16_t)i);
+        double err = fabs(convert((uint16_t)i) - want);
+        max_err = fmax(max_err, err);
+        if (err > 0.5 + 1e-9) {
+            off++;
+        }
+    }
+    op_cost_t cost = measure(convert, rounds);
+    printf("%-12s %-8s %8.3f %7u %8.2f %9.1f\n", name, path, max_err, off, cost.ns, cost.cycles);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+
+    printf("%-12s %-8s %8s %7s %8s %9s\n", "conversion", "path", "max_err", "off", "ns/op", "cycles/op");
+    report("temperature", "float", float_celsius_i32, exact_centi_celsius, rounds);
+    report("temperature", "fixed", fixed_centi_celsius, exact_centi_celsius, rounds);
+    report("humidity", "float", float_percent_i32, exact_centi_percent, rounds);
+    report("humidity", "fixed", fixed_centi_percent, exact_centi_percent, rounds);
+
+    // one response word: two data bytes
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < TICKS; i++) {
+        uint8_t word[2] = { (uint8_t)(i >> 8), (uint8_t)i };
+        mismatches += crc8_bitwise(word, 2) != scd41_crc8(word, 2);
+    }
+    op_cost_t bitwise = measure([](uint16_t w) {
+        uint8_t word[2] = { (uint8_t)(w >> 8), (uint8_t)w };
+        return (int32_t)crc8_bitwise(word, 2);
+    }, rounds);
+    op_cost_t table = measure([](uint16_t w) {
+        uint8_t word[2] = { (uint8_t)(w >> 8), (uint8_t)w };
+        return (int32_t)scd41_crc8(word, 2);
+    }, rounds);
+    uint8_t beef[2] = { 0xbe, 0xef };
+    printf("%-12s %-8s %8s %7u %8.2f %9.1f\n", "crc8", "bitwise", "-", 0u, bitwise.ns, bitwise.cycles);
+    printf("%-12s %-8s %8s %7u %8.2f %9.1f\n", "crc8", "table", "-", mismatches, table.ns, table.cycles);
+    printf("crc8(0xbeef) = 0x%02x (datasheet: 0x92)\n", scd41_crc8(beef, 2));
+    return mismatches == 0 && scd41_crc8(beef, 2) == 0x92 ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Size and round trip of delta OTA patches (ota_delta.h).
+
+  usage: delta_bench [old.bin new.bin ...]
+
+  For each pair of images, a patch is created and applied with the device
+  applier, fed once byte by byte and once in 1024 byte BDX blocks; both
+  must rebuild the new image exactly. The patch must also be refused
+  against a different old image, when cut short, and with a byte changed.
+  Any of these going wrong fails the run.
+
+  Without arguments the pairs are made from this executable: unchanged, a
+  few constants changed, code inserted and removed (everything after it
+  moves), and unrelated content, the worst case.
+
+  pct is the patch size in percent of the new image, copy_B, add_B and
+  data_B how many new image bytes came from COPY, ADD and DATA. diff_ms and
+  apply_ms are host times, for comparing changes only.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ota_delta.h>
+
+#include "ota_delta_diff.h"
+
+#define BDX_BLOCK_SIZE  1024
+
+typedef struct {
+    std::string name;
+    std::vector<uint8_t> old_image;
+    std::vector<uint8_t> new_image;
+} image_pair_t;
+
+static bool read_file(const char *path, std::vector<uint8_t> *data)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    data->clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static std::vector<image_pair_t> self_pairs(const std::vector<uint8_t> &base)
+{
+    std::vector<image_pair_t> pairs;
+    uint32_t seed = 0xde17a;
+    pairs.push_back({ "unchanged", base, base });
+
+    // a few constants or literal addresses
+    image_pair_t constants = { "constants", base, base };
+    for (int i = 0; i < 8; i++) {
+        size_t at = next_random(&seed) % (base.size() - 4);
+        for (int k = 0; k < 4; k++) {
+            constants.new_image[at + k] ^= (uint8_t)next_random(&seed);
+        }
+    }
+    pairs.push_back(constants);
+
+    // a function added at a third, another removed at two thirds
+    image_pair_t moved = { "insert+remove", base, {} };
+    size_t insert_at = base.size() / 3, remove_at = base.size() * 2 / 3;
+    moved.new_image.assign(base.begin(), base.begin() + insert_at);
+    moved.new_image.insert(moved.new_image.end(), base.begin() + base.size() / 2,
+                           base.begin() + base.size() / 2 + 1536);
+    moved.new_image.insert(moved.new_image.end(), base.begin() + insert_at, base.begin() + remove_at);
+    moved.new_image.insert(moved.new_image.end(), base.begin() + remove_at + 700, base.end());
+    pairs.push_back(moved);
+
+    image_pair_t unrelated = { "unrelated", base, base };
+    for (uint8_t &b : unrelated.new_image) {
+        b ^= (uint8_t)next_random(&seed);
+    }
+    pairs.push_back(unrelated);
+    return pairs;
+}
+
+static bool run_pair(const image_pair_t &pair)
+{
+    auto start = std::chrono::steady_clock::now();
+    ota_delta_diff_stats_t stats;
+    std::vector<uint8_t> patch = ota_delta_diff(pair.old_image, pair.new_image, &stats);
+    auto diffed = std::chrono::steady_clock::now();
+    std::vector<uint8_t> rebuilt;
+    bool ok = ota_delta_apply_image(pair.old_image, patch, BDX_BLOCK_SIZE, &rebuilt) == ESP_OK &&
+              rebuilt == pair.new_image;
+    auto applied = std::chrono::steady_clock::now();
+    ok &= ota_delta_apply_image(pair.old_image, patch, 1, &rebuilt) == ESP_OK && rebuilt == pair.new_image;
+
+    // refused: another old image, a cut patch, a changed byte
+    std::vector<uint8_t> other_old = pair.old_image;
+    other_old[other_old.size() / 2] ^= 0x01;
+    ok &= ota_delta_apply_image(other_old, patch, BDX_BLOCK_SIZE, &rebuilt) == ESP_ERR_INVALID_STATE;
+    if (patch.size() > OTA_DELTA_HEADER_SIZE) {
+        std::vector<uint8_t> cut(patch.begin(), patch.end() - 1);
+        ok &= ota_delta_apply_image(pair.old_image, cut, BDX_BLOCK_SIZE, &rebuilt) != ESP_OK;
+        std::vector<uint8_t> changed = patch;
+        changed[OTA_DELTA_HEADER_SIZE + (patch.size() - OTA_DELTA_HEADER_SIZE) / 2] ^= 0x10;
+        ok &= ota_delta_apply_image(pair.old_image, changed, BDX_BLOCK_SIZE, &rebuilt) != ESP_OK;
+    }
+
+    double diff_ms = std::chrono::duration<double, std::milli>(diffed - start).count();
+    double apply_ms = std::chrono::duration<double, std::milli>(applied - diffed).count();
+    printf("%-22s %9zu %9zu %8zu %6.2f %9u %7u %8u %8.1f %8.1f %4s\n", pair.name.c_str(), pair.old_image.size(),
+           pair.new_image.size(), patch.size(), 100.0 * patch.size() / pair.new_image.size(), stats.copied,
+           stats.added, stats.data, diff_ms, apply_ms, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<image_pair_t> pairs;
+    if (argc > 1) {
+        if (argc % 2 == 0) {
+            fprintf(stderr, "usage: delta_bench [old.bin new.bin ...]\n");
+            return 1;
+        }
+        for (int i = 1; i < argc; i += 2) {
+            image_pair_t pair;
+            const char *name = strrchr(argv[i + 1], '/');
+            pair.name = name ? name + 1 : argv[i + 1];
+            if (!read_file(argv[i], &pair.old_image) || !read_file(argv[i + 1], &pair.new_image)) {
+                return 1;
+            }
+            pairs.push_back(pair);
+        }
+    } else {
+        std::vector<uint8_t> base;
+        if (!read_file("/proc/self/exe", &base)) {
+            return 1;
+        }
+        pairs = self_pairs(base);
+    }
+
+    printf("applier state %zu bytes\n", sizeof(ota_delta_t));
+    printf("%-22s %9s %9s %8s %6s %9s %7s %8s %8s %8s %4s\n", "pair", "old_B", "new_B", "patch_B", "pct", "copy_B",
+           "add_B", "data_B", "diff_ms", "apply_ms", "");
+    bool ok = true;
+    for (const image_pair_t &pair : pairs) {
+        ok &= run_pair(pair);
+    }
+    return ok ? 0 : 1;
+}
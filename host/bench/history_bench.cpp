@@ -0,0 +1,304 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Compression and speed of the sensor_history.h codec on replayed traces.
+
+  usage: history_bench [--interval-ms N] [--rounds N] [--flash-kb N] [trace.csv ...]
+
+  Each trace runs through the simulated SCD41 and the sensor task as in
+  replay_bench. Every drained sample is stored twice: as the device does,
+  after the filter ("filtered"), and as read ("raw"), which shows what the
+  sensor noise costs.
+
+  B/smp is data bytes per sample, blk_B/smp the same with the block
+  headers and the unused block tails, ratio is 10 raw bytes (time, CO2,
+  temperature, humidity) over blk_B/smp. The blocks go to a RAM model of
+  a --flash-kb NOR partition (default 64) that only clears bits on write;
+  writes/d and erases/d are its page programs and sector erases per day,
+  days how long the partition holds at this rate. Every sample is decoded
+  back and compared, a mismatch fails the run.
+
+  enc_ns and dec_ns are host time per sample over --rounds (default 50)
+  encodes and decodes of the same samples, for comparing changes only.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <scd4x_sensor.h>
+#include <sensor_history.h>
+#include <sensor_pipeline.h>
+
+#include "host_clock.h"
+#include "scd41_sim.h"
+#include "trace.h"
+
+#define RAW_SAMPLE_BYTES    10
+#define SECTOR_SIZE         4096
+
+typedef struct {
+    sensor_pipeline_t pipeline;
+    std::vector<sensor_history_sample_t> filtered;
+    std::vector<sensor_history_sample_t> raw;
+} bench_run_t;
+
+// NOR flash: erase sets every bit, a program can only clear them
+typedef struct {
+    std::vector<uint8_t> bytes;
+    bool violation;
+} nor_flash_t;
+
+static esp_err_t nor_read(uint32_t index, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    nor_flash_t *flash = (nor_flash_t *)ctx;
+    memcpy(block, &flash->bytes[index * SENSOR_HISTORY_BLOCK_SIZE], SENSOR_HISTORY_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t nor_erase(uint32_t sector, void *ctx)
+{
+    nor_flash_t *flash = (nor_flash_t *)ctx;
+    memset(&flash->bytes[sector * SECTOR_SIZE], 0xff, SECTOR_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t nor_write(uint32_t index, const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    nor_flash_t *flash = (nor_flash_t *)ctx;
+    uint8_t *page = &flash->bytes[index * SENSOR_HISTORY_BLOCK_SIZE];
+    for (size_t i = 0; i < SENSOR_HISTORY_BLOCK_SIZE; i++) {
+        if ((page[i] & block[i]) != block[i]) {
+            flash->violation = true;
+        }
+        page[i] &= block[i];
+    }
+    return ESP_OK;
+}
+
+static sensor_history_store_t nor_store(nor_flash_t *flash, size_t kb)
+{
+    // an unused partition is anything but erased
+    flash->bytes.assign(kb * 1024, 0x5a);
+    flash->violation = false;
+    sensor_history_store_t store = {
+        .blocks = (uint32_t)(kb * 1024 / SENSOR_HISTORY_BLOCK_SIZE),
+        .blocks_per_sector = SECTOR_SIZE / SENSOR_HISTORY_BLOCK_SIZE,
+        .read = nor_read,
+        .erase = nor_erase,
+        .write = nor_write,
+        .ctx = flash,
+    };
+    return store;
+}
+
+static sensor_history_sample_t to_sample(const sensor_measurement_t *measurement)
+{
+    return { (uint32_t)(esp_timer_get_time() / 1000000), measurement->co2, measurement->temperature,
+             measurement->humidity };
+}
+
+// No data model here, the pipeline commits to nothing
+static void write_nothing(sensor_attr_t attr, const sensor_measurement_t *measurement, bool force_report, void *ctx)
+{
+}
+
+// sensor_notification() in app_main.cpp. The history of the pipeline is off, report() replays
+// the collected samples into it with each kind in turn.
+static void sensor_notification(void *user_data)
+{
+    bench_run_t *run = (bench_run_t *) user_data;
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        run->raw.push_back(to_sample(&measurement));
+        sensor_pipeline_apply(&run->pipeline, &measurement, esp_timer_get_time());
+        run->filtered.push_back(to_sample(&measurement));
+    }
+}
+
+static void add_all(const std::vector<sensor_history_sample_t> &samples)
+{
+    for (const sensor_history_sample_t &sample : samples) {
+        sensor_measurement_t measurement = {};
+        measurement.co2 = sample.co2;
+        measurement.temperature = sample.temperature;
+        measurement.humidity = sample.humidity;
+        sensor_history_add(0, &measurement, sample.time_s);
+    }
+}
+
+static void collect(const sensor_history_sample_t *sample, void *ctx)
+{
+    ((std::vector<sensor_history_sample_t> *)ctx)->push_back(*sample);
+}
+
+// What "matter esp history" prints: the sealed blocks, oldest first, then the open one
+static void decode_all(std::vector<sensor_history_sample_t> *out, bool open)
+{
+    uint8_t block[SENSOR_HISTORY_BLOCK_SIZE];
+    sensor_history_block_info_t info;
+    uint32_t first, next;
+    sensor_history_range(&first, &next);
+    for (uint32_t seq = first; seq < next; seq++) {
+        if (sensor_history_copy_block(seq, block)) {
+            sensor_history_decode(block, &info, collect, out);
+        }
+    }
+    if (open && sensor_history_copy_open(0, block)) {
+        sensor_history_decode(block, &info, collect, out);
+    }
+}
+
+static bool same(const sensor_history_sample_t &a, const sensor_history_sample_t &b)
+{
+    return a.time_s == b.time_s && a.co2 == b.co2 && a.temperature == b.temperature && a.humidity == b.humidity;
+}
+
+static bool report(const char *trace, const char *kind, const std::vector<sensor_history_sample_t> &samples,
+                   size_t flash_kb, int rounds, double hours)
+{
+    // through the flash model once for the sizes, the wear and the round trip
+    nor_flash_t flash;
+    sensor_history_store_t store = nor_store(&flash, flash_kb);
+    sensor_history_init(&store);
+    add_all(samples);
+    sensor_history_stats_t stats;
+    sensor_history_get_stats(&stats);
+
+    std::vector<sensor_history_sample_t> decoded, sealed;
+    decode_all(&decoded, true);
+    decode_all(&sealed, false);
+    // the partition only keeps the newest blocks, compare the tail
+    bool ok = !flash.violation && stats.write_errors == 0 && decoded.size() <= samples.size();
+    size_t offset = ok ? samples.size() - decoded.size() : 0;
+    for (size_t i = 0; ok && i < decoded.size(); i++) {
+        ok = same(decoded[i], samples[offset + i]);
+    }
+    // after a reset the sealed blocks are all still there, the open one is lost
+    sensor_history_init(&store);
+    std::vector<sensor_history_sample_t> reread;
+    decode_all(&reread, true);
+    ok &= reread.size() == sealed.size();
+
+    // decode what the partition holds, then encode without a store
+    auto start = std::chrono::steady_clock::now();
+    size_t decoded_count = 0;
+    for (int r = 0; r < rounds; r++) {
+        std::vector<sensor_history_sample_t> out;
+        out.reserve(samples.size());
+        decode_all(&out, true);
+        decoded_count += out.size();
+    }
+    auto decoded_end = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        sensor_history_init(NULL);
+        add_all(samples);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double enc_ns = std::chrono::duration<double, std::nano>(end - decoded_end).count() / (rounds * samples.size());
+    double dec_ns = decoded_count ? std::chrono::duration<double, std::nano>(decoded_end - start).count() /
+                                    decoded_count : 0;
+
+    double bytes = (double)stats.bytes / stats.samples;
+    double block_bytes = (double)(stats.sealed + 1) * SENSOR_HISTORY_BLOCK_SIZE / stats.samples;
+    double days = hours / 24;
+    double hold_days = (double)flash_kb * 1024 / block_bytes * (hours * 3600 / stats.samples) / 86400;
+    printf("%-22s %-9s %8lu %6.2f %10.2f %6.2f %8.1f %8.1f %7.1f %7.1f %7.1f %4s\n", trace, kind,
+           (unsigned long)stats.samples, bytes, block_bytes, RAW_SAMPLE_BYTES / block_bytes, stats.writes / days,
+           stats.erases / days, hold_days, enc_ns, dec_ns, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static bool run_trace(const char *path, uint32_t interval_ms, size_t flash_kb, int rounds)
+{
+    trace_t trace;
+    if (!trace_load(path, &trace)) {
+        fprintf(stderr, "cannot load trace %s\n", path);
+        return false;
+    }
+    host_clock_reset();
+    sensor_task_set_wake_grid(0, 0, 0);
+
+    scd41_sim_t sim;
+    scd41_t dev;
+    scd41_sim_init(&sim, &trace, 0x5cd41);
+    scd41_sim_bind(&sim, &dev);
+    bench_run_t run = {};
+    sensor_filter_config_t filter_config;
+    sensor_filter_config_default(&filter_config);
+    filter_config.interval_ms = interval_ms;
+    sensor_filter_init(&run.pipeline.filter, &filter_config);
+    sensor_window_init(&run.pipeline.co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, esp_timer_get_time());
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT];
+    sensor_report_policy_default(policy);
+    sensor_commit_init(&run.pipeline.commit, policy);
+    run.pipeline.write = write_nothing;
+    scd4x_sensor_config_t config = {
+        .dev = &dev,
+        .cb = sensor_notification,
+        .user_data = &run,
+        .interval_ms = interval_ms,
+        .co2_interval_ms = CONFIG_SENSOR_LIT_CO2_INTERVAL_SEC * 1000,
+        .icd_mode = SENSOR_ICD_NONE,
+    };
+    ESP_ERROR_CHECK(sensor_task_init(&config, 1));
+    int64_t duration_us = trace_duration_us(&trace);
+    host_timer_run_until(duration_us);
+    sensor_task_deinit();
+
+    double hours = duration_us / 3.6e9;
+    bool ok = report(trace.name.c_str(), "filtered", run.filtered, flash_kb, rounds, hours);
+    ok &= report(trace.name.c_str(), "raw", run.raw, flash_kb, rounds, hours);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t interval_ms = 10000;
+    size_t flash_kb = 64;
+    int rounds = 50;
+    std::vector<std::string> traces;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            interval_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--flash-kb") == 0 && i + 1 < argc) {
+            flash_kb = (size_t)atoi(argv[++i]);
+            if (flash_kb < 8 || flash_kb % 4 != 0) {
+                fprintf(stderr, "--flash-kb takes a multiple of 4, at least 8\n");
+                return 1;
+            }
+        } else {
+            traces.push_back(argv[i]);
+        }
+    }
+    if (traces.empty()) {
+        traces.push_back(HOST_TRACE_DIR "/office_24h.csv");
+        traces.push_back(HOST_TRACE_DIR "/empty_room_24h.csv");
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    printf("interval %u ms, %u byte blocks, %u KB partition\n", interval_ms, SENSOR_HISTORY_BLOCK_SIZE,
+           (unsigned)flash_kb);
+    printf("%-22s %-9s %8s %6s %10s %6s %8s %8s %7s %7s %7s %4s\n", "trace", "kind", "samples", "B/smp", "blk_B/smp",
+           "ratio", "writes/d", "erases/d", "days", "enc_ns", "dec_ns", "");
+    bool ok = true;
+    for (const std::string &path : traces) {
+        ok &= run_trace(path.c_str(), interval_ms, flash_kb, rounds);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,737 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Replay recorded environment traces through the sampling path
+  (sensor_task_step -> measurement queue -> sensor_commit_apply) against the
+  simulated SCD41 and the fake attribute store.
+
+  usage: replay_bench [--interval-ms N] [--icd none|sit|lit] [--co2-interval-ms N]
+                      [--no-deadband] [--log-level none|error|warn|info]
+                      [--restart-at S [--cold-restart]] [--fault F ...] [--sensors N]
+                      [--demand S [--subscribe FROM:UNTIL:MAX ...] [--poll S]]
+                      [--adaptive MAX [--tolerance PPM]] [trace.csv ...]
+
+  --icd              ICD mode the measurement mode is selected for (default none)
+  --co2-interval-ms  LIT only: how often CO2 is measured (default 300000)
+  --filter           sample filter: none, ema or median (default Kconfig)
+  --aq-hysteresis    AirQuality hysteresis in % of each boundary (default Kconfig)
+  --no-deadband      write every changed value (report policies all zero)
+  --restart-at       reset the device S seconds into the trace: the app state
+                     and sensor task start over while the simulated sensor
+                     keeps running, as after a software reset or OTA reboot
+  --cold-restart     start over without the retained sensor state
+  --fault            inject a simulated sensor failure, repeatable:
+                     absent:FROM:UNTIL  sensor unplugged, seconds into the trace
+                     stuck:AT           SDA held low from AT until a bus recovery
+                     stall:AT           sensor stops measuring until reinit
+                     crc:PPM            corrupted response CRC per million reads
+  --sensors          replay through N sensors, each on its own simulated bus
+                     and endpoints (default 1), faults hit the first one only
+  --demand           sample as sensor_demand.h decides, S seconds apart with no
+                     subscription (the maintenance interval)
+  --subscribe        a subscription on every sensor from FROM until UNTIL
+                     seconds into the trace, max interval MAX s, repeatable
+  --poll             a client reads the measured attributes every S seconds
+  --adaptive         sensor_adapt.h picks each interval between --interval-ms
+                     and MAX seconds (with --demand: the demand interval)
+  --tolerance        sensor_adapt.h tolerance in ppm (default Kconfig)
+  --log-level        esp_log level while replaying (default warn, printed).
+                     Given explicitly, lines are formatted and counted but
+                     not printed.
+
+  aq_chg counts AirQuality writes that changed the class (no heartbeats).
+
+  mAs/h is the sensor charge per hour from the time the simulated sensor
+  spent in each power state, with the scd41_mode.h currents.
+
+  CPU time is host time spent in sensor task steps, including the simulated
+  bus, summed per sample. Use it to compare changes, not as an on-device
+  figure. A 97 ms esp_timer jitter probe runs alongside; jitter_max and late
+  (callbacks more than TIMER_JITTER_LATE_US late) show whether anything
+  blocks the esp_timer task.
+
+  ready_ms is when the sensor bring-up finished, first_ms when the first
+  fresh sample was written to the attributes, both from the start of the
+  run or from the restart. The retained sample of a warm restart is
+  written at once and does not count.
+
+  log_B is the log output per sample in bytes. wake_us estimates how long
+  the device stays awake per sample: CPU time plus draining those bytes
+  through the 115200 baud console UART, which esp_log waits for before the
+  core may sleep.
+
+  With several sensors samples, errors and the report counts add up over
+  all of them, ready_ms is the last bring-up to finish and the health
+  columns are the first sensor's.
+
+  smp/h is samples per hour. co2_mae and co2_max compare the CO2 the device
+  last drained (after the filter) with the trace every 10 s, in ppm: how
+  well a schedule tracks the room, noise and filter lag included.
+
+  i2c/h counts I2C transactions per hour, req the samples brought forward
+  by --poll reads.
+
+  wakes counts sensor task steps, resets the bus recoveries plus fresh
+  bring-ups sensor_health.h escalated to, recov the returns to a good
+  sample after failing, health the state at the end.
+
+  alarms counts CO2 alarm level changes (sensor_alarm.h, Kconfig
+  thresholds), alarm_s how long after the trace itself entered the same
+  level they came, on average.
+
+  Built with -DSENSOR_PROBES=ON, the sensor_probe.h histograms and counters
+  are printed after each trace. The drain runs right away here, so the hop
+  histogram only shows the call itself.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <boot_timeline.h>
+#include <scd4x_sensor.h>
+#include <sensor_demand.h>
+#include <sensor_pipeline.h>
+#include <sensor_probe.h>
+#include <timer_jitter.h>
+
+#include "fake_attribute_store.h"
+#include "host_clock.h"
+#include "host_log.h"
+#include "scd41_sim.h"
+#include "trace.h"
+
+// Matter cluster/attribute ids used by app_main.cpp
+#define TEMPERATURE_MEASUREMENT_CLUSTER_ID  0x0402
+#define RELATIVE_HUMIDITY_CLUSTER_ID        0x0405
+#define CO2_CONCENTRATION_CLUSTER_ID        0x040D
+#define AIR_QUALITY_CLUSTER_ID              0x005B
+#define MEASURED_VALUE_ATTRIBUTE_ID         0x0000
+#define AIR_QUALITY_ATTRIBUTE_ID            0x0000
+#define PEAK_MEASURED_VALUE_ATTRIBUTE_ID    0x0003
+#define AVERAGE_MEASURED_VALUE_ATTRIBUTE_ID 0x0005
+
+#define TEMPERATURE_ENDPOINT_ID             1
+#define HUMIDITY_ENDPOINT_ID                2
+#define AIR_QUALITY_ENDPOINT_ID             3
+
+// off the sampling period so that probe and sensor alarms keep drifting against each other
+#define JITTER_PROBE_PERIOD_MS 97
+// CO2 tracking error probe
+#define TRACK_PERIOD_MS 10000
+
+// app_main.cpp state of one sensor
+typedef struct {
+    uint8_t index;
+    sensor_pipeline_t pipeline;
+    uint32_t air_quality_changes;
+    int64_t last_sample_us;
+    sensor_adapt_t adapt;
+    sensor_alarm_t alarm;
+    // filtered CO2 of the last sample, 0 before the first
+    uint16_t co2;
+} bench_sensor_t;
+
+typedef struct {
+    // sampling cycles seen so far and the CPU time of the current one
+    uint32_t cycles;
+    uint32_t wakes;
+    int64_t step_ns;
+    std::vector<int64_t> cpu_ns;
+    size_t count;
+    bench_sensor_t sensors[SCD4X_SENSOR_MAX];
+    // --demand: subscriptions seen by app_main.cpp
+    bool demand_on;
+    sensor_demand_t demand;
+    // --adaptive, and the slowest interval without --demand
+    bool adaptive;
+    uint32_t adaptive_max_ms;
+    uint32_t base_ms;
+    // CO2 tracking error
+    const trace_t *trace;
+    uint64_t track_count;
+    uint64_t track_error_sum;
+    uint32_t track_error_max;
+    // CO2 alarm: the levels of the trace itself, when each was last entered, and the lag of the device behind
+    sensor_alarm_t trace_alarm;
+    int64_t trace_level_us[SENSOR_ALARM_LEVELS + 1];
+    uint32_t alarm_changes;
+    int64_t alarm_lag_sum_us;
+    uint32_t alarm_lag_count;
+} bench_run_t;
+
+typedef struct {
+    uint16_t endpoint_id;
+    uint32_t cluster_id;
+    uint32_t attribute_id;
+    fake_attr_type_t type;
+} fake_attr_path_t;
+
+static const fake_attr_path_t s_measured_attrs[SENSOR_ATTR_COUNT] = {
+    [SENSOR_ATTR_TEMPERATURE] = { TEMPERATURE_ENDPOINT_ID, TEMPERATURE_MEASUREMENT_CLUSTER_ID,
+                                  MEASURED_VALUE_ATTRIBUTE_ID, FAKE_ATTR_TYPE_INT16 },
+    [SENSOR_ATTR_HUMIDITY] = { HUMIDITY_ENDPOINT_ID, RELATIVE_HUMIDITY_CLUSTER_ID,
+                               MEASURED_VALUE_ATTRIBUTE_ID, FAKE_ATTR_TYPE_UINT16 },
+    [SENSOR_ATTR_CO2] = { AIR_QUALITY_ENDPOINT_ID, CO2_CONCENTRATION_CLUSTER_ID,
+                          MEASURED_VALUE_ATTRIBUTE_ID, FAKE_ATTR_TYPE_FLOAT },
+    [SENSOR_ATTR_AIR_QUALITY] = { AIR_QUALITY_ENDPOINT_ID, AIR_QUALITY_CLUSTER_ID,
+                                  AIR_QUALITY_ATTRIBUTE_ID, FAKE_ATTR_TYPE_UINT8 },
+    [SENSOR_ATTR_CO2_PEAK] = { AIR_QUALITY_ENDPOINT_ID, CO2_CONCENTRATION_CLUSTER_ID,
+                               PEAK_MEASURED_VALUE_ATTRIBUTE_ID, FAKE_ATTR_TYPE_FLOAT },
+    [SENSOR_ATTR_CO2_AVERAGE] = { AIR_QUALITY_ENDPOINT_ID, CO2_CONCENTRATION_CLUSTER_ID,
+                                  AVERAGE_MEASURED_VALUE_ATTRIBUTE_ID, FAKE_ATTR_TYPE_FLOAT },
+};
+
+// endpoints per sensor, in the order app_main.cpp creates them
+#define ENDPOINTS_PER_SENSOR 3
+
+// Same as write_measured_attribute() in app_main.cpp, against the fake store
+static void write_measured_attribute(sensor_attr_t attr, const sensor_measurement_t *measurement,
+                                     bool force_report, void *ctx)
+{
+    bench_sensor_t *sensor = (bench_sensor_t *) ctx;
+    const fake_attr_path_t *path = &s_measured_attrs[attr];
+    uint16_t endpoint_id = path->endpoint_id + ENDPOINTS_PER_SENSOR * sensor->index;
+    fake_attr_val_t val = { path->type };
+    switch (attr) {
+    case SENSOR_ATTR_TEMPERATURE:   val.val.i16 = measurement->temperature; break;
+    case SENSOR_ATTR_HUMIDITY:      val.val.u16 = measurement->humidity; break;
+    case SENSOR_ATTR_CO2:           val.val.f = (float)measurement->co2; break;
+    case SENSOR_ATTR_AIR_QUALITY:   val.val.u8 = measurement->air_quality; break;
+    case SENSOR_ATTR_CO2_PEAK:      val.val.f = (float)measurement->co2_peak; break;
+    case SENSOR_ATTR_CO2_AVERAGE:   val.val.f = (float)measurement->co2_average; break;
+    default:                        return;
+    }
+    if (attr == SENSOR_ATTR_AIR_QUALITY && !force_report) {
+        sensor->air_quality_changes++;
+    }
+    SENSOR_PROBE_BEGIN(write_start);
+    if (force_report) {
+        fake_attr_report(endpoint_id, path->cluster_id, path->attribute_id, &val);
+    } else {
+        fake_attr_update(endpoint_id, path->cluster_id, path->attribute_id, &val);
+    }
+    SENSOR_PROBE_END(SENSOR_PROBE_WRITE, write_start);
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_UPDATES, force_report ? 0 : 1);
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_DIRTY_MARKS, 1);
+}
+
+// alarm_update() in app_main.cpp
+static void alarm_update(size_t sensor, sensor_alarm_result_t result, uint8_t previous, uint16_t co2_ppm, void *ctx)
+{
+    bench_run_t *run = (bench_run_t *) ctx;
+    sensor_alarm_t *alarm = &run->sensors[sensor].alarm;
+    if (result == SENSOR_ALARM_PENDING) {
+        if (run->adaptive) {
+            sensor_task_set_interval(sensor, sensor_adapt_snap(&run->sensors[sensor].adapt));
+        } else if (run->demand_on && sensor_demand_interval_ms(&run->demand, sensor) > run->base_ms) {
+            sensor_task_request_sample(sensor);
+        }
+        return;
+    }
+    run->alarm_changes++;
+    if (run->trace_alarm.level == alarm->level && run->trace_level_us[alarm->level] >= 0) {
+        run->alarm_lag_sum_us += esp_timer_get_time() - run->trace_level_us[alarm->level];
+        run->alarm_lag_count++;
+    }
+}
+
+// sensor_notification() in app_main.cpp: the Matter thread runs the drain right away
+static void sensor_notification(void *user_data)
+{
+    bench_run_t *run = (bench_run_t *) user_data;
+    SENSOR_PROBE_BEGIN(hop_start);
+    fake_attr_schedule();
+    SENSOR_PROBE_END(SENSOR_PROBE_HOP, hop_start);
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        bench_sensor_t *sensor = &run->sensors[measurement.sensor];
+        if (!sensor_pipeline_apply(&sensor->pipeline, &measurement, esp_timer_get_time())) {
+            continue;
+        }
+        boot_timeline_mark(BOOT_MARK_FIRST_REPORT);
+        sensor->last_sample_us = esp_timer_get_time();
+        sensor->co2 = measurement.co2;
+    }
+}
+
+// demand_changed() in app_main.cpp
+static void apply_demand(bench_run_t *run)
+{
+    if (!run->demand_on && !run->adaptive) {
+        return;
+    }
+    for (size_t i = 0; i < run->count; i++) {
+        uint32_t interval_ms = run->demand_on ? sensor_demand_interval_ms(&run->demand, i) : run->adaptive_max_ms;
+        if (run->adaptive) {
+            sensor_adapt_set_range(&run->sensors[i].adapt, run->base_ms, interval_ms);
+            interval_ms = run->sensors[i].adapt.interval_ms;
+        }
+        sensor_task_set_interval(i, interval_ms);
+    }
+}
+
+static void track_co2(void *arg)
+{
+    bench_run_t *run = (bench_run_t *) arg;
+    float truth = trace_at(run->trace, esp_timer_get_time()).co2_ppm;
+    if (sensor_alarm_update(&run->trace_alarm, (uint16_t)(truth + 0.5f)) == SENSOR_ALARM_CHANGED) {
+        run->trace_level_us[run->trace_alarm.level] = esp_timer_get_time();
+    }
+    for (size_t i = 0; i < run->count; i++) {
+        if (run->sensors[i].co2 == 0) {
+            continue;
+        }
+        uint32_t error = (uint32_t)(fabsf(run->sensors[i].co2 - truth) + 0.5f);
+        run->track_count++;
+        run->track_error_sum += error;
+        run->track_error_max = std::max(run->track_error_max, error);
+    }
+}
+
+typedef struct {
+    uint32_t from_s;
+    uint32_t until_s;
+    uint32_t max_interval_s;
+} bench_subscription_t;
+
+#define BENCH_SUBSCRIPTIONS_MAX 8
+
+// one end of a --subscribe window
+typedef struct {
+    bench_run_t *run;
+    const bench_subscription_t *subscription;
+    bool start;
+    esp_timer_handle_t timer;
+} bench_demand_event_t;
+
+static void demand_event(void *arg)
+{
+    bench_demand_event_t *event = (bench_demand_event_t *) arg;
+    bench_run_t *run = event->run;
+    if (event->start) {
+        sensor_demand_subscribe(&run->demand, event->subscription, (1u << run->count) - 1,
+                                event->subscription->max_interval_s * 1000);
+    } else {
+        sensor_demand_unsubscribe(&run->demand, event->subscription, (1u << run->count) - 1);
+    }
+    apply_demand(run);
+}
+
+// the read handler in app_main.cpp
+static void poll_read(void *arg)
+{
+    bench_run_t *run = (bench_run_t *) arg;
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < run->count; i++) {
+        if (sensor_demand_on_read(&run->demand, i, now - run->sensors[i].last_sample_us)) {
+            sensor_task_request_sample(i);
+        }
+    }
+}
+
+static void record_dispatch(esp_timer_handle_t timer, int64_t cpu_ns, void *arg)
+{
+    bench_run_t *run = (bench_run_t *) arg;
+    if (strcmp(host_timer_name(timer), "sensor_task") != 0) {
+        return;
+    }
+    run->step_ns += cpu_ns;
+    run->wakes++;
+
+    // a cycle ends with a queued sample or a failed transaction
+    uint32_t cycles = 0;
+    for (size_t i = 0; i < run->count; i++) {
+        scd4x_sensor_stats_t stats;
+        sensor_task_get_stats(i, &stats);
+        cycles += stats.samples + stats.read_errors;
+    }
+    if (cycles != run->cycles) {
+        run->cycles = cycles;
+        run->cpu_ns.push_back(run->step_ns);
+        run->step_ns = 0;
+    }
+}
+
+static int64_t percentile(std::vector<int64_t> sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+typedef struct {
+    uint32_t interval_ms;
+    uint32_t co2_interval_ms;
+    sensor_icd_mode_t icd_mode;
+    sensor_filter_config_t filter;
+    bool no_deadband;
+    esp_log_level_t log_level;
+    uint32_t restart_at_s;
+    bool cold_restart;
+    scd41_sim_faults_t faults;
+    size_t sensors;
+    uint32_t maintenance_s;
+    bench_subscription_t subscriptions[BENCH_SUBSCRIPTIONS_MAX];
+    size_t subscription_count;
+    uint32_t poll_s;
+    uint32_t adaptive_max_s;
+    uint16_t tolerance_ppm;
+} bench_options_t;
+
+static bool run_trace(const char *path, const bench_options_t *options)
+{
+    trace_t trace;
+    if (!trace_load(path, &trace)) {
+        fprintf(stderr, "cannot load trace %s\n", path);
+        return false;
+    }
+
+    host_clock_reset();
+    fake_attr_reset();
+    boot_timeline_reset();
+    uint64_t log_bytes = host_log_bytes();
+#if CONFIG_SENSOR_PROBES
+    sensor_probe_reset();
+#endif
+
+    // every sensor sees the same room with its own noise
+    size_t count = options->sensors;
+    scd41_sim_t sims[SCD4X_SENSOR_MAX];
+    scd41_t devs[SCD4X_SENSOR_MAX];
+    scd41_clock_t clocks[SCD4X_SENSOR_MAX];
+    scd4x_sensor_config_t configs[SCD4X_SENSOR_MAX];
+    bench_run_t run = {};
+    run.count = count;
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT] = {};
+    if (!options->no_deadband) {
+        sensor_report_policy_default(policy);
+    }
+    run.trace = &trace;
+    run.adaptive = options->adaptive_max_s != 0;
+    run.adaptive_max_ms = options->adaptive_max_s * 1000;
+    run.base_ms = options->interval_ms;
+    sensor_adapt_config_t adapt_config;
+    sensor_adapt_config_default(&adapt_config);
+    adapt_config.min_ms = adapt_config.max_ms = options->interval_ms;
+    if (options->tolerance_ppm) {
+        adapt_config.tolerance_ppm = options->tolerance_ppm;
+    }
+    sensor_alarm_config_t alarm_config;
+    sensor_alarm_config_default(&alarm_config);
+    // the trace has no noise to debounce
+    sensor_alarm_config_t trace_alarm_config = alarm_config;
+    trace_alarm_config.debounce = 1;
+    sensor_alarm_init(&run.trace_alarm, &trace_alarm_config);
+    std::fill(run.trace_level_us, run.trace_level_us + SENSOR_ALARM_LEVELS + 1, -1);
+    scd41_clock_config_t clock_config;
+    scd41_clock_config_default(&clock_config);
+    for (size_t i = 0; i < count; i++) {
+        scd41_sim_init(&sims[i], &trace, 0x5cd41 + (uint32_t)i);
+        scd41_sim_bind(&sims[i], &devs[i]);
+        // each on a port of its own, with its clock as sensor_init() sets it up
+        scd41_clock_init(&clocks[i], &clock_config, scd41_sim_set_clock, &sims[i]);
+        scd41_clock_attach(&devs[i], &clocks[i]);
+        if (i == 0) {
+            scd41_sim_set_faults(&sims[i], &options->faults);
+        }
+        bench_sensor_t *sensor = &run.sensors[i];
+        sensor->index = (uint8_t)i;
+        sensor_commit_init(&sensor->pipeline.commit, policy);
+        sensor_filter_init(&sensor->pipeline.filter, &options->filter);
+        sensor_window_init(&sensor->pipeline.co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, esp_timer_get_time());
+        sensor_adapt_init(&sensor->adapt, &adapt_config);
+        sensor_alarm_init(&sensor->alarm, &alarm_config);
+        sensor->pipeline.write = write_measured_attribute;
+        sensor->pipeline.write_ctx = sensor;
+        sensor->pipeline.adapt = run.adaptive ? &sensor->adapt : NULL;
+        sensor->pipeline.alarm = &sensor->alarm;
+        sensor->pipeline.alarm_cb = alarm_update;
+        sensor->pipeline.alarm_ctx = &run;
+        sensor->pipeline.slot = (uint8_t)i;
+        configs[i] = {
+            .dev = &devs[i],
+            .cb = sensor_notification,
+            .user_data = &run,
+            .slot = (uint8_t)i,
+            .interval_ms = options->interval_ms,
+            .co2_interval_ms = options->co2_interval_ms,
+            .icd_mode = options->icd_mode,
+        };
+    }
+
+    run.demand_on = options->maintenance_s != 0;
+    uint32_t base_ms[SCD4X_SENSOR_MAX];
+    std::fill(base_ms, base_ms + count, options->interval_ms);
+    sensor_demand_init(&run.demand, count, base_ms, options->maintenance_s * 1000);
+    bench_demand_event_t events[2 * BENCH_SUBSCRIPTIONS_MAX] = {};
+    size_t event_count = 0;
+    for (size_t i = 0; run.demand_on && i < options->subscription_count; i++) {
+        for (bool start : { true, false }) {
+            bench_demand_event_t *event = &events[event_count++];
+            event->run = &run;
+            event->subscription = &options->subscriptions[i];
+            event->start = start;
+            esp_timer_create_args_t args = { .callback = demand_event, .arg = event, .name = "bench_demand" };
+            ESP_ERROR_CHECK(esp_timer_create(&args, &event->timer));
+            uint32_t at_s = start ? event->subscription->from_s : event->subscription->until_s;
+            ESP_ERROR_CHECK(esp_timer_start_once(event->timer, (uint64_t)at_s * 1000000));
+        }
+    }
+    esp_timer_handle_t poll_timer = NULL;
+    if (run.demand_on && options->poll_s) {
+        esp_timer_create_args_t args = { .callback = poll_read, .arg = &run, .name = "bench_poll" };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &poll_timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(poll_timer, (uint64_t)options->poll_s * 1000000));
+    }
+
+    esp_timer_handle_t track_timer;
+    esp_timer_create_args_t track_args = { .callback = track_co2, .arg = &run, .name = "bench_track" };
+    ESP_ERROR_CHECK(esp_timer_create(&track_args, &track_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(track_timer, TRACK_PERIOD_MS * 1000));
+
+    host_timer_set_observer(record_dispatch, &run);
+    ESP_ERROR_CHECK(sensor_task_init(configs, count));
+    apply_demand(&run);
+    ESP_ERROR_CHECK(timer_jitter_start(JITTER_PROBE_PERIOD_MS));
+    int64_t duration_us = trace_duration_us(&trace);
+    int64_t start_us = 0;
+    if (options->restart_at_s) {
+        // reset: everything on the device starts over, the sensor does not notice
+        start_us = (int64_t)options->restart_at_s * 1000000;
+        host_timer_run_until(start_us);
+        sensor_task_deinit();
+        for (size_t i = 0; i < count; i++) {
+            bench_sensor_t *sensor = &run.sensors[i];
+            sensor_commit_init(&sensor->pipeline.commit, policy);
+            sensor_filter_init(&sensor->pipeline.filter, &options->filter);
+            sensor_window_init(&sensor->pipeline.co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, start_us);
+            sensor_adapt_init(&sensor->adapt, &adapt_config);
+            sensor_alarm_init(&sensor->alarm, &alarm_config);
+            configs[i].warm_start = !options->cold_restart;
+        }
+        boot_timeline_reset();
+        run.cycles = 0;
+        ESP_ERROR_CHECK(sensor_task_init(configs, count));
+        apply_demand(&run);
+    }
+    host_timer_run_until(duration_us);
+    timer_jitter_stop();
+
+    // totals over the sensors, health of the first
+    scd4x_sensor_stats_t sensor_stats = {};
+    uint32_t air_quality_changes = 0;
+    double charge_mas = 0;
+    uint64_t transactions = 0;
+    for (size_t i = 0; i < count; i++) {
+        scd4x_sensor_stats_t stats;
+        sensor_task_get_stats(i, &stats);
+        sensor_stats.samples += stats.samples;
+        sensor_stats.read_errors += stats.read_errors;
+        sensor_stats.requested += stats.requested;
+        sensor_stats.ready_us = std::max(sensor_stats.ready_us, stats.ready_us);
+        air_quality_changes += run.sensors[i].air_quality_changes;
+        charge_mas += scd41_sim_charge_mas(scd41_sim_get_stats(&sims[i]));
+        transactions += scd41_sim_get_stats(&sims[i])->writes + scd41_sim_get_stats(&sims[i])->reads;
+    }
+    sensor_health_t health;
+    sensor_task_get_health(0, &health);
+    sensor_task_deinit();
+    host_timer_set_observer(NULL, NULL);
+    for (size_t i = 0; i < event_count; i++) {
+        esp_timer_stop(events[i].timer);
+        esp_timer_delete(events[i].timer);
+    }
+    if (poll_timer) {
+        esp_timer_stop(poll_timer);
+        esp_timer_delete(poll_timer);
+    }
+    esp_timer_stop(track_timer);
+    esp_timer_delete(track_timer);
+
+    int64_t total_ns = 0;
+    for (int64_t ns : run.cpu_ns) {
+        total_ns += ns;
+    }
+    size_t cycles = run.cpu_ns.size();
+    double hours = duration_us / 3600e6;
+    const fake_attr_stats_t *stats = fake_attr_stats();
+    timer_jitter_stats_t jitter;
+    timer_jitter_get(&jitter);
+    double log_per_cycle = cycles ? (double)(host_log_bytes() - log_bytes) / cycles : 0;
+    double cpu_mean_ns = cycles ? (double)total_ns / cycles : 0;
+    double wake_us = (cpu_mean_ns + log_per_cycle * HOST_LOG_UART_NS_PER_BYTE) / 1000;
+
+    printf("%-22s %6.1f %8u %6.0f %7u %9lld %9lld %9lld %9llu %9llu %9llu %10.1f %6u %7.1f %7u %10lld %6u %8.0f %7.0f %5u %6.1f %8.1f %8lld %8lld %7u %6u %5u %8s %6u %7.1f\n",
+           trace.name.c_str(), hours, sensor_stats.samples, sensor_stats.samples / hours, sensor_stats.read_errors,
+           (long long)(cycles ? total_ns / (int64_t)cycles : 0),
+           (long long)percentile(run.cpu_ns, 0.5), (long long)percentile(run.cpu_ns, 0.99),
+           (unsigned long long)stats->schedules, (unsigned long long)stats->updates,
+           (unsigned long long)stats->reports, stats->reports / hours, air_quality_changes,
+           run.track_count ? (double)run.track_error_sum / run.track_count : 0.0, run.track_error_max,
+           (long long)jitter.max_us, jitter.late, charge_mas / hours, transactions / hours, sensor_stats.requested,
+           log_per_cycle, wake_us,
+           (long long)((sensor_stats.ready_us - start_us) / 1000),
+           (long long)((boot_timeline_get(BOOT_MARK_FIRST_REPORT) - start_us) / 1000),
+           run.wakes, health.resets, health.recoveries, sensor_health_name(health.state), run.alarm_changes,
+           run.alarm_lag_count ? run.alarm_lag_sum_us / 1e6 / run.alarm_lag_count : 0.0);
+#if CONFIG_SENSOR_PROBES
+    sensor_probe_print();
+#endif
+    return true;
+}
+
+static bool parse_fault(const char *arg, scd41_sim_faults_t *faults)
+{
+    unsigned long a, b;
+    if (sscanf(arg, "absent:%lu:%lu", &a, &b) == 2 && b > a) {
+        faults->absent_from_us = (int64_t)a * 1000000;
+        faults->absent_until_us = (int64_t)b * 1000000;
+    } else if (sscanf(arg, "stuck:%lu", &a) == 1 && a > 0) {
+        faults->stuck_at_us = (int64_t)a * 1000000;
+    } else if (sscanf(arg, "stall:%lu", &a) == 1 && a > 0) {
+        faults->stall_at_us = (int64_t)a * 1000000;
+    } else if (sscanf(arg, "crc:%lu", &a) == 1) {
+        faults->crc_error_ppm = (uint32_t)a;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bench_options_t options = { .interval_ms = 10000, .co2_interval_ms = 300000, .icd_mode = SENSOR_ICD_NONE,
+                                .log_level = ESP_LOG_WARN, .sensors = 1 };
+    bool mute_log = false;
+    sensor_filter_config_default(&options.filter);
+    std::vector<std::string> traces;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            options.interval_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--co2-interval-ms") == 0 && i + 1 < argc) {
+            options.co2_interval_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--icd") == 0 && i + 1 < argc) {
+            const char *mode = argv[++i];
+            options.icd_mode = strcmp(mode, "lit") == 0 ? SENSOR_ICD_LIT :
+                               strcmp(mode, "sit") == 0 ? SENSOR_ICD_SIT : SENSOR_ICD_NONE;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            const char *type = argv[++i];
+            options.filter.type = strcmp(type, "ema") == 0 ? SENSOR_FILTER_EMA :
+                                  strcmp(type, "median") == 0 ? SENSOR_FILTER_MEDIAN : SENSOR_FILTER_NONE;
+        } else if (strcmp(argv[i], "--aq-hysteresis") == 0 && i + 1 < argc) {
+            options.filter.air_quality_hysteresis_pct = (uint8_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-deadband") == 0) {
+            options.no_deadband = true;
+        } else if (strcmp(argv[i], "--restart-at") == 0 && i + 1 < argc) {
+            options.restart_at_s = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cold-restart") == 0) {
+            options.cold_restart = true;
+        } else if (strcmp(argv[i], "--fault") == 0 && i + 1 < argc) {
+            if (!parse_fault(argv[++i], &options.faults)) {
+                fprintf(stderr, "bad fault %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            options.sensors = (size_t)atoi(argv[++i]);
+            if (options.sensors < 1 || options.sensors > SCD4X_SENSOR_MAX) {
+                fprintf(stderr, "--sensors takes 1 to %d\n", SCD4X_SENSOR_MAX);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--demand") == 0 && i + 1 < argc) {
+            options.maintenance_s = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--subscribe") == 0 && i + 1 < argc) {
+            bench_subscription_t subscription;
+            if (options.subscription_count == BENCH_SUBSCRIPTIONS_MAX ||
+                    sscanf(argv[++i], "%u:%u:%u", &subscription.from_s, &subscription.until_s,
+                           &subscription.max_interval_s) != 3 || subscription.until_s <= subscription.from_s) {
+                fprintf(stderr, "bad subscription %s\n", argv[i]);
+                return 1;
+            }
+            options.subscriptions[options.subscription_count++] = subscription;
+        } else if (strcmp(argv[i], "--poll") == 0 && i + 1 < argc) {
+            options.poll_s = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc) {
+            options.adaptive_max_s = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            options.tolerance_ppm = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            const char *level = argv[++i];
+            options.log_level = strcmp(level, "info") == 0 ? ESP_LOG_INFO :
+                                strcmp(level, "warn") == 0 ? ESP_LOG_WARN :
+                                strcmp(level, "error") == 0 ? ESP_LOG_ERROR : ESP_LOG_NONE;
+            mute_log = true;
+        } else {
+            traces.push_back(argv[i]);
+        }
+    }
+    options.filter.interval_ms = options.interval_ms;
+    if (traces.empty()) {
+        traces.push_back(HOST_TRACE_DIR "/office_24h.csv");
+        traces.push_back(HOST_TRACE_DIR "/empty_room_24h.csv");
+    }
+
+    esp_log_level_set("*", options.log_level);
+    // the bench's own jitter probe summary is not part of the sample path
+    esp_log_level_set("timer_jitter", ESP_LOG_WARN);
+    host_log_mute(mute_log);
+
+    static const char *icd_names[] = { "none", "sit", "lit" };
+    static const char *filter_names[] = { "none", "ema", "median" };
+    printf("%u sensor%s, interval %u ms, report policy %s, icd %s, filter %s, AirQuality hysteresis %u %%\n",
+           (unsigned)options.sensors, options.sensors > 1 ? "s" : "", options.interval_ms,
+           options.no_deadband ? "off" : "Kconfig defaults", icd_names[options.icd_mode],
+           filter_names[options.filter.type], options.filter.air_quality_hysteresis_pct);
+    if (options.adaptive_max_s) {
+        sensor_adapt_config_t adapt_config;
+        sensor_adapt_config_default(&adapt_config);
+        printf("adaptive interval up to %u s, tolerance %u ppm\n", options.adaptive_max_s,
+               options.tolerance_ppm ? options.tolerance_ppm : adapt_config.tolerance_ppm);
+    }
+    if (options.maintenance_s) {
+        printf("demand sampling, %u s without subscribers, %u subscription%s, %s\n", options.maintenance_s,
+               (unsigned)options.subscription_count, options.subscription_count == 1 ? "" : "s",
+               options.poll_s ? ("read every " + std::to_string(options.poll_s) + " s").c_str() : "no reads");
+    }
+
+    // power model for every mode at this interval, then the one the scheduler picks
+    static const scd41_mode_plan_t modes[] = {
+        { SCD41_MODE_PERIODIC, 1 },
+        { SCD41_MODE_LOW_POWER_PERIODIC, 1 },
+        { SCD41_MODE_SINGLE_SHOT, 1 },
+    };
+    for (const scd41_mode_plan_t &plan : modes) {
+        printf("  model %-20s %8lu mAs/h\n", scd41_mode_name(plan.mode),
+               (unsigned long)scd41_mode_charge_mas_per_hour(&plan, options.interval_ms));
+    }
+    scd41_mode_plan_t plan = scd41_mode_select(options.interval_ms, options.co2_interval_ms, options.icd_mode);
+    printf("  selected %s, CO2 every %u samples: %lu mAs/h\n", scd41_mode_name(plan.mode), plan.co2_every,
+           (unsigned long)scd41_mode_charge_mas_per_hour(&plan, options.interval_ms));
+
+    printf("%-22s %6s %8s %6s %7s %9s %9s %9s %9s %9s %9s %10s %6s %7s %7s %10s %6s %8s %7s %5s %6s %8s %8s %8s %7s %6s %5s %8s %6s %7s\n",
+           "trace", "hours", "samples", "smp/h", "errors", "cpu_mean", "cpu_p50", "cpu_p99",
+           "hops", "updates", "reports", "reports/h", "aq_chg", "co2_mae", "co2_max", "jitter_max", "late", "mAs/h", "i2c/h", "req", "log_B", "wake_us", "ready_ms", "first_ms",
+           "wakes", "resets", "recov", "health", "alarms", "alarm_s");
+    bool ok = true;
+    for (const std::string &path : traces) {
+        ok &= run_trace(path.c_str(), &options);
+    }
+    return ok ? 0 : 1;
+}
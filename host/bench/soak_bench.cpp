@@ -0,0 +1,311 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Heap soak of the sample path: weeks of samples through the sensor task
+  and the drain of app_main.cpp, counting every heap allocation.
+
+  usage: soak_bench [--days N] [--interval-ms N] [--sensors N] [--clean] [trace.csv]
+
+  The trace (default office_24h.csv) is repeated for --days (default 30).
+  The drain runs sensor_pipeline.h as app_main.cpp does with the Kconfig
+  defaults: adaptive interval, filter, CO2 alarm, CO2 window, commit to
+  the fake attribute store, sample history into a RAM stand-in of the
+  partition. Unless --clean, the first sensor sees 2000 ppm
+  corrupted CRCs and is unplugged for ten minutes on the second day, so
+  the retry, backoff and recovery paths run too.
+
+  malloc, calloc and realloc (and operator new through them) are counted.
+  The first hour is startup; after it the count must stay at zero, the
+  bench fails otherwise. live_B is the heap still allocated at the end
+  minus at the end of startup.
+*/
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <scd4x_sensor.h>
+#include <sensor_history.h>
+#include <sensor_pipeline.h>
+
+#include "fake_attribute_store.h"
+#include "host_clock.h"
+#include "scd41_sim.h"
+#include "trace.h"
+
+#define STARTUP_US          (3600 * 1000000LL)
+#define DAY_S               86400
+#define SOAK_CRC_ERROR_PPM  2000
+#define SOAK_ABSENT_S       600
+// CONFIG_SENSOR_ADAPTIVE_MAX_INTERVAL_SEC default
+#define SOAK_ADAPTIVE_MAX_S 300
+#define STORE_BLOCKS        64
+#define STORE_SECTOR_BLOCKS 16
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+static uint64_t s_allocs;
+static int64_t s_live_bytes;
+
+extern "C" void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    s_allocs++;
+    s_live_bytes += ptr ? malloc_usable_size(ptr) : 0;
+    return ptr;
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    void *ptr = __libc_calloc(n, size);
+    s_allocs++;
+    s_live_bytes += ptr ? malloc_usable_size(ptr) : 0;
+    return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    s_live_bytes -= ptr ? malloc_usable_size(ptr) : 0;
+    ptr = __libc_realloc(ptr, size);
+    s_allocs++;
+    s_live_bytes += ptr ? malloc_usable_size(ptr) : 0;
+    return ptr;
+}
+
+extern "C" void free(void *ptr)
+{
+    s_live_bytes -= ptr ? malloc_usable_size(ptr) : 0;
+    __libc_free(ptr);
+}
+
+// a RAM stand-in for the history partition, so blocks are sealed, written and erased
+static uint8_t s_store[STORE_BLOCKS][SENSOR_HISTORY_BLOCK_SIZE];
+
+static esp_err_t store_read(uint32_t index, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    memcpy(block, s_store[index], SENSOR_HISTORY_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t store_erase(uint32_t sector, void *ctx)
+{
+    memset(s_store[sector * STORE_SECTOR_BLOCKS], 0xff, STORE_SECTOR_BLOCKS * SENSOR_HISTORY_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t store_write(uint32_t index, const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    memcpy(s_store[index], block, SENSOR_HISTORY_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+typedef struct {
+    uint8_t index;
+    sensor_pipeline_t pipeline;
+    sensor_adapt_t adapt;
+    sensor_alarm_t alarm;
+} soak_sensor_t;
+
+typedef struct {
+    soak_sensor_t sensors[SCD4X_SENSOR_MAX];
+    uint64_t samples;
+} soak_run_t;
+
+// app_main.cpp's endpoints per sensor: temperature, humidity, air quality
+#define ENDPOINTS_PER_SENSOR 3
+
+static void write_measured_attribute(sensor_attr_t attr, const sensor_measurement_t *measurement,
+                                     bool force_report, void *ctx)
+{
+    const soak_sensor_t *sensor = (const soak_sensor_t *) ctx;
+    fake_attr_val_t val = { FAKE_ATTR_TYPE_FLOAT };
+    switch (attr) {
+    case SENSOR_ATTR_TEMPERATURE:   val.val.f = measurement->temperature; break;
+    case SENSOR_ATTR_HUMIDITY:      val.val.f = measurement->humidity; break;
+    case SENSOR_ATTR_CO2:           val.val.f = measurement->co2; break;
+    case SENSOR_ATTR_AIR_QUALITY:   val.val.f = measurement->air_quality; break;
+    case SENSOR_ATTR_CO2_PEAK:      val.val.f = measurement->co2_peak; break;
+    case SENSOR_ATTR_CO2_AVERAGE:   val.val.f = measurement->co2_average; break;
+    default:                        return;
+    }
+    uint16_t endpoint_id = (uint16_t)(1 + ENDPOINTS_PER_SENSOR * sensor->index);
+    if (force_report) {
+        fake_attr_report(endpoint_id, 0, attr, &val);
+    } else {
+        fake_attr_update(endpoint_id, 0, attr, &val);
+    }
+}
+
+// drain_measurements() in app_main.cpp
+static void sensor_notification(void *user_data)
+{
+    soak_run_t *run = (soak_run_t *) user_data;
+    fake_attr_schedule();
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        sensor_pipeline_apply(&run->sensors[measurement.sensor].pipeline, &measurement, esp_timer_get_time());
+        run->samples++;
+    }
+}
+
+// The trace again and again, days long
+static bool repeat_trace(const char *path, uint32_t days, trace_t *trace)
+{
+    trace_t day;
+    if (!trace_load(path, &day) || day.points.size() < 2) {
+        return false;
+    }
+    int64_t step_s = day.points[1].t_s - day.points[0].t_s;
+    int64_t period_s = day.points.back().t_s - day.points.front().t_s + step_s;
+    trace->name = day.name;
+    trace->points.reserve(day.points.size() * days);
+    for (uint32_t d = 0; d < days; d++) {
+        for (trace_point_t point : day.points) {
+            point.t_s += d * period_s;
+            trace->points.push_back(point);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = 30;
+    uint32_t interval_ms = 10000;
+    size_t count = 1;
+    bool clean = false;
+    std::string path = HOST_TRACE_DIR "/office_24h.csv";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            interval_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            count = (size_t)atoi(argv[++i]);
+            if (count < 1 || count > SCD4X_SENSOR_MAX) {
+                fprintf(stderr, "--sensors takes 1 to %d\n", SCD4X_SENSOR_MAX);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--clean") == 0) {
+            clean = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (days < 2) {
+        fprintf(stderr, "--days takes at least 2\n");
+        return 1;
+    }
+
+    trace_t trace;
+    if (!repeat_trace(path.c_str(), days, &trace)) {
+        fprintf(stderr, "cannot load trace %s\n", path.c_str());
+        return 1;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+    host_clock_reset();
+    fake_attr_reset();
+    memset(s_store, 0xff, sizeof(s_store));
+    sensor_history_store_t store = {
+        .blocks = STORE_BLOCKS,
+        .blocks_per_sector = STORE_SECTOR_BLOCKS,
+        .read = store_read,
+        .erase = store_erase,
+        .write = store_write,
+        .ctx = NULL,
+    };
+    sensor_history_init(&store);
+
+    static soak_run_t run;
+    scd41_sim_t sims[SCD4X_SENSOR_MAX];
+    scd41_t devs[SCD4X_SENSOR_MAX];
+    scd4x_sensor_config_t configs[SCD4X_SENSOR_MAX];
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT];
+    sensor_report_policy_default(policy);
+    sensor_filter_config_t filter_config;
+    sensor_filter_config_default(&filter_config);
+    filter_config.interval_ms = interval_ms;
+    sensor_adapt_config_t adapt_config;
+    sensor_adapt_config_default(&adapt_config);
+    adapt_config.min_ms = interval_ms;
+    adapt_config.max_ms = SOAK_ADAPTIVE_MAX_S * 1000;
+    sensor_alarm_config_t alarm_config;
+    sensor_alarm_config_default(&alarm_config);
+    for (size_t i = 0; i < count; i++) {
+        scd41_sim_init(&sims[i], &trace, 0x5cd41 + (uint32_t)i);
+        scd41_sim_bind(&sims[i], &devs[i]);
+        soak_sensor_t *sensor = &run.sensors[i];
+        sensor->index = (uint8_t)i;
+        sensor_filter_init(&sensor->pipeline.filter, &filter_config);
+        sensor_window_init(&sensor->pipeline.co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, esp_timer_get_time());
+        sensor_commit_init(&sensor->pipeline.commit, policy);
+        sensor_adapt_init(&sensor->adapt, &adapt_config);
+        sensor_alarm_init(&sensor->alarm, &alarm_config);
+        sensor->pipeline.write = write_measured_attribute;
+        sensor->pipeline.write_ctx = sensor;
+        sensor->pipeline.adapt = &sensor->adapt;
+        sensor->pipeline.alarm = &sensor->alarm;
+        sensor->pipeline.history = true;
+        sensor->pipeline.slot = (uint8_t)i;
+        configs[i] = {
+            .dev = &devs[i],
+            .cb = sensor_notification,
+            .user_data = &run,
+            .slot = (uint8_t)i,
+            .interval_ms = interval_ms,
+            .co2_interval_ms = CONFIG_SENSOR_LIT_CO2_INTERVAL_SEC * 1000,
+            .icd_mode = SENSOR_ICD_NONE,
+        };
+    }
+    if (!clean) {
+        scd41_sim_faults_t faults = {};
+        faults.crc_error_ppm = SOAK_CRC_ERROR_PPM;
+        faults.absent_from_us = (int64_t)(DAY_S + DAY_S / 2) * 1000000;
+        faults.absent_until_us = faults.absent_from_us + SOAK_ABSENT_S * 1000000LL;
+        scd41_sim_set_faults(&sims[0], &faults);
+    }
+    ESP_ERROR_CHECK(sensor_task_init(configs, count));
+
+    host_timer_run_until(STARTUP_US);
+    uint64_t startup_allocs = s_allocs;
+    uint64_t startup_samples = run.samples;
+    int64_t startup_live = s_live_bytes;
+
+    int64_t duration_us = trace_duration_us(&trace);
+    // in steps, so a day's worth of timers never piles up
+    for (int64_t t = STARTUP_US; t < duration_us;) {
+        t = std::min<int64_t>(t + STARTUP_US, duration_us);
+        host_timer_run_until(t);
+    }
+    uint64_t allocs = s_allocs - startup_allocs;
+    uint64_t samples = run.samples - startup_samples;
+    int64_t live = s_live_bytes - startup_live;
+
+    scd4x_sensor_stats_t stats;
+    sensor_task_get_stats(0, &stats);
+    sensor_health_t health;
+    sensor_task_get_health(0, &health);
+    printf("%-22s %5s %8s %7s %9s %8s %8s %8s %7s %8s\n", "trace", "days", "samples", "errors", "recovered",
+           "start_a", "allocs", "a/smp", "live_B", "result");
+    printf("%-22s %5u %8llu %7lu %9lu %8llu %8llu %8.4f %7lld %8s\n", trace.name.c_str(), days,
+           (unsigned long long)samples, (unsigned long)stats.read_errors, (unsigned long)health.recoveries,
+           (unsigned long long)startup_allocs, (unsigned long long)allocs, samples ? (double)allocs / samples : 0,
+           (long long)live, allocs == 0 && live == 0 ? "ok" : "FAIL");
+    return allocs == 0 && live == 0 ? 0 : 1;
+}
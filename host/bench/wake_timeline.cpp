@@ -0,0 +1,379 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Wake timeline of an ICD: Thread data polls and sensor task steps on one
+  virtual clock, with and without the wake grid of
+  sensor_task_set_wake_grid().
+
+  usage: wake_timeline [--trace trace.csv] [--merge-ms N] [--slip-pct N]
+                       [--poll-offset-ms N] [sdkconfig preset ...]
+
+  --trace           environment replayed by the simulated sensor
+                    (default traces/office_24h.csv)
+  --merge-ms        events closer than this share one wake (default 30: an
+                    idle gap shorter than CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP,
+                    3 ticks at 100 Hz, does not reach light sleep)
+  --slip-pct        overrides CONFIG_SENSOR_WAKE_SLIP_PCT of the presets
+  --poll-offset-ms  time of the first idle mode entry (default 1234), so the
+                    polls do not start in phase with the sensor by accident
+
+  Each preset file (default ../sdkconfig.defaults, the SIT preset, and
+  ../sdkconfig.defaults.esp32c6.lit) gives the ICD timing and the sample
+  interval, missing keys take their Kconfig defaults. The ICD model:
+  slow polls every CONFIG_ICD_SLOW_POLL_INTERVAL_MS from the idle mode
+  entry, active mode after CONFIG_ICD_IDLE_MODE_INTERVAL_SEC (the LIT
+  check-in) and after every report, with fast polls until it ends. A LIT
+  preset runs as a registered LIT ICD. The app side is app_main.cpp with
+  the Kconfig report policies, no demand or adaptive sampling.
+
+  polls/h counts poll wakes, sensor/h sensor task steps (each command of
+  a sample is one), wakes/h distinct wakes after merging, shared/h wakes
+  with both, alone/h wakes for the sensor only. aligned is the number of
+  samples moved onto the grid, active/h the active mode entries.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <scd4x_sensor.h>
+#include <sensor_pipeline.h>
+
+#include "fake_attribute_store.h"
+#include "host_clock.h"
+#include "scd41_sim.h"
+#include "trace.h"
+
+// Kconfig defaults of the keys a preset leaves out
+#define DEFAULT_SLOW_POLL_MS        5000
+#define DEFAULT_FAST_POLL_MS        200
+#define DEFAULT_IDLE_MODE_SEC       300
+#define DEFAULT_ACTIVE_MODE_MS      300
+#define DEFAULT_ACTIVE_THRESHOLD_MS 300
+#define DEFAULT_SAMPLE_INTERVAL_SEC 10
+#define DEFAULT_LIT_CO2_SEC         300
+#define DEFAULT_WAKE_SLIP_PCT       50
+
+typedef struct {
+    std::string name;
+    uint32_t slow_poll_ms;
+    uint32_t fast_poll_ms;
+    uint32_t idle_mode_ms;
+    uint32_t active_mode_ms;
+    uint32_t active_threshold_ms;
+    bool lit;
+    uint32_t interval_ms;
+    uint32_t co2_interval_ms;
+    uint8_t slip_pct;
+} preset_t;
+
+typedef enum : uint8_t {
+    EVENT_POLL = 1,
+    EVENT_SENSOR = 2,
+} event_kind_t;
+
+typedef struct {
+    int64_t t_us;
+    event_kind_t kind;
+} event_t;
+
+typedef struct {
+    const preset_t *preset;
+    bool coalesce;
+    esp_timer_handle_t icd_timer;
+    bool active;
+    // idle: next active mode entry, active: its end
+    int64_t mode_until_us;
+    uint32_t active_entries;
+    uint64_t reports;
+    std::vector<event_t> events;
+    sensor_pipeline_t pipeline;
+} timeline_t;
+
+static bool parse_preset(const char *path, preset_t *preset)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    const char *slash = strrchr(path, '/');
+    preset->name = slash ? slash + 1 : path;
+    preset->slow_poll_ms = DEFAULT_SLOW_POLL_MS;
+    preset->fast_poll_ms = DEFAULT_FAST_POLL_MS;
+    preset->idle_mode_ms = DEFAULT_IDLE_MODE_SEC * 1000;
+    preset->active_mode_ms = DEFAULT_ACTIVE_MODE_MS;
+    preset->active_threshold_ms = DEFAULT_ACTIVE_THRESHOLD_MS;
+    preset->lit = false;
+    preset->interval_ms = DEFAULT_SAMPLE_INTERVAL_SEC * 1000;
+    preset->co2_interval_ms = DEFAULT_LIT_CO2_SEC * 1000;
+    preset->slip_pct = DEFAULT_WAKE_SLIP_PCT;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char key[128];
+        char value[64];
+        if (sscanf(line, "CONFIG_%127[A-Z0-9_]=%63s", key, value) != 2) {
+            continue;
+        }
+        uint32_t n = (uint32_t)strtoul(value, NULL, 10);
+        if (strcmp(key, "ICD_SLOW_POLL_INTERVAL_MS") == 0) {
+            preset->slow_poll_ms = n;
+        } else if (strcmp(key, "ICD_FAST_POLL_INTERVAL_MS") == 0) {
+            preset->fast_poll_ms = n;
+        } else if (strcmp(key, "ICD_IDLE_MODE_INTERVAL_SEC") == 0) {
+            preset->idle_mode_ms = n * 1000;
+        } else if (strcmp(key, "ICD_ACTIVE_MODE_INTERVAL_MS") == 0) {
+            preset->active_mode_ms = n;
+        } else if (strcmp(key, "ICD_ACTIVE_MODE_THRESHOLD_MS") == 0) {
+            preset->active_threshold_ms = n;
+        } else if (strcmp(key, "ENABLE_ICD_LIT") == 0) {
+            preset->lit = strcmp(value, "y") == 0;
+        } else if (strcmp(key, "SENSOR_SAMPLE_INTERVAL_SEC") == 0) {
+            preset->interval_ms = n * 1000;
+        } else if (strcmp(key, "SENSOR_LIT_CO2_INTERVAL_SEC") == 0) {
+            preset->co2_interval_ms = n * 1000;
+        } else if (strcmp(key, "SENSOR_WAKE_SLIP_PCT") == 0) {
+            preset->slip_pct = (uint8_t)n;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static void enter_active(timeline_t *timeline, uint32_t for_ms)
+{
+    int64_t until_us = esp_timer_get_time() + (int64_t)for_ms * 1000;
+    if (!timeline->active) {
+        timeline->active = true;
+        timeline->active_entries++;
+        timeline->mode_until_us = until_us;
+        // the first fast poll goes out right away
+        esp_timer_stop(timeline->icd_timer);
+        esp_timer_start_once(timeline->icd_timer, 0);
+    } else if (until_us > timeline->mode_until_us) {
+        timeline->mode_until_us = until_us;
+    }
+}
+
+static void enter_idle(timeline_t *timeline)
+{
+    const preset_t *preset = timeline->preset;
+    int64_t now = esp_timer_get_time();
+    timeline->active = false;
+    timeline->mode_until_us = now + (int64_t)preset->idle_mode_ms * 1000;
+    // OnEnterIdleMode() in app_main.cpp
+    if (timeline->coalesce) {
+        sensor_task_set_wake_grid(preset->slow_poll_ms, now, preset->slip_pct);
+    }
+    esp_timer_start_once(timeline->icd_timer, (uint64_t)preset->slow_poll_ms * 1000);
+}
+
+// One data poll, then the ICD state machine moves on
+static void icd_poll(void *arg)
+{
+    timeline_t *timeline = (timeline_t *) arg;
+    const preset_t *preset = timeline->preset;
+    int64_t now = esp_timer_get_time();
+    timeline->events.push_back({ now, EVENT_POLL });
+    if (timeline->active) {
+        if (now >= timeline->mode_until_us) {
+            enter_idle(timeline);
+        } else {
+            esp_timer_start_once(timeline->icd_timer, (uint64_t)preset->fast_poll_ms * 1000);
+        }
+        return;
+    }
+    if (now >= timeline->mode_until_us) {
+        // idle mode over: check-in, this poll counts as the first of active mode
+        enter_active(timeline, preset->active_mode_ms);
+        return;
+    }
+    int64_t next_us = std::min(now + (int64_t)preset->slow_poll_ms * 1000, timeline->mode_until_us);
+    esp_timer_start_once(timeline->icd_timer, (uint64_t)(next_us - now));
+}
+
+static void write_attribute(sensor_attr_t attr, const sensor_measurement_t *measurement, bool force_report,
+                            void *ctx)
+{
+    fake_attr_val_t val = { FAKE_ATTR_TYPE_FLOAT };
+    switch (attr) {
+    case SENSOR_ATTR_TEMPERATURE:   val.val.f = measurement->temperature; break;
+    case SENSOR_ATTR_HUMIDITY:      val.val.f = measurement->humidity; break;
+    case SENSOR_ATTR_CO2:           val.val.f = measurement->co2; break;
+    case SENSOR_ATTR_AIR_QUALITY:   val.val.f = measurement->air_quality; break;
+    default:                        return;
+    }
+    if (force_report) {
+        fake_attr_report((uint16_t)attr, 0, 0, &val);
+    } else {
+        fake_attr_update((uint16_t)attr, 0, 0, &val);
+    }
+}
+
+// sensor_notification() in app_main.cpp, a report keeps the ICD active
+static void sensor_notification(void *user_data)
+{
+    timeline_t *timeline = (timeline_t *) user_data;
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        sensor_pipeline_apply(&timeline->pipeline, &measurement, esp_timer_get_time());
+    }
+    uint64_t reports = fake_attr_stats()->reports;
+    if (reports != timeline->reports) {
+        timeline->reports = reports;
+        const preset_t *preset = timeline->preset;
+        enter_active(timeline, std::max(preset->active_mode_ms, preset->active_threshold_ms));
+    }
+}
+
+static void record_dispatch(esp_timer_handle_t timer, int64_t cpu_ns, void *arg)
+{
+    timeline_t *timeline = (timeline_t *) arg;
+    if (strcmp(host_timer_name(timer), "sensor_task") == 0) {
+        timeline->events.push_back({ esp_timer_get_time(), EVENT_SENSOR });
+    }
+}
+
+static void run(const preset_t *preset, const trace_t *trace, bool coalesce, uint32_t merge_ms,
+                uint32_t poll_offset_ms)
+{
+    host_clock_reset();
+    fake_attr_reset();
+    sensor_task_set_wake_grid(0, 0, 0);
+
+    timeline_t timeline = {};
+    timeline.preset = preset;
+    timeline.coalesce = coalesce;
+    sensor_filter_config_t filter_config;
+    sensor_filter_config_default(&filter_config);
+    filter_config.interval_ms = preset->interval_ms;
+    sensor_filter_init(&timeline.pipeline.filter, &filter_config);
+    sensor_window_init(&timeline.pipeline.co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, esp_timer_get_time());
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT];
+    sensor_report_policy_default(policy);
+    sensor_commit_init(&timeline.pipeline.commit, policy);
+    timeline.pipeline.write = write_attribute;
+
+    scd41_sim_t sim;
+    scd41_t dev;
+    scd41_sim_init(&sim, trace, 0x5cd41);
+    scd41_sim_bind(&sim, &dev);
+    scd4x_sensor_config_t config = {
+        .dev = &dev,
+        .cb = sensor_notification,
+        .user_data = &timeline,
+        .interval_ms = preset->interval_ms,
+        .co2_interval_ms = preset->co2_interval_ms,
+        .icd_mode = preset->lit ? SENSOR_ICD_LIT : SENSOR_ICD_SIT,
+    };
+
+    esp_timer_create_args_t args = { .callback = icd_poll, .arg = &timeline, .name = "icd_poll" };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &timeline.icd_timer));
+    host_timer_set_observer(record_dispatch, &timeline);
+    ESP_ERROR_CHECK(sensor_task_init(&config, 1));
+    host_timer_run_until((int64_t)poll_offset_ms * 1000);
+    enter_idle(&timeline);
+    int64_t duration_us = trace_duration_us(trace);
+    host_timer_run_until(duration_us);
+
+    scd4x_sensor_stats_t stats;
+    sensor_task_get_stats(0, &stats);
+    sensor_task_deinit();
+    host_timer_set_observer(NULL, NULL);
+    esp_timer_stop(timeline.icd_timer);
+    esp_timer_delete(timeline.icd_timer);
+
+    // events closer than merge_ms to the previous one extend the same wake
+    std::vector<event_t> &events = timeline.events;
+    std::stable_sort(events.begin(), events.end(), [](const event_t &a, const event_t &b) { return a.t_us < b.t_us; });
+    uint64_t polls = 0, steps = 0, wakes = 0, shared = 0, alone = 0;
+    int64_t merge_us = (int64_t)merge_ms * 1000;
+    for (size_t i = 0; i < events.size();) {
+        int kinds = 0;
+        size_t j = i;
+        do {
+            kinds |= events[j].kind;
+            polls += events[j].kind == EVENT_POLL;
+            steps += events[j].kind == EVENT_SENSOR;
+            j++;
+        } while (j < events.size() && events[j].t_us - events[j - 1].t_us < merge_us);
+        wakes++;
+        shared += kinds == (EVENT_POLL | EVENT_SENSOR);
+        alone += kinds == EVENT_SENSOR;
+        i = j;
+    }
+
+    double hours = duration_us / 3600e6;
+    printf("%-28s %4s %4s %7u %6u %8.0f %8.0f %8.0f %8.0f %8.0f %8u %8u %9.0f %8.1f\n", preset->name.c_str(),
+           preset->lit ? "lit" : "sit", coalesce ? "on" : "off", preset->slow_poll_ms,
+           preset->interval_ms / 1000, polls / hours, steps / hours, wakes / hours, shared / hours, alone / hours,
+           stats.samples, stats.aligned, timeline.reports / hours, timeline.active_entries / hours);
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = HOST_TRACE_DIR "/office_24h.csv";
+    uint32_t merge_ms = 30;
+    uint32_t poll_offset_ms = 1234;
+    int slip_pct = -1;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--merge-ms") == 0 && i + 1 < argc) {
+            merge_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--slip-pct") == 0 && i + 1 < argc) {
+            slip_pct = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--poll-offset-ms") == 0 && i + 1 < argc) {
+            poll_offset_ms = (uint32_t)atoi(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        paths.push_back(HOST_PRESET_DIR "/sdkconfig.defaults");
+        paths.push_back(HOST_PRESET_DIR "/sdkconfig.defaults.esp32c6.lit");
+    }
+
+    trace_t trace;
+    if (!trace_load(trace_path, &trace)) {
+        fprintf(stderr, "cannot load trace %s\n", trace_path);
+        return 1;
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    printf("trace %s, wakes merged within %u ms\n", trace.name.c_str(), merge_ms);
+    printf("%-28s %4s %4s %7s %6s %8s %8s %8s %8s %8s %8s %8s %9s %8s\n", "preset", "icd", "grid", "poll_ms",
+           "smp_s", "polls/h", "sensor/h", "wakes/h", "shared/h", "alone/h", "samples", "aligned", "reports/h",
+           "active/h");
+    bool ok = true;
+    for (const std::string &path : paths) {
+        preset_t preset;
+        if (!parse_preset(path.c_str(), &preset)) {
+            fprintf(stderr, "cannot read preset %s\n", path.c_str());
+            ok = false;
+            continue;
+        }
+        if (slip_pct >= 0) {
+            preset.slip_pct = (uint8_t)slip_pct;
+        }
+        for (bool coalesce : { false, true }) {
+            run(&preset, &trace, coalesce, merge_ms, poll_offset_ms);
+        }
+    }
+    return ok ? 0 : 1;
+}
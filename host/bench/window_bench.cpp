@@ -0,0 +1,144 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  sensor_window against a brute-force window over every sample.
+
+  usage: window_bench [--hours N] [--seed N]
+
+  Random CO2 samples over --hours (default 48) at random gaps, from
+  seconds up to gaps longer than the window, go into sensor_window and
+  into a list of every sample. After each one the peak and the rounded
+  average of sensor_window must equal those of the samples in the same
+  buckets, the ones less than SENSOR_WINDOW_BUCKETS bucket lengths from
+  the bucket of the newest sample. Runs the Kconfig window and a few
+  others; prints the first mismatch and fails on any.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+
+#include <sdkconfig.h>
+#include <sensor_window.h>
+
+#define HOUR_US (3600 * 1000000LL)
+
+typedef struct {
+    int64_t t_us;
+    uint16_t value;
+} window_sample_t;
+
+static uint32_t next_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Mostly short gaps, now and then a sensor outage of up to twice the window
+static int64_t next_gap_us(uint32_t *rng, uint32_t window_s)
+{
+    uint32_t r = next_random(rng) % 1000;
+    if (r < 5) {
+        return (int64_t)(next_random(rng) % (2 * window_s) + 1) * 1000000;
+    }
+    if (r < 50) {
+        return (int64_t)(next_random(rng) % 600 + 1) * 1000000;
+    }
+    return (int64_t)(next_random(rng) % 10000 + 1) * 1000;
+}
+
+static uint16_t next_value(uint32_t *rng)
+{
+    // a spike in one sample out of 50
+    if (next_random(rng) % 50 == 0) {
+        return (uint16_t)(5000 + next_random(rng) % 35000);
+    }
+    return (uint16_t)(400 + next_random(rng) % 2000);
+}
+
+static bool run_window(uint32_t window_s, uint32_t hours, uint32_t seed)
+{
+    uint32_t rng = seed;
+    int64_t start_us = 1000000;
+    sensor_window_t window;
+    sensor_window_init(&window, window_s, start_us);
+    int64_t bucket_us = window.bucket_us;
+    std::deque<window_sample_t> samples;
+    uint32_t added = 0, mismatches = 0;
+    uint64_t in_window_max = 0;
+
+    for (int64_t t = start_us; t < start_us + (int64_t)hours * HOUR_US; t += next_gap_us(&rng, window_s)) {
+        uint16_t value = next_value(&rng);
+        sensor_window_add(&window, value, t);
+        samples.push_back({ t, value });
+        added++;
+
+        // the buckets still in the window: the newest one and the SENSOR_WINDOW_BUCKETS - 1 before it
+        int64_t newest = (t - start_us) / bucket_us;
+        int64_t oldest = newest - SENSOR_WINDOW_BUCKETS + 1;
+        while (!samples.empty() && (samples.front().t_us - start_us) / bucket_us < oldest) {
+            samples.pop_front();
+        }
+        uint16_t expect_peak = 0;
+        uint64_t sum = 0;
+        for (const window_sample_t &sample : samples) {
+            expect_peak = sample.value > expect_peak ? sample.value : expect_peak;
+            sum += sample.value;
+        }
+        uint16_t expect_average = (uint16_t)((sum + samples.size() / 2) / samples.size());
+        in_window_max = samples.size() > in_window_max ? samples.size() : in_window_max;
+
+        uint16_t peak = 0, average = 0;
+        bool ok = sensor_window_peak(&window, &peak) && sensor_window_average(&window, &average) &&
+                  peak == expect_peak && average == expect_average;
+        if (!ok && mismatches++ == 0) {
+            fprintf(stderr, "window %lu s at %.3f s: peak %u average %u, expected %u %u\n",
+                    (unsigned long)window_s, t / 1e6, peak, average, expect_peak, expect_average);
+        }
+    }
+
+    printf("%10lu %10lu %10lu %12llu %10lu %6s\n", (unsigned long)window_s, (unsigned long)(bucket_us / 1000000),
+           (unsigned long)added, (unsigned long long)in_window_max, (unsigned long)mismatches,
+           mismatches ? "FAIL" : "ok");
+    return mismatches == 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hours = 48;
+    uint32_t seed = 0x5cd41;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            hours = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: window_bench [--hours N] [--seed N]\n");
+            return 1;
+        }
+    }
+    if (hours == 0 || seed == 0) {
+        fprintf(stderr, "--hours and --seed take more than 0\n");
+        return 1;
+    }
+
+    printf("%u h of random samples, %u buckets\n", hours, SENSOR_WINDOW_BUCKETS);
+    printf("%10s %10s %10s %12s %10s %6s\n", "window_s", "bucket_s", "samples", "max_in", "mismatch", "");
+    const uint32_t windows_s[] = { CONFIG_SENSOR_CO2_WINDOW_SEC, 60, 900, 8 * 3600 };
+    bool ok = true;
+    for (uint32_t window_s : windows_s) {
+        ok &= run_window(window_s, hours, seed);
+    }
+    return ok ? 0 : 1;
+}
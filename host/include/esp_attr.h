@@ -0,0 +1,14 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Host stand-in for the ESP-IDF header of the same name: no RTC memory,
+// a simulated reset keeps the process and therefore every static
+
+#pragma once
+
+#define RTC_NOINIT_ATTR
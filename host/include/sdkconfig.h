@@ -0,0 +1,45 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Host build configuration: the Kconfig defaults of main/Kconfig.projbuild
+
+#pragma once
+
+#define CONFIG_SENSOR_SAMPLE_INTERVAL_SEC                       10
+#define CONFIG_SENSOR_LIT_CO2_INTERVAL_SEC                      300
+#define CONFIG_SENSOR_FILTER_EMA                                1
+#define CONFIG_SENSOR_FILTER_EMA_SHIFT                          2
+#define CONFIG_SENSOR_FILTER_MEDIAN_WINDOW                      5
+#define CONFIG_SENSOR_AIR_QUALITY_HYSTERESIS_PCT                5
+#define CONFIG_SENSOR_CO2_WINDOW_SEC                            3600
+#define CONFIG_SENSOR_ADAPTIVE_TOLERANCE_PPM                    10
+#define CONFIG_SENSOR_EVENT_LOG_LEN                             128
+#define CONFIG_SENSOR_HISTORY                                   1
+#define CONFIG_SENSOR_HISTORY_RAM_BLOCKS                        4
+#define CONFIG_SENSOR_HEALTH_MAX_BACKOFF_SEC                    3600
+#define CONFIG_SENSOR_I2C_CLOCK_HZ                              400000
+#define CONFIG_SENSOR_I2C_MIN_CLOCK_HZ                          50000
+#define CONFIG_SENSOR_I2C_FALLBACK_WINDOW                       64
+#define CONFIG_SENSOR_I2C_FALLBACK_ERROR_PCT                    10
+#define CONFIG_SENSOR_I2C_RAISE_AFTER                           2000
+#define CONFIG_SENSOR_REPORT_TEMPERATURE_DEADBAND               10
+#define CONFIG_SENSOR_REPORT_TEMPERATURE_MIN_INTERVAL_SEC       30
+#define CONFIG_SENSOR_REPORT_TEMPERATURE_MAX_INTERVAL_SEC       600
+#define CONFIG_SENSOR_REPORT_HUMIDITY_DEADBAND                  50
+#define CONFIG_SENSOR_REPORT_HUMIDITY_MIN_INTERVAL_SEC          30
+#define CONFIG_SENSOR_REPORT_HUMIDITY_MAX_INTERVAL_SEC          600
+#define CONFIG_SENSOR_REPORT_CO2_DEADBAND                       20
+#define CONFIG_SENSOR_REPORT_CO2_MIN_INTERVAL_SEC               30
+#define CONFIG_SENSOR_REPORT_CO2_MAX_INTERVAL_SEC               600
+#define CONFIG_SENSOR_REPORT_AIR_QUALITY_MIN_INTERVAL_SEC       0
+#define CONFIG_SENSOR_REPORT_AIR_QUALITY_MAX_INTERVAL_SEC       600
+#define CONFIG_SENSOR_CO2_ALARM                                 1
+#define CONFIG_SENSOR_CO2_ALARM_VENTILATE_PPM                   1000
+#define CONFIG_SENSOR_CO2_ALARM_HIGH_PPM                        1400
+#define CONFIG_SENSOR_CO2_ALARM_HYSTERESIS_PPM                  100
+#define CONFIG_SENSOR_CO2_ALARM_DEBOUNCE                        2
@@ -0,0 +1,101 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// esp_err / esp_log for the host build
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_err.h>
+#include <esp_log.h>
+
+#include "host_clock.h"
+#include "host_log.h"
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NOT_FINISHED:      return "ESP_ERR_NOT_FINISHED";
+    default:                        return "UNKNOWN ERROR";
+    }
+}
+
+#define HOST_LOG_MAX_TAGS 8
+
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static struct {
+    const char *tag;
+    esp_log_level_t level;
+} s_tag_levels[HOST_LOG_MAX_TAGS];
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    if (strcmp(tag, "*") == 0) {
+        s_log_level = level;
+        return;
+    }
+    for (auto &entry : s_tag_levels) {
+        if (entry.tag == NULL || strcmp(entry.tag, tag) == 0) {
+            entry.tag = tag;
+            entry.level = level;
+            return;
+        }
+    }
+}
+
+esp_log_level_t esp_log_level_get(const char *tag)
+{
+    for (auto &entry : s_tag_levels) {
+        if (entry.tag && strcmp(entry.tag, tag) == 0) {
+            return entry.level;
+        }
+    }
+    return s_log_level;
+}
+
+static bool s_log_mute;
+static uint64_t s_log_bytes;
+
+void host_log_mute(bool mute)
+{
+    s_log_mute = mute;
+}
+
+uint64_t host_log_bytes(void)
+{
+    return s_log_bytes;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    char line[256];
+    int prefix = snprintf(line, sizeof(line), "%c (%lld) %s: ", letters[level],
+                          (long long)(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line + prefix, sizeof(line) - prefix, format, args);
+    va_end(args);
+    s_log_bytes += prefix + len + 1;
+    if (!s_log_mute) {
+        fprintf(stderr, "%s\n", line);
+    }
+}
@@ -0,0 +1,175 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <esp_timer.h>
+
+#include "host_clock.h"
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t alarm_us;
+    uint64_t period_us;
+    bool active;
+};
+
+static int64_t s_now_us;
+static std::vector<esp_timer *> s_timers;
+static host_timer_observer_t s_observer;
+static void *s_observer_arg;
+
+void host_clock_reset(void)
+{
+    for (esp_timer *timer : s_timers) {
+        delete timer;
+    }
+    s_timers.clear();
+    s_now_us = 0;
+}
+
+void host_clock_advance_us(int64_t us)
+{
+    s_now_us += us;
+}
+
+void host_timer_set_observer(host_timer_observer_t observer, void *arg)
+{
+    s_observer = observer;
+    s_observer_arg = arg;
+}
+
+static esp_timer *next_due(int64_t t_us)
+{
+    esp_timer *next = nullptr;
+    for (esp_timer *timer : s_timers) {
+        if (timer->active && timer->alarm_us <= t_us && (!next || timer->alarm_us < next->alarm_us)) {
+            next = timer;
+        }
+    }
+    return next;
+}
+
+void host_timer_run_until(int64_t t_us)
+{
+    while (esp_timer *timer = next_due(t_us)) {
+        // a callback that blocked past the alarm delays the dispatch, like the esp_timer task does
+        s_now_us = std::max(s_now_us, timer->alarm_us);
+        if (timer->period_us) {
+            timer->alarm_us += timer->period_us;
+        } else {
+            timer->active = false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        timer->callback(timer->arg);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (s_observer) {
+            s_observer(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), s_observer_arg);
+        }
+    }
+    s_now_us = std::max(s_now_us, t_us);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer *timer = new esp_timer{create_args->callback, create_args->arg, create_args->name, 0, 0, false};
+    s_timers.push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = s_now_us + (int64_t)timeout_us;
+    timer->period_us = 0;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer == nullptr || period == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = s_now_us + (int64_t)period;
+    timer->period_us = period;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = s_now_us + (int64_t)timeout_us;
+    if (timer->period_us) {
+        timer->period_us = timeout_us;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_timers.erase(std::remove(s_timers.begin(), s_timers.end(), timer), s_timers.end());
+    delete timer;
+    return ESP_OK;
+}
+
+const char *host_timer_name(esp_timer_handle_t timer)
+{
+    return timer->name ? timer->name : "";
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->active;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
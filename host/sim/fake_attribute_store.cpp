@@ -0,0 +1,85 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <map>
+#include <tuple>
+
+#include "fake_attribute_store.h"
+
+using attr_path_t = std::tuple<uint16_t, uint32_t, uint32_t>;
+
+static std::map<attr_path_t, fake_attr_val_t> s_attributes;
+static fake_attr_stats_t s_stats;
+
+static bool same_value(const fake_attr_val_t *a, const fake_attr_val_t *b)
+{
+    if (a->type != b->type) {
+        return false;
+    }
+    switch (a->type) {
+    case FAKE_ATTR_TYPE_INT16:  return a->val.i16 == b->val.i16;
+    case FAKE_ATTR_TYPE_UINT16: return a->val.u16 == b->val.u16;
+    case FAKE_ATTR_TYPE_UINT8:  return a->val.u8 == b->val.u8;
+    case FAKE_ATTR_TYPE_FLOAT:  return a->val.f == b->val.f;
+    }
+    return false;
+}
+
+void fake_attr_reset(void)
+{
+    s_attributes.clear();
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void fake_attr_schedule(void)
+{
+    s_stats.schedules++;
+}
+
+esp_err_t fake_attr_update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const fake_attr_val_t *val)
+{
+    if (val == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_stats.updates++;
+
+    attr_path_t path(endpoint_id, cluster_id, attribute_id);
+    auto it = s_attributes.find(path);
+    if (it == s_attributes.end() || !same_value(&it->second, val)) {
+        s_attributes[path] = *val;
+        s_stats.reports++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t fake_attr_report(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const fake_attr_val_t *val)
+{
+    if (val == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_attributes[attr_path_t(endpoint_id, cluster_id, attribute_id)] = *val;
+    s_stats.reports++;
+    return ESP_OK;
+}
+
+esp_err_t fake_attr_get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, fake_attr_val_t *val)
+{
+    auto it = s_attributes.find(attr_path_t(endpoint_id, cluster_id, attribute_id));
+    if (it == s_attributes.end()) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *val = it->second;
+    return ESP_OK;
+}
+
+const fake_attr_stats_t *fake_attr_stats(void)
+{
+    return &s_stats;
+}
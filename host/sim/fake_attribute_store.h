@@ -0,0 +1,58 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Stand-in for the esp_matter attribute store on the host.
+
+  Counts the work the Matter side would do: hops onto the Matter thread
+  (ScheduleLambda), attribute::update calls, and reports, i.e. updates that
+  change the stored value and therefore dirty the path for subscribers.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <esp_err.h>
+
+typedef enum {
+    FAKE_ATTR_TYPE_INT16,
+    FAKE_ATTR_TYPE_UINT16,
+    FAKE_ATTR_TYPE_UINT8,
+    FAKE_ATTR_TYPE_FLOAT,
+} fake_attr_type_t;
+
+typedef struct {
+    fake_attr_type_t type;
+    union {
+        int16_t i16;
+        uint16_t u16;
+        uint8_t u8;
+        float f;
+    } val;
+} fake_attr_val_t;
+
+typedef struct {
+    uint64_t schedules;
+    uint64_t updates;
+    uint64_t reports;
+} fake_attr_stats_t;
+
+void fake_attr_reset(void);
+
+// Account for one ScheduleLambda onto the Matter thread
+void fake_attr_schedule(void);
+
+esp_err_t fake_attr_update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const fake_attr_val_t *val);
+
+// Mirrors attribute::report: stores the value and reports it even if unchanged
+esp_err_t fake_attr_report(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const fake_attr_val_t *val);
+
+esp_err_t fake_attr_get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, fake_attr_val_t *val);
+
+const fake_attr_stats_t *fake_attr_stats(void);
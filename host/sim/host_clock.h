@@ -0,0 +1,36 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Virtual clock behind the host esp_timer. Time only moves when the
+  benchmark runs timers or when simulated code waits (bus delays), so a
+  24 h trace replays in well under a second.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <esp_timer.h>
+
+// Called after every timer dispatch with the host CPU time the callback took
+using host_timer_observer_t = void (*)(esp_timer_handle_t timer, int64_t cpu_ns, void *arg);
+
+// Drop all timers and rewind the clock to 0
+void host_clock_reset(void);
+
+// Move time forward without dispatching timers, used for blocking waits
+void host_clock_advance_us(int64_t us);
+
+// Dispatch every timer alarm up to and including t_us, then set the clock to t_us
+void host_timer_run_until(int64_t t_us);
+
+void host_timer_set_observer(host_timer_observer_t observer, void *arg);
+
+// Name given in esp_timer_create_args_t, "" if none
+const char *host_timer_name(esp_timer_handle_t timer);
@@ -0,0 +1,25 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Log output of the host build. esp_log_write formats every line that
+  passes the level check, as the device does before handing it to the
+  UART, counts the bytes and prints them to stderr unless muted.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// 115200 baud 8N1 console UART: 10 bit times per byte
+#define HOST_LOG_UART_NS_PER_BYTE 86806
+
+void host_log_mute(bool mute);
+
+// bytes formatted since start, including the "I (time) tag: " prefix and newline
+uint64_t host_log_bytes(void);
@@ -0,0 +1,404 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include <scd41_mode.h>
+
+#include "host_clock.h"
+#include "scd41_sim.h"
+
+// i2cdev's rate before anyone sets one
+#define DEFAULT_CLOCK_HZ                100000
+
+#define PERIODIC_INTERVAL_US            5000000
+#define LOW_POWER_PERIODIC_INTERVAL_US  30000000
+
+// Repeatability from the SCD41 datasheet, used as 1 sigma
+#define NOISE_CO2_PPM                   5.0f
+#define NOISE_TEMPERATURE_C             0.05f
+#define NOISE_HUMIDITY_PCT              0.2f
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Irwin-Hall approximation of a standard normal sample
+static float gaussian(uint32_t *state)
+{
+    float sum = 0;
+    for (int i = 0; i < 4; i++) {
+        sum += (float)xorshift32(state) / 4294967296.0f;
+    }
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+static uint16_t clamp_u16(float v)
+{
+    if (v < 0) {
+        return 0;
+    }
+    if (v > 65535) {
+        return 65535;
+    }
+    return (uint16_t)lrintf(v);
+}
+
+static void take_measurement(scd41_sim_t *sim, int64_t at_us)
+{
+    trace_point_t env = trace_at(sim->trace, at_us);
+    float co2 = env.co2_ppm + gaussian(&sim->rng) * NOISE_CO2_PPM;
+    float t = env.temperature_c + gaussian(&sim->rng) * NOISE_TEMPERATURE_C;
+    float rh = env.humidity_pct + gaussian(&sim->rng) * NOISE_HUMIDITY_PCT;
+
+    sim->data[0] = sim->rht_only ? 0 : clamp_u16(co2);
+    sim->data[1] = clamp_u16((t + 45.0f) * 65536.0f / 175.0f);
+    sim->data[2] = clamp_u16(rh * 65536.0f / 100.0f);
+    sim->data_ready = true;
+    sim->stats.measurements++;
+}
+
+// Complete every measurement that finished by now
+static void advance(scd41_sim_t *sim)
+{
+    int64_t now = esp_timer_get_time();
+    switch (sim->mode) {
+    case SCD41_SIM_PERIODIC:
+    case SCD41_SIM_LOW_POWER_PERIODIC:
+        if (sim->stalled) {
+            // the measurement clock keeps running, nothing becomes ready
+            while (now >= sim->measurement_start_us + sim->measurement_period_us) {
+                sim->measurement_start_us += sim->measurement_period_us;
+            }
+            break;
+        }
+        while (now >= sim->measurement_start_us + sim->measurement_period_us) {
+            sim->measurement_start_us += sim->measurement_period_us;
+            take_measurement(sim, sim->measurement_start_us);
+        }
+        break;
+    case SCD41_SIM_SINGLE_SHOT:
+        if (now >= sim->measurement_start_us + sim->measurement_period_us) {
+            sim->mode = SCD41_SIM_IDLE;
+            if (sim->stalled) {
+                break;
+            }
+            take_measurement(sim, sim->measurement_start_us + sim->measurement_period_us);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void account(scd41_sim_t *sim)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - sim->accounted_us;
+    sim->accounted_us = now;
+    switch (sim->mode) {
+    case SCD41_SIM_PERIODIC:            sim->stats.periodic_us += elapsed; break;
+    case SCD41_SIM_LOW_POWER_PERIODIC:  sim->stats.low_power_periodic_us += elapsed; break;
+    case SCD41_SIM_IDLE:
+    case SCD41_SIM_SINGLE_SHOT:         sim->stats.idle_us += elapsed; break;
+    default:                            break;
+    }
+}
+
+static void respond(scd41_sim_t *sim, const uint16_t *words, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *p = sim->response + i * 3;
+        p[0] = (uint8_t)(words[i] >> 8);
+        p[1] = (uint8_t)words[i];
+        p[2] = scd41_crc8(p, 2);
+    }
+    sim->response_len = count * 3;
+}
+
+// True if an injected fault fails this transaction
+static bool inject_fault(scd41_sim_t *sim, int64_t now)
+{
+    const scd41_sim_faults_t *faults = &sim->faults;
+    if (faults->stall_at_us && now >= faults->stall_at_us) {
+        // fires once
+        sim->stalled = true;
+        sim->faults.stall_at_us = 0;
+    }
+    if (faults->stuck_at_us && now >= faults->stuck_at_us) {
+        sim->bus_stuck = true;
+        sim->faults.stuck_at_us = 0;
+    }
+    if (sim->bus_stuck || (now >= faults->absent_from_us && now < faults->absent_until_us)) {
+        sim->stats.injected++;
+        sim->stats.nacks++;
+        return true;
+    }
+    return false;
+}
+
+// A transaction above the wiring's clock limit that goes wrong
+static bool over_clock_limit(scd41_sim_t *sim)
+{
+    const scd41_sim_faults_t *faults = &sim->faults;
+    if (faults->clock_limit_hz == 0 || sim->clock_hz <= faults->clock_limit_hz) {
+        return false;
+    }
+    if (xorshift32(&sim->fault_rng) % 1000000 >= faults->over_limit_error_ppm) {
+        return false;
+    }
+    sim->stats.injected++;
+    return true;
+}
+
+// START, the address and len bytes each with their ACK bit, STOP, at the bus clock
+static void wire(scd41_sim_t *sim, size_t len)
+{
+    int64_t us = ((int64_t)(2 + 9 * (1 + len)) * 1000000 + sim->clock_hz - 1) / sim->clock_hz;
+    sim->stats.wire_us += us;
+    host_clock_advance_us(us);
+}
+
+static void start_measurement(scd41_sim_t *sim, scd41_sim_mode_t mode, int64_t duration_us, bool rht_only)
+{
+    sim->mode = mode;
+    sim->measurement_start_us = esp_timer_get_time();
+    sim->measurement_period_us = duration_us;
+    sim->rht_only = rht_only;
+    sim->data_ready = false;
+}
+
+static bool is_periodic(const scd41_sim_t *sim)
+{
+    return sim->mode == SCD41_SIM_PERIODIC || sim->mode == SCD41_SIM_LOW_POWER_PERIODIC;
+}
+
+static esp_err_t write_command(scd41_sim_t *sim, const uint8_t *data, size_t len)
+{
+    int64_t now = esp_timer_get_time();
+    sim->stats.writes++;
+    account(sim);
+    advance(sim);
+
+    if (inject_fault(sim, now)) {
+        return ESP_FAIL;
+    }
+    if (over_clock_limit(sim)) {
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+
+    uint16_t cmd = len >= 2 ? (uint16_t)((data[0] << 8) | data[1]) : 0;
+
+    if (sim->mode == SCD41_SIM_SLEEP) {
+        // wake_up is never acknowledged, the sensor just starts up
+        if (cmd == SCD41_CMD_WAKE_UP) {
+            sim->mode = SCD41_SIM_IDLE;
+            sim->stalled = false;
+            sim->busy_until_us = now + SCD41_DELAY_WAKE_UP_MS * 1000;
+        }
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+    if (len != 2 || now < sim->busy_until_us) {
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+
+    sim->response_len = 0;
+    int64_t exec_ms = 0;
+
+    // during periodic measurement only these commands are accepted
+    if (is_periodic(sim) && cmd != SCD41_CMD_READ_MEASUREMENT && cmd != SCD41_CMD_GET_DATA_READY_STATUS &&
+        cmd != SCD41_CMD_STOP_PERIODIC_MEASUREMENT) {
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+
+    switch (cmd) {
+    case SCD41_CMD_WAKE_UP:
+        // already awake: still no ACK
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    case SCD41_CMD_POWER_DOWN:
+        sim->mode = SCD41_SIM_SLEEP;
+        sim->data_ready = false;
+        exec_ms = SCD41_DELAY_POWER_DOWN_MS;
+        break;
+    case SCD41_CMD_REINIT:
+        sim->data_ready = false;
+        sim->stalled = false;
+        exec_ms = SCD41_DELAY_REINIT_MS;
+        break;
+    case SCD41_CMD_GET_SERIAL_NUMBER: {
+        static const uint16_t serial[3] = { 0x5a1e, 0x0d41, 0x3b07 };
+        respond(sim, serial, 3);
+        exec_ms = SCD41_DELAY_GET_SERIAL_NUMBER_MS;
+        break;
+    }
+    case SCD41_CMD_START_PERIODIC_MEASUREMENT:
+        start_measurement(sim, SCD41_SIM_PERIODIC, PERIODIC_INTERVAL_US, false);
+        break;
+    case SCD41_CMD_START_LOW_POWER_PERIODIC:
+        start_measurement(sim, SCD41_SIM_LOW_POWER_PERIODIC, LOW_POWER_PERIODIC_INTERVAL_US, false);
+        break;
+    case SCD41_CMD_STOP_PERIODIC_MEASUREMENT:
+        sim->mode = SCD41_SIM_IDLE;
+        exec_ms = SCD41_DELAY_STOP_PERIODIC_MS;
+        break;
+    case SCD41_CMD_MEASURE_SINGLE_SHOT:
+        start_measurement(sim, SCD41_SIM_SINGLE_SHOT, SCD41_DELAY_MEASURE_SINGLE_SHOT_MS * 1000, false);
+        sim->stats.shots++;
+        exec_ms = SCD41_DELAY_MEASURE_SINGLE_SHOT_MS;
+        break;
+    case SCD41_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY:
+        start_measurement(sim, SCD41_SIM_SINGLE_SHOT, SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS * 1000, true);
+        sim->stats.rht_shots++;
+        exec_ms = SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS;
+        break;
+    case SCD41_CMD_GET_DATA_READY_STATUS: {
+        uint16_t status = sim->data_ready ? 0x8006 : 0x8000;
+        respond(sim, &status, 1);
+        exec_ms = SCD41_DELAY_GET_DATA_READY_MS;
+        break;
+    }
+    case SCD41_CMD_READ_MEASUREMENT:
+        // no new data since the last read
+        if (!sim->data_ready) {
+            sim->stats.nacks++;
+            return ESP_FAIL;
+        }
+        respond(sim, sim->data, 3);
+        sim->data_ready = false;
+        exec_ms = SCD41_DELAY_READ_MEASUREMENT_MS;
+        break;
+    default:
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+
+    sim->busy_until_us = now + exec_ms * 1000;
+    return ESP_OK;
+}
+
+static esp_err_t sim_write(void *ctx, const uint8_t *data, size_t len)
+{
+    scd41_sim_t *sim = (scd41_sim_t *) ctx;
+    esp_err_t err = write_command(sim, data, len);
+    // a NACK ends the transaction after the byte that was not acknowledged, the address at the latest
+    wire(sim, err == ESP_OK ? len : 0);
+    return err;
+}
+
+static esp_err_t read_response(scd41_sim_t *sim, uint8_t *data, size_t len)
+{
+    int64_t now = esp_timer_get_time();
+    sim->stats.reads++;
+    account(sim);
+    advance(sim);
+
+    if (inject_fault(sim, now)) {
+        return ESP_FAIL;
+    }
+    if (now < sim->busy_until_us || sim->response_len == 0 || len > sim->response_len) {
+        sim->stats.nacks++;
+        return ESP_FAIL;
+    }
+    memcpy(data, sim->response, len);
+    sim->response_len = 0;
+    if (sim->faults.crc_error_ppm && xorshift32(&sim->fault_rng) % 1000000 < sim->faults.crc_error_ppm) {
+        data[2] ^= 0x01;
+        sim->stats.injected++;
+    } else if (over_clock_limit(sim)) {
+        data[1] ^= 0x10;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t sim_read(void *ctx, uint8_t *data, size_t len)
+{
+    scd41_sim_t *sim = (scd41_sim_t *) ctx;
+    esp_err_t err = read_response(sim, data, len);
+    wire(sim, err == ESP_OK ? len : 0);
+    return err;
+}
+
+static esp_err_t sim_recover(void *ctx)
+{
+    scd41_sim_t *sim = (scd41_sim_t *) ctx;
+    sim->stats.bus_recoveries++;
+    sim->bus_stuck = false;
+    // the clock-out takes about 0.1 ms
+    host_clock_advance_us(100);
+    return ESP_OK;
+}
+
+static void sim_delay_ms(void *ctx, uint32_t ms)
+{
+    host_clock_advance_us((int64_t)ms * 1000);
+}
+
+void scd41_sim_init(scd41_sim_t *sim, const trace_t *trace, uint32_t seed)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->trace = trace;
+    sim->rng = seed ? seed : 1;
+    sim->mode = SCD41_SIM_IDLE;
+    sim->clock_hz = DEFAULT_CLOCK_HZ;
+    sim->accounted_us = esp_timer_get_time();
+}
+
+void scd41_sim_set_faults(scd41_sim_t *sim, const scd41_sim_faults_t *faults)
+{
+    sim->faults = *faults;
+    // own sequence, so the readings stay those of a run without faults
+    sim->fault_rng = 0x9e3779b9;
+}
+
+void scd41_sim_bind(scd41_sim_t *sim, scd41_t *dev)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->bus.write = sim_write;
+    dev->bus.read = sim_read;
+    dev->bus.delay_ms = sim_delay_ms;
+    dev->bus.recover = sim_recover;
+    dev->bus.ctx = sim;
+}
+
+esp_err_t scd41_sim_set_clock(void *sim, uint32_t hz)
+{
+    if (hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((scd41_sim_t *) sim)->clock_hz = hz;
+    return ESP_OK;
+}
+
+const scd41_sim_stats_t *scd41_sim_get_stats(scd41_sim_t *sim)
+{
+    account(sim);
+    return &sim->stats;
+}
+
+double scd41_sim_charge_mas(const scd41_sim_stats_t *stats)
+{
+    double uas = (double)stats->periodic_us * SCD41_CURRENT_PERIODIC_UA / 1e6 +
+                 (double)stats->low_power_periodic_us * SCD41_CURRENT_LOW_POWER_PERIODIC_UA / 1e6 +
+                 (double)stats->idle_us * SCD41_CURRENT_IDLE_UA / 1e6 +
+                 (double)stats->shots * SCD41_CHARGE_SINGLE_SHOT_UAS +
+                 (double)stats->rht_shots * SCD41_CHARGE_SINGLE_SHOT_RHT_UAS;
+    return uas / 1000;
+}
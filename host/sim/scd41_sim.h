@@ -0,0 +1,119 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Register-level SCD41 stand-in for the host build.
+
+  Behaves like the sensor on the wire: 16 bit commands, CRC-8 protected
+  response words, NACK while a command is still executing or when the
+  command is not allowed in the current mode, 5 s periodic / 30 s
+  low-power periodic / single-shot measurement timing. Readings come from
+  a trace_t plus deterministic noise and the sensor's tick quantisation.
+  Every transaction takes its bits on the wire at the bus clock (100 kHz
+  until scd41_sim_set_clock() says otherwise) off the virtual clock.
+  scd41_sim_faults_t injects the failures the sensor task has to survive.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <scd41.h>
+
+#include "trace.h"
+
+typedef enum {
+    SCD41_SIM_IDLE,
+    SCD41_SIM_PERIODIC,
+    SCD41_SIM_LOW_POWER_PERIODIC,
+    SCD41_SIM_SINGLE_SHOT,
+    SCD41_SIM_SLEEP,
+} scd41_sim_mode_t;
+
+// Injected failures, a zero time leaves that fault off
+typedef struct {
+    // sensor unplugged: no transaction is acknowledged in [absent_from_us, absent_until_us)
+    int64_t absent_from_us;
+    int64_t absent_until_us;
+    // a transaction at or after this time leaves SDA held low, nothing works until a bus recovery
+    int64_t stuck_at_us;
+    // sensor firmware hang at this time: no more measurements complete until reinit or a power cycle
+    int64_t stall_at_us;
+    // chance per response of a corrupted CRC byte, parts per million
+    uint32_t crc_error_ppm;
+    // wiring that does not make a clock above clock_limit_hz: each transaction then fails with this
+    // chance, a write NACKed, a read garbled into a CRC error
+    uint32_t clock_limit_hz;
+    uint32_t over_limit_error_ppm;
+} scd41_sim_faults_t;
+
+typedef struct {
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t nacks;
+    uint32_t measurements;
+    // sensor time per power state, single shots counted separately
+    int64_t periodic_us;
+    int64_t low_power_periodic_us;
+    int64_t idle_us;
+    uint32_t shots;
+    uint32_t rht_shots;
+    // transactions failed by an injected fault
+    uint32_t injected;
+    uint32_t bus_recoveries;
+    // time the bus was busy with transactions
+    int64_t wire_us;
+} scd41_sim_stats_t;
+
+typedef struct {
+    const trace_t *trace;
+    uint32_t rng;
+
+    scd41_sim_mode_t mode;
+    // start of the measurement currently in progress
+    int64_t measurement_start_us;
+    int64_t measurement_period_us;
+    // single shot without CO2
+    bool rht_only;
+
+    // the sensor NACKs everything until the running command completes
+    int64_t busy_until_us;
+
+    bool data_ready;
+    uint16_t data[3];
+
+    uint8_t response[9];
+    size_t response_len;
+
+    uint32_t clock_hz;
+
+    scd41_sim_faults_t faults;
+    uint32_t fault_rng;
+    bool bus_stuck;
+    bool stalled;
+
+    scd41_sim_stats_t stats;
+    // stats time accounted up to here
+    int64_t accounted_us;
+} scd41_sim_t;
+
+void scd41_sim_init(scd41_sim_t *sim, const trace_t *trace, uint32_t seed);
+
+void scd41_sim_set_faults(scd41_sim_t *sim, const scd41_sim_faults_t *faults);
+
+// Point dev at the simulated sensor, bus delays advance the virtual clock
+void scd41_sim_bind(scd41_sim_t *sim, scd41_t *dev);
+
+// SCL rate of the simulated bus, takes the scd41_sim_t as ctx to serve as scd41_clock_t::set
+esp_err_t scd41_sim_set_clock(void *sim, uint32_t hz);
+
+// Stats with the time up to now accounted
+const scd41_sim_stats_t *scd41_sim_get_stats(scd41_sim_t *sim);
+
+// Sensor charge in mA·s from the time per power state and the shots, using the scd41_mode.h currents
+double scd41_sim_charge_mas(const scd41_sim_stats_t *stats);
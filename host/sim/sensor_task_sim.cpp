@@ -0,0 +1,54 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// Host stand-in for the sensor task: one-shot esp_timer re-armed with the step's sleep time
+
+#include <esp_timer.h>
+
+#include <scd4x_sensor.h>
+
+static esp_timer_handle_t s_timer;
+
+static void sensor_task_cb(void *arg)
+{
+    uint32_t wait_ms = sensor_task_step();
+    esp_timer_start_once(s_timer, (uint64_t)wait_ms * 1000);
+}
+
+esp_err_t sensor_task_create(void)
+{
+    if (s_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_timer_create_args_t args = {
+        .callback = sensor_task_cb,
+        .name = "sensor_task",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return esp_timer_start_once(s_timer, 0);
+}
+
+void sensor_task_wake(void)
+{
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+        esp_timer_start_once(s_timer, 0);
+    }
+}
+
+void sensor_task_delete(void)
+{
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+        esp_timer_delete(s_timer);
+        s_timer = NULL;
+    }
+}
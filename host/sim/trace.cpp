@@ -0,0 +1,67 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "trace.h"
+
+bool trace_load(const char *path, trace_t *trace)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+
+    const char *base = strrchr(path, '/');
+    trace->name = base ? base + 1 : path;
+    trace->points.clear();
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        long long t_s;
+        trace_point_t p;
+        if (sscanf(line, "%lld,%f,%f,%f", &t_s, &p.co2_ppm, &p.temperature_c, &p.humidity_pct) == 4) {
+            p.t_s = t_s;
+            trace->points.push_back(p);
+        }
+    }
+    fclose(f);
+    return trace->points.size() >= 2;
+}
+
+int64_t trace_duration_us(const trace_t *trace)
+{
+    return (trace->points.back().t_s - trace->points.front().t_s) * 1000000;
+}
+
+trace_point_t trace_at(const trace_t *trace, int64_t t_us)
+{
+    const std::vector<trace_point_t> &points = trace->points;
+    double t_s = points.front().t_s + t_us / 1e6;
+    if (t_s >= points.back().t_s) {
+        return points.back();
+    }
+
+    auto hi = std::upper_bound(points.begin(), points.end(), t_s,
+                               [](double t, const trace_point_t &p) { return t < p.t_s; });
+    auto lo = hi - 1;
+    float k = (float)((t_s - lo->t_s) / (double)(hi->t_s - lo->t_s));
+
+    trace_point_t p;
+    p.t_s = (int64_t)t_s;
+    p.co2_ppm = lo->co2_ppm + (hi->co2_ppm - lo->co2_ppm) * k;
+    p.temperature_c = lo->temperature_c + (hi->temperature_c - lo->temperature_c) * k;
+    p.humidity_pct = lo->humidity_pct + (hi->humidity_pct - lo->humidity_pct) * k;
+    return p;
+}
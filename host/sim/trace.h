@@ -0,0 +1,41 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Environment traces replayed by the simulated sensor.
+
+  CSV, one row per point: time_s,co2_ppm,temperature_c,humidity_pct
+  Lines starting with '#' are comments. Values between points are
+  interpolated linearly; the simulated sensor adds its own noise.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+typedef struct {
+    int64_t t_s;
+    float co2_ppm;
+    float temperature_c;
+    float humidity_pct;
+} trace_point_t;
+
+typedef struct {
+    std::string name;
+    std::vector<trace_point_t> points;
+} trace_t;
+
+bool trace_load(const char *path, trace_t *trace);
+
+int64_t trace_duration_us(const trace_t *trace);
+
+// Interpolated environment at t_us, clamped to the last point
+trace_point_t trace_at(const trace_t *trace, int64_t t_us);
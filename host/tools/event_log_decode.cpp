@@ -0,0 +1,85 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Decode an event log dump ("matter esp evlog hex") into text.
+
+  usage: event_log_decode [dump.txt]     (stdin without an argument)
+
+  Every line that is exactly one hex encoded record is decoded with the
+  same event_log_format() the device uses; anything else (prompts, other
+  log output) is skipped, so a raw console capture can be fed in.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <event_log.h>
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parse_record(const char *line, uint8_t raw[EVENT_LOG_RECORD_SIZE])
+{
+    size_t len = strlen(line);
+    while (len && isspace((unsigned char)line[len - 1])) {
+        len--;
+    }
+    if (len != 2 * EVENT_LOG_RECORD_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < EVENT_LOG_RECORD_SIZE; i++) {
+        int hi = hex_nibble(line[2 * i]), lo = hex_nibble(line[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        raw[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1 && (in = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    char line[256];
+    unsigned records = 0, gaps = 0;
+    int last_seq = -1;
+    while (fgets(line, sizeof(line), in)) {
+        uint8_t raw[EVENT_LOG_RECORD_SIZE];
+        if (!parse_record(line, raw)) {
+            continue;
+        }
+        event_log_record_t record;
+        event_log_decode(raw, &record);
+        if (last_seq >= 0 && record.seq != (uint8_t)(last_seq + 1)) {
+            gaps++;
+        }
+        last_seq = record.seq;
+
+        char text[128];
+        event_log_format(&record, text, sizeof(text));
+        printf("%s\n", text);
+        records++;
+    }
+    fprintf(stderr, "%u records, %u sequence gaps\n", records, gaps);
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Decode a sample history dump ("matter esp history hex") into CSV.
+
+  usage: history_decode [dump.txt]     (stdin without an argument)
+
+  Every line that is one hex encoded block (header and used data, the
+  device leaves out the erased tail) is checked and decoded with
+  sensor_history_decode(); anything else is skipped, so a raw console
+  capture can be fed in. Blocks with a bad checksum are counted.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sensor_history.h>
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parse_block(const char *line, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE])
+{
+    size_t len = strlen(line);
+    while (len && isspace((unsigned char)line[len - 1])) {
+        len--;
+    }
+    if (len % 2 || len < 2 * SENSOR_HISTORY_HEADER_SIZE || len > 2 * SENSOR_HISTORY_BLOCK_SIZE) {
+        return false;
+    }
+    memset(block, 0xff, SENSOR_HISTORY_BLOCK_SIZE);
+    for (size_t i = 0; i < len / 2; i++) {
+        int hi = hex_nibble(line[2 * i]), lo = hex_nibble(line[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        block[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1 && (in = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    char line[2 * SENSOR_HISTORY_BLOCK_SIZE + 16];
+    unsigned blocks = 0, samples = 0, bad = 0;
+    printf("boot,sensor,time_s,co2_ppm,temperature_c,humidity_pct\n");
+    while (fgets(line, sizeof(line), in)) {
+        uint8_t block[SENSOR_HISTORY_BLOCK_SIZE];
+        if (!parse_block(line, block)) {
+            continue;
+        }
+        sensor_history_block_info_t info;
+        if (!sensor_history_decode(block, &info, NULL, NULL)) {
+            bad++;
+            continue;
+        }
+        sensor_history_print_block(block, false);
+        blocks++;
+        samples += info.count;
+    }
+    fprintf(stderr, "%u samples in %u blocks, %u bad blocks\n", samples, blocks, bad);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Create and apply delta OTA patches (ota_delta.h).
+
+  usage: ota_delta diff old.bin new.bin patch.bin
+         ota_delta apply old.bin patch.bin new.bin
+
+  old.bin must be the exact app image the devices run, as built
+  (build/<project>.bin). diff applies the patch again before writing it
+  and refuses to write one that does not rebuild new.bin. The patch is
+  then wrapped like a full image, e.g. with
+  connectedhomeip/src/app/ota_image_tool.py create ... patch.bin patch.ota
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include <ota_delta.h>
+
+#include "ota_delta_diff.h"
+
+// BDX block size of the OTA requestor
+#define PIECE_SIZE 1024
+
+static bool read_file(const char *path, std::vector<uint8_t> *data)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    data->clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const char *path, const std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+        fprintf(stderr, "cannot write %s\n", path);
+        if (f) {
+            fclose(f);
+        }
+        return false;
+    }
+    return fclose(f) == 0;
+}
+
+static int diff(const char *old_path, const char *new_path, const char *patch_path)
+{
+    std::vector<uint8_t> old_image, new_image, rebuilt;
+    if (!read_file(old_path, &old_image) || !read_file(new_path, &new_image)) {
+        return 1;
+    }
+    ota_delta_diff_stats_t stats;
+    std::vector<uint8_t> patch = ota_delta_diff(old_image, new_image, &stats);
+    esp_err_t err = ota_delta_apply_image(old_image, patch, PIECE_SIZE, &rebuilt);
+    if (err != ESP_OK || rebuilt != new_image) {
+        fprintf(stderr, "patch does not rebuild %s (0x%x)\n", new_path, err);
+        return 1;
+    }
+    if (!write_file(patch_path, patch)) {
+        return 1;
+    }
+    printf("%s: %zu bytes, %.1f%% of %zu; copied %u, added %u, new %u bytes\n", patch_path, patch.size(),
+           100.0 * patch.size() / new_image.size(), new_image.size(), stats.copied, stats.added, stats.data);
+    return 0;
+}
+
+static int apply(const char *old_path, const char *patch_path, const char *new_path)
+{
+    std::vector<uint8_t> old_image, patch, new_image;
+    if (!read_file(old_path, &old_image) || !read_file(patch_path, &patch)) {
+        return 1;
+    }
+    esp_err_t err = ota_delta_apply_image(old_image, patch, PIECE_SIZE, &new_image);
+    if (err == ESP_ERR_INVALID_STATE) {
+        fprintf(stderr, "%s is not the image %s was made from\n", old_path, patch_path);
+        return 1;
+    }
+    if (err != ESP_OK) {
+        fprintf(stderr, "%s: error 0x%x\n", patch_path, err);
+        return 1;
+    }
+    return write_file(new_path, new_image) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 5 && strcmp(argv[1], "diff") == 0) {
+        return diff(argv[2], argv[3], argv[4]);
+    }
+    if (argc == 5 && strcmp(argv[1], "apply") == 0) {
+        return apply(argv[2], argv[3], argv[4]);
+    }
+    fprintf(stderr, "usage: ota_delta diff old.bin new.bin patch.bin\n"
+                    "       ota_delta apply old.bin patch.bin new.bin\n");
+    return 1;
+}
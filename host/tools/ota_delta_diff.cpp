@@ -0,0 +1,419 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <ota_delta.h>
+
+#include "ota_delta_diff.h"
+
+// zero differences shorter than this stay inside an ADD run
+#define COPY_MIN        4
+#define MATCH_MIN       3
+#define MATCH_MAX       (MATCH_MIN + 31)
+#define HASH_BITS       15
+#define CHAIN_MAX       256
+
+// Prefix doubling with counting sorts, O(n log n)
+static std::vector<int32_t> suffix_array(const uint8_t *s, int32_t n)
+{
+    std::vector<int32_t> sa(n), rank(n), tmp(n), count(std::max(n, 256) + 1);
+    for (int32_t i = 0; i < n; i++) {
+        rank[i] = s[i];
+        count[s[i]]++;
+    }
+    for (int32_t i = 1; i < 256; i++) {
+        count[i] += count[i - 1];
+    }
+    for (int32_t i = n - 1; i >= 0; i--) {
+        sa[--count[s[i]]] = i;
+    }
+    for (int32_t k = 1; k < n; k <<= 1) {
+        // by the second half: suffixes without one first, then in the current order
+        int32_t p = 0;
+        for (int32_t i = n - k; i < n; i++) {
+            tmp[p++] = i;
+        }
+        for (int32_t i = 0; i < n; i++) {
+            if (sa[i] >= k) {
+                tmp[p++] = sa[i] - k;
+            }
+        }
+        // stable by the first half
+        std::fill(count.begin(), count.end(), 0);
+        for (int32_t i = 0; i < n; i++) {
+            count[rank[i]]++;
+        }
+        for (size_t i = 1; i < count.size(); i++) {
+            count[i] += count[i - 1];
+        }
+        for (int32_t i = n - 1; i >= 0; i--) {
+            sa[--count[rank[tmp[i]]]] = tmp[i];
+        }
+        tmp[sa[0]] = 0;
+        int32_t classes = 1;
+        for (int32_t i = 1; i < n; i++) {
+            int32_t a = sa[i - 1], b = sa[i];
+            int32_t a2 = a + k < n ? rank[a + k] : -1;
+            int32_t b2 = b + k < n ? rank[b + k] : -1;
+            if (rank[a] != rank[b] || a2 != b2) {
+                classes++;
+            }
+            tmp[b] = classes - 1;
+        }
+        rank.swap(tmp);
+        if (classes == n) {
+            break;
+        }
+    }
+    return sa;
+}
+
+static int32_t match_len(const uint8_t *a, int32_t a_len, const uint8_t *b, int32_t b_len)
+{
+    int32_t i = 0;
+    int32_t n = std::min(a_len, b_len);
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// Longest match of target in old, its position in *pos
+static int32_t search(const std::vector<int32_t> &sa, const uint8_t *old, int32_t old_size, const uint8_t *target,
+                      int32_t target_len, int32_t *pos)
+{
+    int32_t lo = 0, hi = old_size - 1;
+    while (hi - lo >= 2) {
+        int32_t mid = lo + (hi - lo) / 2;
+        int32_t len = std::min(old_size - sa[mid], target_len);
+        if (memcmp(old + sa[mid], target, len) < 0) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    int32_t lo_len = match_len(old + sa[lo], old_size - sa[lo], target, target_len);
+    int32_t hi_len = match_len(old + sa[hi], old_size - sa[hi], target, target_len);
+    *pos = lo_len >= hi_len ? sa[lo] : sa[hi];
+    return std::max(lo_len, hi_len);
+}
+
+typedef struct {
+    std::vector<uint8_t> bytes;
+    int64_t pending_seek;
+    ota_delta_diff_stats_t *stats;
+} op_writer_t;
+
+static void put_varint(std::vector<uint8_t> *out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out->push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back((uint8_t)value);
+}
+
+static void put_op(op_writer_t *w, ota_delta_op_t op, uint32_t n)
+{
+    // the applier only needs the old position for COPY and ADD
+    if (op != OTA_DELTA_OP_DATA && w->pending_seek != 0) {
+        int32_t seek = (int32_t)w->pending_seek;
+        put_varint(&w->bytes, (((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31)) << 2 | OTA_DELTA_OP_SEEK);
+        w->pending_seek = 0;
+    }
+    put_varint(&w->bytes, n << 2 | op);
+}
+
+// len bytes of target over old: zero differences as COPY, the rest as ADD
+static void put_diff(op_writer_t *w, const uint8_t *old, const uint8_t *target, int32_t len)
+{
+    int32_t add_start = -1;
+    int32_t i = 0;
+    while (i < len) {
+        if (target[i] != old[i]) {
+            if (add_start < 0) {
+                add_start = i;
+            }
+            i++;
+            continue;
+        }
+        int32_t j = i;
+        while (j < len && target[j] == old[j]) {
+            j++;
+        }
+        if (j - i < COPY_MIN && j < len) {
+            if (add_start < 0) {
+                add_start = i;
+            }
+            i = j;
+            continue;
+        }
+        if (add_start >= 0) {
+            put_op(w, OTA_DELTA_OP_ADD, i - add_start);
+            for (int32_t k = add_start; k < i; k++) {
+                w->bytes.push_back((uint8_t)(target[k] - old[k]));
+            }
+            w->stats->added += i - add_start;
+            add_start = -1;
+        }
+        put_op(w, OTA_DELTA_OP_COPY, j - i);
+        w->stats->copied += j - i;
+        i = j;
+    }
+    if (add_start >= 0) {
+        put_op(w, OTA_DELTA_OP_ADD, len - add_start);
+        for (int32_t k = add_start; k < len; k++) {
+            w->bytes.push_back((uint8_t)(target[k] - old[k]));
+        }
+        w->stats->added += len - add_start;
+    }
+}
+
+static void put_data(op_writer_t *w, const uint8_t *data, int32_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    put_op(w, OTA_DELTA_OP_DATA, len);
+    w->bytes.insert(w->bytes.end(), data, data + len);
+    w->stats->data += len;
+}
+
+// bsdiff's scan: approximate matches, the bytes between them are new
+static void diff_ops(const uint8_t *old, int32_t old_size, const uint8_t *target, int32_t new_size, op_writer_t *w)
+{
+    std::vector<int32_t> sa = old_size > 0 ? suffix_array(old, old_size) : std::vector<int32_t>();
+    int32_t scan = 0, len = 0, pos = 0;
+    int32_t last_scan = 0, last_pos = 0, last_offset = 0;
+    while (scan < new_size) {
+        int32_t old_score = 0;
+        int32_t scsc = scan += len;
+        for (; scan < new_size; scan++) {
+            len = old_size > 0 ? search(sa, old, old_size, target + scan, new_size - scan, &pos) : 0;
+            for (; scsc < scan + len; scsc++) {
+                if (scsc + last_offset < old_size && old[scsc + last_offset] == target[scsc]) {
+                    old_score++;
+                }
+            }
+            if ((len == old_score && len != 0) || len > old_score + 8) {
+                break;
+            }
+            if (scan + last_offset < old_size && old[scan + last_offset] == target[scan]) {
+                old_score--;
+            }
+        }
+        if (len == old_score && scan != new_size) {
+            continue;
+        }
+        // stretch the last match forward and this one backward while half the bytes agree
+        int32_t s = 0, best = 0, len_f = 0;
+        for (int32_t i = 0; last_scan + i < scan && last_pos + i < old_size;) {
+            if (old[last_pos + i] == target[last_scan + i]) {
+                s++;
+            }
+            i++;
+            if (s * 2 - i > best * 2 - len_f) {
+                best = s;
+                len_f = i;
+            }
+        }
+        int32_t len_b = 0;
+        if (scan < new_size) {
+            s = 0;
+            best = 0;
+            for (int32_t i = 1; scan >= last_scan + i && pos >= i; i++) {
+                if (old[pos - i] == target[scan - i]) {
+                    s++;
+                }
+                if (s * 2 - i > best * 2 - len_b) {
+                    best = s;
+                    len_b = i;
+                }
+            }
+        }
+        if (last_scan + len_f > scan - len_b) {
+            int32_t overlap = last_scan + len_f - (scan - len_b);
+            s = 0;
+            best = 0;
+            int32_t len_s = 0;
+            for (int32_t i = 0; i < overlap; i++) {
+                if (target[last_scan + len_f - overlap + i] == old[last_pos + len_f - overlap + i]) {
+                    s++;
+                }
+                if (target[scan - len_b + i] == old[pos - len_b + i]) {
+                    s--;
+                }
+                if (s > best) {
+                    best = s;
+                    len_s = i + 1;
+                }
+            }
+            len_f += len_s - overlap;
+            len_b -= len_s;
+        }
+        put_diff(w, old + last_pos, target + last_scan, len_f);
+        put_data(w, target + last_scan + len_f, scan - len_b - (last_scan + len_f));
+        w->pending_seek += (int64_t)(pos - len_b) - (last_pos + len_f);
+        last_scan = scan - len_b;
+        last_pos = pos - len_b;
+        last_offset = pos - scan;
+    }
+}
+
+// LZ in the applier's window, greedy with one step lookahead
+static std::vector<uint8_t> compress(const std::vector<uint8_t> &in)
+{
+    std::vector<uint8_t> out;
+    std::vector<int32_t> head(1 << HASH_BITS, -1), prev(in.size(), -1);
+    int32_t n = (int32_t)in.size();
+    size_t flags_at = 0;
+    int flag_bit = 8;
+    auto hash = [&](int32_t i) {
+        return ((in[i] << 16 | in[i + 1] << 8 | in[i + 2]) * 2654435761u) >> (32 - HASH_BITS);
+    };
+    auto insert = [&](int32_t i) {
+        if (i + MATCH_MIN <= n) {
+            uint32_t h = hash(i);
+            prev[i] = head[h];
+            head[h] = i;
+        }
+    };
+    auto longest = [&](int32_t i, int32_t *distance) {
+        int32_t best = 0;
+        if (i + MATCH_MIN > n) {
+            return best;
+        }
+        int32_t limit = std::min(MATCH_MAX, n - i);
+        int chain = CHAIN_MAX;
+        for (int32_t c = head[hash(i)]; c >= 0 && i - c <= OTA_DELTA_WINDOW_SIZE && chain-- > 0; c = prev[c]) {
+            int32_t len = 0;
+            while (len < limit && in[c + len] == in[i + len]) {
+                len++;
+            }
+            if (len > best) {
+                best = len;
+                *distance = i - c;
+                if (len == limit) {
+                    break;
+                }
+            }
+        }
+        return best;
+    };
+    auto token = [&](bool match) {
+        if (flag_bit == 8) {
+            flags_at = out.size();
+            out.push_back(0);
+            flag_bit = 0;
+        }
+        if (match) {
+            out[flags_at] |= 1 << flag_bit;
+        }
+        flag_bit++;
+    };
+    int32_t i = 0;
+    while (i < n) {
+        int32_t distance = 0, next_distance = 0;
+        int32_t len = longest(i, &distance);
+        if (len >= MATCH_MIN && i + 1 < n) {
+            insert(i);
+            int32_t next = longest(i + 1, &next_distance);
+            if (next > len) {
+                len = 0;
+            }
+        } else {
+            insert(i);
+        }
+        if (len < MATCH_MIN) {
+            token(false);
+            out.push_back(in[i]);
+            i++;
+            continue;
+        }
+        token(true);
+        out.push_back((uint8_t)(distance - 1));
+        out.push_back((uint8_t)(((distance - 1) >> 8) | ((len - MATCH_MIN) << 3)));
+        for (int32_t k = 1; k < len; k++) {
+            insert(i + k);
+        }
+        i += len;
+    }
+    return out;
+}
+
+std::vector<uint8_t> ota_delta_diff(const std::vector<uint8_t> &old_image, const std::vector<uint8_t> &new_image,
+                                    ota_delta_diff_stats_t *stats)
+{
+    *stats = {};
+    op_writer_t w = { {}, 0, stats };
+    diff_ops(old_image.data(), (int32_t)old_image.size(), new_image.data(), (int32_t)new_image.size(), &w);
+
+    ota_delta_header_t header = {
+        .old_size = (uint32_t)old_image.size(),
+        .old_crc = ota_delta_crc32(0, old_image.data(), old_image.size()),
+        .new_size = (uint32_t)new_image.size(),
+        .new_crc = ota_delta_crc32(0, new_image.data(), new_image.size()),
+    };
+    std::vector<uint8_t> patch(OTA_DELTA_HEADER_SIZE);
+    ota_delta_pack_header(&header, patch.data());
+    std::vector<uint8_t> body = compress(w.bytes);
+    patch.insert(patch.end(), body.begin(), body.end());
+    stats->ops_bytes = (uint32_t)w.bytes.size();
+    stats->patch_bytes = (uint32_t)patch.size();
+    return patch;
+}
+
+static esp_err_t image_read(uint32_t offset, uint8_t *data, size_t len, void *ctx)
+{
+    const std::vector<uint8_t> *image = (const std::vector<uint8_t> *)((void **)ctx)[0];
+    if ((uint64_t)offset + len > image->size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(data, image->data() + offset, len);
+    return ESP_OK;
+}
+
+static esp_err_t image_write(const uint8_t *data, size_t len, void *ctx)
+{
+    std::vector<uint8_t> *image = (std::vector<uint8_t> *)((void **)ctx)[1];
+    image->insert(image->end(), data, data + len);
+    return ESP_OK;
+}
+
+esp_err_t ota_delta_apply_image(const std::vector<uint8_t> &old_image, const std::vector<uint8_t> &patch,
+                                size_t piece, std::vector<uint8_t> *new_image)
+{
+    // static as on the device
+    static ota_delta_t delta;
+    void *ctx[2] = { (void *)&old_image, new_image };
+    new_image->clear();
+    ota_delta_init(&delta, image_read, image_write, ctx);
+    for (size_t i = 0; i < patch.size();) {
+        // as the requestor does: the header alone, then the old image checked in steps
+        esp_err_t err = ota_delta_check_step(&delta, OTA_DELTA_CHECK_READS);
+        if (err == ESP_ERR_NOT_FINISHED) {
+            continue;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        size_t len = std::min(piece, patch.size() - i);
+        if (i < OTA_DELTA_HEADER_SIZE) {
+            len = std::min(len, OTA_DELTA_HEADER_SIZE - i);
+        }
+        err = ota_delta_feed(&delta, &patch[i], len);
+        if (err != ESP_OK) {
+            return err;
+        }
+        i += len;
+    }
+    return ota_delta_finish(&delta);
+}
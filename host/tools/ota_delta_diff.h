@@ -0,0 +1,46 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Creates ota_delta.h patches on the host, and applies them with the
+  device applier to check the round trip.
+
+  The old image is matched as bsdiff does: a suffix array finds the
+  longest match for each position of the new image, and a match is
+  stretched over bytes that differ as long as at least half of them are
+  equal. That keeps code that moved, whose embedded addresses all changed
+  a little, in one long ADD run of mostly zero differences. Zero runs
+  become COPY, the rest of the new image DATA, and the operations are LZ
+  compressed in the window the applier keeps.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include <esp_err.h>
+
+typedef struct {
+    // new image bytes by the operation that produced them
+    uint32_t copied;
+    uint32_t added;
+    uint32_t data;
+    // operations before and after LZ
+    uint32_t ops_bytes;
+    uint32_t patch_bytes;
+} ota_delta_diff_stats_t;
+
+std::vector<uint8_t> ota_delta_diff(const std::vector<uint8_t> &old_image, const std::vector<uint8_t> &new_image,
+                                    ota_delta_diff_stats_t *stats);
+
+// Run patch over old_image through the device applier, in pieces of piece bytes as BDX blocks would arrive
+esp_err_t ota_delta_apply_image(const std::vector<uint8_t> &old_image, const std::vector<uint8_t> &patch,
+                                size_t piece, std::vector<uint8_t> *new_image);
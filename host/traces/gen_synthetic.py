@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Generate the synthetic reference traces used by replay_bench.
+
+The traces model the true room environment only; the simulated SCD41 adds
+sensor noise and quantisation on top. Replace or extend them with CSVs
+recorded on real nodes (same column layout) when available.
+
+    python3 gen_synthetic.py
+"""
+
+import math
+import random
+
+OUTDOOR_CO2 = 420.0
+STEP_S = 60
+
+
+def office(t_s, state, rng):
+    # mass balance: dC/dt = n * G / V - ach * (C - C_out)
+    hour = (t_s / 3600.0) % 24
+    occupied = 8.5 <= hour < 12.0 or 13.0 <= hour < 18.0
+    people = 4 if occupied else 0
+    if occupied and rng.random() < 0.05:
+        people += rng.choice((-2, -1, 1, 2))
+    volume_m3 = 60.0
+    generation_m3_s = 0.0052 / 1000.0  # CO2 per person, m3/s
+    ach = (1.2 if occupied else 0.3) / 3600.0
+    c = state["co2"]
+    c += STEP_S * (max(people, 0) * generation_m3_s / volume_m3 * 1e6 - ach * (c - OUTDOOR_CO2))
+    state["co2"] = c
+
+    target_t = 22.4 if occupied else 20.3
+    state["t"] += (target_t - state["t"]) * 0.01 + rng.gauss(0, 0.004)
+    target_rh = 46.0 if occupied else 41.0
+    state["rh"] += (target_rh - state["rh"]) * 0.008 + rng.gauss(0, 0.03)
+    return c, state["t"], state["rh"]
+
+
+def empty_room(t_s, state, rng):
+    day = 2 * math.pi * t_s / 86400.0
+    state["co2"] += (OUTDOOR_CO2 + 25 - state["co2"]) * 0.002 + rng.gauss(0, 0.15)
+    t = 20.2 + 0.4 * math.sin(day - 1.9) + rng.gauss(0, 0.002)
+    rh = 44.0 - 1.5 * math.sin(day - 1.9) + rng.gauss(0, 0.01)
+    return state["co2"], t, rh
+
+
+def write(path, model, description, seed):
+    rng = random.Random(seed)
+    state = {"co2": OUTDOOR_CO2 + 30, "t": 20.3, "rh": 41.0}
+    with open(path, "w") as f:
+        f.write(f"# {description}\n")
+        f.write("# synthetic, generated by gen_synthetic.py\n")
+        f.write("# time_s,co2_ppm,temperature_c,humidity_pct\n")
+        for t_s in range(0, 24 * 3600 + STEP_S, STEP_S):
+            c, t, rh = model(t_s, state, rng)
+            f.write(f"{t_s},{c:.1f},{t:.2f},{rh:.2f}\n")
+
+
+if __name__ == "__main__":
+    write("office_24h.csv", office, "4-person office, 60 m3, occupied 08:30-12:00 and 13:00-18:00", 1)
+    write("empty_room_24h.csv", empty_room, "unoccupied room, diurnal temperature swing", 2)
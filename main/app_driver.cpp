@@ -13,51 +13,122 @@
 #include <app_priv.h>
 #include <iot_button.h>
 #include <button_gpio.h>
-#include <scd4x.h>
-
-#define CONFIG_EXAMPLE_I2C_MASTER_SDA       GPIO_NUM_3
-#define CONFIG_EXAMPLE_I2C_MASTER_SCL       GPIO_NUM_2
-#define I2C_MASTER_NUM                      I2C_NUM_0
-
-static constexpr char *TAG_SENSOR = "scd4x";
-static i2c_dev_t dev;
+#include <scd41_i2cdev.h>
+#include <scd4x_sensor.h>
+
+static const char *TAG = "app_driver";
+
+static scd41_i2cdev_t s_bindings[SCD4X_SENSOR_MAX];
+static scd41_t s_devs[SCD4X_SENSOR_MAX];
+// port of each bound sensor, I2C_NUM_MAX if the slot failed
+static i2c_port_t s_ports[SCD4X_SENSOR_MAX];
+static size_t s_slots;
+// one TCA9548A per port at most
+static scd41_i2c_mux_t s_muxes[I2C_NUM_MAX];
+static bool s_mux_ready[I2C_NUM_MAX];
+// one clock policy per port, whatever the sensors on it are wired through
+static scd41_clock_t s_clocks[I2C_NUM_MAX];
+
+static esp_err_t port_set_clock(void *ctx, uint32_t hz)
+{
+    i2c_port_t port = (i2c_port_t)(intptr_t)ctx;
+    for (size_t i = 0; i < s_slots; i++) {
+        if (s_ports[i] != port) {
+            continue;
+        }
+        esp_err_t err = scd41_i2cdev_set_clock(&s_bindings[i], hz);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
 
-void sensor_init( void )
+static esp_err_t bind_slot(size_t i, const sensor_slot_t *slot)
 {
-    dev.cfg.sda_pullup_en = 1;
-    dev.cfg.scl_pullup_en = 1;
-    
-    ESP_ERROR_CHECK(i2cdev_init());    
-    
-
-    ESP_ERROR_CHECK(scd4x_init_desc(&dev, I2C_MASTER_NUM, CONFIG_EXAMPLE_I2C_MASTER_SDA, CONFIG_EXAMPLE_I2C_MASTER_SCL));
-    dev.cfg.master.clk_speed = 1000000; // 400 kHz
-
-    ESP_LOGI(TAG_SENSOR, "Initializing sensor...");
-    ESP_ERROR_CHECK(scd4x_wake_up(&dev));
-    ESP_ERROR_CHECK(scd4x_stop_periodic_measurement(&dev));
-    ESP_ERROR_CHECK(scd4x_reinit(&dev));
-    ESP_LOGI(TAG_SENSOR, "Sensor initialized");
-
-    uint16_t serial[3];
-    ESP_ERROR_CHECK(scd4x_get_serial_number(&dev, serial, serial + 1, serial + 2));
-    ESP_LOGI(TAG_SENSOR, "Sensor serial number: 0x%04x%04x%04x", serial[0], serial[1], serial[2]);
-
-    ESP_ERROR_CHECK(scd4x_start_periodic_measurement(&dev));
-    ESP_LOGI(TAG_SENSOR, "Periodic measurements started");
+    i2c_port_t port = (i2c_port_t)slot->i2c_port;
+    gpio_num_t sda = (gpio_num_t)slot->sda_gpio, scl = (gpio_num_t)slot->scl_gpio;
+    s_ports[i] = I2C_NUM_MAX;
+    if (slot->i2c_port >= I2C_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    scd41_i2cdev_t *binding = &s_bindings[i];
+    esp_err_t err;
+    if (slot->mux_channel == SENSOR_MUX_NONE) {
+        binding->i2c.cfg.sda_pullup_en = 1;
+        binding->i2c.cfg.scl_pullup_en = 1;
+        err = scd41_i2cdev_init(&s_devs[i], binding, port, sda, scl);
+    } else {
+        scd41_i2c_mux_t *mux = &s_muxes[port];
+        if (!s_mux_ready[port]) {
+            err = scd41_i2c_mux_init(mux, port, CONFIG_SENSOR_MUX_I2C_ADDR, sda, scl);
+            if (err != ESP_OK) {
+                return err;
+            }
+            mux->i2c.cfg.sda_pullup_en = 1;
+            mux->i2c.cfg.scl_pullup_en = 1;
+            s_mux_ready[port] = true;
+        }
+        err = scd41_i2cdev_init_mux(&s_devs[i], binding, mux, slot->mux_channel);
+    }
+    if (err == ESP_OK) {
+        s_ports[i] = port;
+    }
+    return err;
 }
 
-esp_err_t sensor_get( float *temp, float *humidity, uint16_t *co2 )
+size_t sensor_init(const sensor_registry_t *registry, scd41_t *devs[SCD4X_SENSOR_MAX])
 {
-    esp_err_t res = scd4x_read_measurement(&dev, co2, temp, humidity);
-    if (res != ESP_OK)
-    {
-        ESP_LOGE(TAG_SENSOR, "Error reading results %d (%s)", res, esp_err_to_name(res));
+    for (size_t i = 0; i < SCD4X_SENSOR_MAX; i++) {
+        devs[i] = NULL;
     }
 
-    ESP_LOGI(TAG_SENSOR, "CO2: %u ppm, Temperature: %.2f °C, Humidity: %.2f %%", *co2, *temp, *humidity);
+    esp_err_t err = i2cdev_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "i2cdev_init failed, err:%d", err);
+        return 0;
+    }
 
-    return res;
+    size_t bound = 0;
+    for (size_t i = 0; i < registry->count; i++) {
+        const sensor_slot_t *slot = &registry->slots[i];
+        err = bind_slot(i, slot);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Sensor %u on port %u failed, err:%d", (unsigned)i, slot->i2c_port, err);
+            continue;
+        }
+        ESP_LOGI(TAG, "Sensor %u: port %u, SDA %u, SCL %u%s", (unsigned)i, slot->i2c_port, slot->sda_gpio,
+                 slot->scl_gpio, slot->mux_channel == SENSOR_MUX_NONE ? "" : ", behind the mux");
+        devs[i] = &s_devs[i];
+        bound++;
+    }
+    s_slots = registry->count;
+
+    scd41_clock_config_t config;
+    scd41_clock_config_default(&config);
+    for (size_t port = 0; port < I2C_NUM_MAX; port++) {
+        bool used = false;
+        for (size_t i = 0; i < registry->count; i++) {
+            used |= s_ports[i] == (i2c_port_t)port;
+        }
+        if (!used) {
+            continue;
+        }
+        err = scd41_clock_init(&s_clocks[port], &config, port_set_clock, (void *)(intptr_t)port);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Port %u stays at its clock, err:%d", (unsigned)port, err);
+            continue;
+        }
+        for (size_t i = 0; i < registry->count; i++) {
+            if (s_ports[i] == (i2c_port_t)port) {
+                scd41_clock_attach(devs[i], &s_clocks[port]);
+            }
+        }
+    }
+
+    // the sensors themselves are brought up by the sensor task, without blocking startup
+    return bound;
 }
 
 
@@ -65,8 +136,6 @@ esp_err_t sensor_get( float *temp, float *humidity, uint16_t *co2 )
 using namespace chip::app::Clusters;
 using namespace esp_matter;
 
-static constexpr char *TAG = "app_driver";
-
 static void app_driver_button_toggle_cb(void *arg, void *data)
 {
     // The device will stay active mode for Active Mode Threshold
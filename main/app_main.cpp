@@ -14,8 +14,15 @@
   idf.py fullclean
 */
 
+#include <atomic>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
 #if CONFIG_PM_ENABLE
 #include <esp_pm.h>
@@ -26,12 +33,61 @@
 
 #include <common_macros.h>
 #include <app_priv.h>
+#include <boot_timeline.h>
+#include <event_log.h>
+#include <scd4x_sensor.h>
+#include <sensor_commit.h>
+#include <sensor_adapt.h>
+#if CONFIG_SENSOR_CO2_ALARM
+#include <sensor_alarm.h>
+#endif
+#include <sensor_demand.h>
+#include <sensor_filter.h>
+#if CONFIG_SENSOR_HISTORY
+#include <sensor_history.h>
+#include <sensor_history_flash.h>
+#endif
+#include <sensor_pipeline.h>
+#include <sensor_probe.h>
+#include <sensor_window.h>
+#include <report_config.h>
+#include <telemetry.h>
+#if CONFIG_SENSOR_DELTA_OTA
+#include <ota_delta_requestor.h>
+#endif
+#if CONFIG_SENSOR_TIMER_JITTER_PROBE
+#include <timer_jitter.h>
+#endif
+#if CONFIG_ENABLE_CHIP_SHELL
+#include <esp_matter_console.h>
+#endif
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include <platform/ESP32/OpenthreadLauncher.h>
 #endif
+#if CONFIG_ENABLE_ICD_SERVER
+#include <app/icd/server/ICDConfigurationData.h>
+#include <app/icd/server/ICDStateObserver.h>
+#if CONFIG_SENSOR_CO2_ALARM
+#include <app/icd/server/ICDNotifier.h>
+#endif
+#endif
 
+#include <app/clusters/general-diagnostics-server/general-diagnostics-server.h>
 #include <app/server/CommissioningWindowManager.h>
+#include <app/reporting/reporting.h>
 #include <app/server/Server.h>
+#include <platform/DiagnosticDataProvider.h>
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+#include <app/InteractionModelEngine.h>
+#include <app/ReadHandler.h>
+#endif
+#if CONFIG_SENSOR_CO2_ALARM
+#include <app/EventLogging.h>
+#endif
+#if CONFIG_SENSOR_SAMPLE_ON_READ
+#include <app/AttributeAccessInterface.h>
+#include <app/AttributeAccessInterfaceRegistry.h>
+#endif
 
 #include <app-common/zap-generated/cluster-objects.h>  // enum 정의 필요 시
 
@@ -45,122 +101,978 @@ using namespace chip::app;
 namespace CDCM = chip::app::Clusters::CarbonDioxideConcentrationMeasurement;
 namespace NM = chip::app::Clusters::CarbonDioxideConcentrationMeasurement;
 
-extern void sensor_init( void );
-extern esp_err_t sensor_get( float *temp, float *humidity, uint16_t *co2 );
+static_assert(AIR_QUALITY_GOOD == (uint8_t)Clusters::AirQuality::AirQualityEnum::kGood &&
+              AIR_QUALITY_EXTREMELY_POOR == (uint8_t)Clusters::AirQuality::AirQualityEnum::kExtremelyPoor,
+              "air_quality_t must match AirQualityEnum");
 
+// endpoints carrying the measured attributes
+typedef enum {
+    SENSOR_EP_TEMPERATURE,
+    SENSOR_EP_HUMIDITY,
+    SENSOR_EP_AIR_QUALITY,
+    SENSOR_EP_COUNT,
+} sensor_ep_t;
 
-// CO2(ppm) → AirQuality(enum) 간단 매핑
-static uint8_t map_co2_to_air_quality_enum(float ppm) {
-    using AQ = Clusters::AirQuality::AirQualityEnum;
-    if (ppm < 600)   return (uint8_t)AQ::kGood;
-    if (ppm < 1000)  return (uint8_t)AQ::kFair;
-    if (ppm < 1500)  return (uint8_t)AQ::kModerate;
-    if (ppm < 2000)  return (uint8_t)AQ::kPoor;
-    if (ppm < 5000)  return (uint8_t)AQ::kVeryPoor;
-    return (uint8_t)AQ::kExtremelyPoor;
-}
+typedef struct {
+    sensor_ep_t ep;
+    uint32_t cluster_id;
+    uint32_t attribute_id;
+} measured_attr_desc_t;
+
+static constexpr measured_attr_desc_t k_measured_attr_descs[SENSOR_ATTR_COUNT] = {
+    [SENSOR_ATTR_TEMPERATURE] = { SENSOR_EP_TEMPERATURE,
+        TemperatureMeasurement::Id, TemperatureMeasurement::Attributes::MeasuredValue::Id },
+    [SENSOR_ATTR_HUMIDITY] = { SENSOR_EP_HUMIDITY,
+        RelativeHumidityMeasurement::Id, RelativeHumidityMeasurement::Attributes::MeasuredValue::Id },
+    [SENSOR_ATTR_CO2] = { SENSOR_EP_AIR_QUALITY, CDCM::Id, CDCM::Attributes::MeasuredValue::Id },
+    [SENSOR_ATTR_AIR_QUALITY] = { SENSOR_EP_AIR_QUALITY, AirQuality::Id, AirQuality::Attributes::AirQuality::Id },
+    [SENSOR_ATTR_CO2_PEAK] = { SENSOR_EP_AIR_QUALITY, CDCM::Id, CDCM::Attributes::PeakMeasuredValue::Id },
+    [SENSOR_ATTR_CO2_AVERAGE] = { SENSOR_EP_AIR_QUALITY, CDCM::Id, CDCM::Attributes::AverageMeasuredValue::Id },
+};
+
+// A measured attribute resolved once in app_main(), so the sample path writes without any lookup
+typedef struct {
+    uint16_t endpoint_id;
+    uint32_t cluster_id;
+    uint32_t attribute_id;
+    attribute_t *attribute;
+    esp_matter_val_type_t type;
+} measured_attr_t;
 
-using scd4x_sensor_cb_t = void (*)(uint16_t endpoint_id, float value, void *user_data);
+// per registry slot
+static measured_attr_t s_measured_attrs[SCD4X_SENSOR_MAX][SENSOR_ATTR_COUNT];
 
+// Attributes added to the CO2 concentration cluster, each created unless the cluster already has it
 typedef struct {
-    struct {
-        // This callback functon will be called periodically to report the temperature.
-        scd4x_sensor_cb_t cb = NULL;
-        // endpoint_id associated with temperature sensor
-        uint16_t endpoint_id;
-    } temperature;
-
-    struct {
-        // This callback functon will be called periodically to report the humidity.
-        scd4x_sensor_cb_t cb = NULL;
-        // endpoint_id associated with humidity sensor
-        uint16_t endpoint_id;
-    } humidity;
-
-    struct {
-        // This callback functon will be called periodically to report the humidity.
-        scd4x_sensor_cb_t cb = NULL;
-        // endpoint_id associated with humidity sensor
-        uint16_t endpoint_id;
-    } co2;
-
-    // user data
-    void *user_data = NULL;
-
-    // polling interval in milliseconds, defaults to 5000 ms
-    uint32_t interval_ms = 10000;
-} scd4x_sensor_config_t;
-
-// Application cluster specification, 7.18.2.11. Temperature
-// represents a temperature on the Celsius scale with a resolution of 0.01°C.
-// temp = (temperature in °C) x 100
-static void temp_sensor_notification(uint16_t endpoint_id, float temp, void *user_data)
-{
-    // schedule the attribute update so that we can report it from matter thread
-    chip::DeviceLayer::SystemLayer().ScheduleLambda([endpoint_id, temp]() {
-        attribute_t * attribute = attribute::get(endpoint_id,
-                                                 TemperatureMeasurement::Id,
-                                                 TemperatureMeasurement::Attributes::MeasuredValue::Id);
+    uint32_t attribute_id;
+    uint16_t flags;
+    esp_matter_val_type_t type;
+    // initial value: f for float types, u for integer types, nullable types start null
+    float f;
+    uint32_t u;
+} attr_desc_t;
+
+static constexpr attr_desc_t k_co2_attr_descs[] = {
+    // null until the first sample, like the temperature and humidity MeasuredValue
+    { CDCM::Attributes::MeasuredValue::Id, ATTRIBUTE_FLAG_NULLABLE, ESP_MATTER_VAL_TYPE_NULLABLE_FLOAT, 0.0f, 0 },
+    { CDCM::Attributes::MeasurementUnit::Id, 0, ESP_MATTER_VAL_TYPE_UINT8, 0.0f,
+      chip::to_underlying(CDCM::MeasurementUnitEnum::kPpm) },
+    { CDCM::Attributes::MinMeasuredValue::Id, 0, ESP_MATTER_VAL_TYPE_FLOAT, 0.0f, 0 },
+    { CDCM::Attributes::MaxMeasuredValue::Id, 0, ESP_MATTER_VAL_TYPE_FLOAT, 40000.0f, 0 },
+    // computed on device by sensor_window, null until the first sample
+    { CDCM::Attributes::PeakMeasuredValue::Id, ATTRIBUTE_FLAG_NULLABLE, ESP_MATTER_VAL_TYPE_NULLABLE_FLOAT, 0.0f, 0 },
+    { CDCM::Attributes::PeakMeasuredValueWindow::Id, 0, ESP_MATTER_VAL_TYPE_UINT32, 0.0f, CONFIG_SENSOR_CO2_WINDOW_SEC },
+    { CDCM::Attributes::AverageMeasuredValue::Id, ATTRIBUTE_FLAG_NULLABLE, ESP_MATTER_VAL_TYPE_NULLABLE_FLOAT, 0.0f, 0 },
+    { CDCM::Attributes::AverageMeasuredValueWindow::Id, 0, ESP_MATTER_VAL_TYPE_UINT32, 0.0f, CONFIG_SENSOR_CO2_WINDOW_SEC },
+};
+
+static esp_matter_attr_val_t attr_desc_value(const attr_desc_t *desc)
+{
+    switch (desc->type) {
+    case ESP_MATTER_VAL_TYPE_FLOAT:             return esp_matter_float(desc->f);
+    case ESP_MATTER_VAL_TYPE_NULLABLE_FLOAT:    return esp_matter_nullable_float(nullable<float>());
+    case ESP_MATTER_VAL_TYPE_UINT8:             return esp_matter_uint8((uint8_t)desc->u);
+    case ESP_MATTER_VAL_TYPE_UINT32:            return esp_matter_uint32(desc->u);
+    default:                                    return esp_matter_invalid(NULL);
+    }
+}
+
+static void create_attributes(cluster_t *cluster, const attr_desc_t *descs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!attribute::get(cluster, descs[i].attribute_id)) {
+            attribute::create(cluster, descs[i].attribute_id, descs[i].flags, attr_desc_value(&descs[i]));
+        }
+    }
+}
+
+static esp_err_t measured_attrs_bind(size_t slot, endpoint_t *const endpoints[SENSOR_EP_COUNT])
+{
+    for (int attr = 0; attr < SENSOR_ATTR_COUNT; attr++) {
+        const measured_attr_desc_t *desc = &k_measured_attr_descs[attr];
+        uint16_t endpoint_id = endpoint::get_id(endpoints[desc->ep]);
+        attribute_t *attribute = attribute::get(endpoint_id, desc->cluster_id, desc->attribute_id);
+        if (attribute == nullptr) {
+            ESP_LOGE(TAG, "Measured attribute 0x%08" PRIx32 " missing on endpoint %u", desc->attribute_id, endpoint_id);
+            return ESP_ERR_NOT_FOUND;
+        }
 
+        // keep the attribute's own type (속성 타입 유지)
         esp_matter_attr_val_t val = esp_matter_invalid(NULL);
         attribute::get_val(attribute, &val);
-        val.val.i16 = static_cast<int16_t>(temp * 100);
+        s_measured_attrs[slot][attr] = { endpoint_id, desc->cluster_id, desc->attribute_id, attribute, val.type };
+    }
+    return ESP_OK;
+}
+
+// Per registry slot: the drain pipeline with its filter state and last values written to the data model,
+// only touched from the matter thread
+static sensor_pipeline_t s_sensor_state[SCD4X_SENSOR_MAX];
+// registry slot of each sensor task index, slots whose bus failed have no sensor
+static uint8_t s_task_slot[SCD4X_SENSOR_MAX];
+static size_t s_task_count;
+#if CONFIG_SENSOR_SAMPLE_ON_READ
+// esp_timer time of each sensor's last drained sample, matter thread only
+static int64_t s_last_sample_us[SCD4X_SENSOR_MAX];
+#endif
+#if CONFIG_SENSOR_ADAPTIVE_SAMPLING
+// interval from the CO2 trend, by sensor task index, matter thread only
+static sensor_adapt_t s_adapt[SCD4X_SENSOR_MAX];
+#endif
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+// subscriptions on the sensor endpoints, by sensor task index, matter thread only
+static sensor_demand_t s_demand;
+#endif
+
+// ctx: the slot's row of s_measured_attrs
+static void write_measured_attribute(sensor_attr_t attr, const sensor_measurement_t *measurement,
+                                     bool force_report, void *ctx)
+{
+    const measured_attr_t *handle = &((const measured_attr_t *)ctx)[attr];
+    if (handle->attribute == nullptr) {
+        return;
+    }
+
+    esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+    val.type = handle->type;
+    switch (attr) {
+    case SENSOR_ATTR_TEMPERATURE:
+        // Application cluster specification, 7.18.2.11. Temperature
+        // represents a temperature on the Celsius scale with a resolution of 0.01°C.
+        val.val.i16 = measurement->temperature;
+        break;
+    case SENSOR_ATTR_HUMIDITY:
+        // Application cluster specification, 2.6.4.1. MeasuredValue Attribute
+        // represents the humidity in percent with a resolution of 0.01%.
+        val.val.u16 = measurement->humidity;
+        break;
+    case SENSOR_ATTR_CO2:
+        // CO2 concentration in parts per million (ppm)
+        val.val.f = (float)measurement->co2;
+        break;
+    case SENSOR_ATTR_AIR_QUALITY:
+        // AirQuality(enum) 갱신 → HA의 "Air quality" 채워짐
+        val.val.u8 = measurement->air_quality;
+        break;
+    case SENSOR_ATTR_CO2_PEAK:
+        val.val.f = (float)measurement->co2_peak;
+        break;
+    case SENSOR_ATTR_CO2_AVERAGE:
+        val.val.f = (float)measurement->co2_average;
+        break;
+    default:
+        return;
+    }
+    // sensor_commit only writes values that changed, or heartbeats (force_report) that are
+    // reported unchanged, so every write marks the path dirty
+    SENSOR_PROBE_BEGIN(write_start);
+    attribute::set_val(handle->attribute, &val);
+    MatterReportingAttributeChangeCallback(handle->endpoint_id, handle->cluster_id, handle->attribute_id);
+    SENSOR_PROBE_END(SENSOR_PROBE_WRITE, write_start);
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_UPDATES, force_report ? 0 : 1);
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_DIRTY_MARKS, 1);
+}
+
+#if CONFIG_SENSOR_PROBES
+// Manufacturer specific cluster on the root endpoint, its only attribute
+// holds sensor_probe_encode() output, refreshed at most once a minute
+#define PROBE_ATTRIBUTE_ID          0x0000
+#define PROBE_REFRESH_PERIOD_US     (60 * 1000000LL)
+
+static_assert(SENSOR_PROBE_ENCODED_LEN <= 254, "probe snapshot must fit a short octet string");
+
+static attribute_t *s_probe_attr;
+static int64_t s_probe_refresh_us;
+
+static void probe_attr_create(node_t *node)
+{
+    cluster_t *cluster = cluster::create(endpoint::get(node, 0), CONFIG_SENSOR_PROBES_CLUSTER_ID, CLUSTER_FLAG_SERVER);
+    if (cluster == nullptr) {
+        ESP_LOGE(TAG, "Failed to create probe cluster");
+        return;
+    }
+    attribute::create(cluster, Globals::Attributes::ClusterRevision::Id, 0, esp_matter_uint16(1));
+    static uint8_t empty[SENSOR_PROBE_ENCODED_LEN];
+    s_probe_attr = attribute::create(cluster, PROBE_ATTRIBUTE_ID, 0, esp_matter_octet_str(empty, 0),
+                                     SENSOR_PROBE_ENCODED_LEN);
+}
+
+// matter thread only
+static void probe_attr_refresh(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_probe_attr == nullptr || now - s_probe_refresh_us < PROBE_REFRESH_PERIOD_US) {
+        return;
+    }
+    s_probe_refresh_us = now;
+
+    static uint8_t buf[SENSOR_PROBE_ENCODED_LEN];
+    size_t len = sensor_probe_encode(buf, sizeof(buf));
+    esp_matter_attr_val_t val = esp_matter_octet_str(buf, (uint16_t)len);
+    attribute::set_val(s_probe_attr, &val);
+}
+
+#endif // CONFIG_SENSOR_PROBES
+
+// Manufacturer specific cluster on the root endpoint with telemetry.h, uint32 attributes refreshed
+// from the drain at most every CONFIG_SENSOR_TELEMETRY_PERIOD_SEC. Readable but never reported, a
+// subscription to it costs no wakes.
+typedef enum {
+    TELEMETRY_ATTR_HEAP_FREE,
+    TELEMETRY_ATTR_HEAP_FREE_MIN,
+    TELEMETRY_ATTR_HEAP_LARGEST_BLOCK,
+    TELEMETRY_ATTR_HEAP_BLOCKS,
+    TELEMETRY_ATTR_SAMPLE_ALLOCS,
+    TELEMETRY_ATTR_COUNT,
+    // stack high-water marks from here on, by telemetry_task_t
+    TELEMETRY_ATTR_STACK = 0x10,
+} telemetry_attr_t;
+
+#define TELEMETRY_REFRESH_PERIOD_US (CONFIG_SENSOR_TELEMETRY_PERIOD_SEC * 1000000LL)
+
+static attribute_t *s_telemetry_attrs[TELEMETRY_ATTR_COUNT + TELEMETRY_TASK_COUNT];
+// matter thread only
+static int64_t s_telemetry_refresh_us;
+static uint32_t s_sample_allocs;
+
+static void telemetry_attrs_create(node_t *node)
+{
+    cluster_t *cluster = cluster::create(endpoint::get(node, 0), CONFIG_SENSOR_TELEMETRY_CLUSTER_ID,
+                                         CLUSTER_FLAG_SERVER);
+    if (cluster == nullptr) {
+        ESP_LOGE(TAG, "Failed to create telemetry cluster");
+        return;
+    }
+    attribute::create(cluster, Globals::Attributes::ClusterRevision::Id, 0, esp_matter_uint16(1));
+    for (uint32_t id = 0; id < TELEMETRY_ATTR_COUNT; id++) {
+        s_telemetry_attrs[id] = attribute::create(cluster, id, 0, esp_matter_uint32(0));
+    }
+    for (uint32_t task = 0; task < TELEMETRY_TASK_COUNT; task++) {
+        s_telemetry_attrs[TELEMETRY_ATTR_COUNT + task] =
+            attribute::create(cluster, TELEMETRY_ATTR_STACK + task, 0, esp_matter_uint32(0));
+    }
+}
+
+// matter thread only
+static void telemetry_refresh(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (s_telemetry_refresh_us != 0 && now - s_telemetry_refresh_us < TELEMETRY_REFRESH_PERIOD_US) {
+        return;
+    }
+    s_telemetry_refresh_us = now;
+
+    telemetry_t telemetry;
+    telemetry_read(&telemetry);
+    if (telemetry.sample_allocs != s_sample_allocs) {
+        ESP_LOGW(TAG, "%lu heap allocations on the sample path",
+                 (unsigned long)(telemetry.sample_allocs - s_sample_allocs));
+        s_sample_allocs = telemetry.sample_allocs;
+    }
+    uint32_t values[TELEMETRY_ATTR_COUNT + TELEMETRY_TASK_COUNT] = {
+        telemetry.heap_free,
+        telemetry.heap_free_min,
+        telemetry.heap_largest_block,
+        telemetry.heap_blocks,
+        telemetry.sample_allocs,
+    };
+    memcpy(&values[TELEMETRY_ATTR_COUNT], telemetry.stack_free_min, sizeof(telemetry.stack_free_min));
+    for (size_t i = 0; i < TELEMETRY_ATTR_COUNT + TELEMETRY_TASK_COUNT; i++) {
+        if (s_telemetry_attrs[i]) {
+            esp_matter_attr_val_t val = esp_matter_uint32(values[i]);
+            attribute::set_val(s_telemetry_attrs[i], &val);
+        }
+    }
+}
 
-        attribute::update(endpoint_id, TemperatureMeasurement::Id, TemperatureMeasurement::Attributes::MeasuredValue::Id, &val);
+// Manufacturer specific cluster on each air quality endpoint with the
+// sensor_health.h state and counters, the attribute IDs are the enum values
+typedef enum {
+    // enum8, sensor_health_state_t
+    DIAG_ATTR_HEALTH,
+    // uint32 each
+    DIAG_ATTR_CONSECUTIVE_FAILURES,
+    DIAG_ATTR_FAILURES,
+    DIAG_ATTR_RESETS,
+    DIAG_ATTR_RECOVERIES,
+    DIAG_ATTR_COUNT,
+} diag_attr_t;
+
+static attribute_t *s_diag_attrs[SCD4X_SENSOR_MAX][DIAG_ATTR_COUNT];
+static uint16_t s_diag_endpoint_ids[SCD4X_SENSOR_MAX];
+// matter thread only
+static bool s_sensor_failed[SCD4X_SENSOR_MAX];
+
+static void diag_attrs_create(size_t slot, endpoint_t *endpoint)
+{
+    cluster_t *cluster = cluster::create(endpoint, CONFIG_SENSOR_DIAGNOSTICS_CLUSTER_ID, CLUSTER_FLAG_SERVER);
+    if (cluster == nullptr) {
+        ESP_LOGE(TAG, "Failed to create sensor diagnostics cluster");
+        return;
+    }
+    attribute::create(cluster, Globals::Attributes::ClusterRevision::Id, 0, esp_matter_uint16(1));
+    attribute_t **attrs = s_diag_attrs[slot];
+    attrs[DIAG_ATTR_HEALTH] = attribute::create(cluster, DIAG_ATTR_HEALTH, 0, esp_matter_enum8(SENSOR_HEALTH_OK));
+    for (uint32_t id = DIAG_ATTR_CONSECUTIVE_FAILURES; id < DIAG_ATTR_COUNT; id++) {
+        attrs[id] = attribute::create(cluster, id, 0, esp_matter_uint32(0));
+    }
+    s_diag_endpoint_ids[slot] = endpoint::get_id(endpoint);
+}
+
+static void diag_attr_write(size_t slot, diag_attr_t attr, esp_matter_attr_val_t val)
+{
+    if (s_diag_attrs[slot][attr] == nullptr) {
+        return;
+    }
+    attribute::set_val(s_diag_attrs[slot][attr], &val);
+    MatterReportingAttributeChangeCallback(s_diag_endpoint_ids[slot], CONFIG_SENSOR_DIAGNOSTICS_CLUSTER_ID, attr);
+}
+
+static bool any_sensor_failed(void)
+{
+    for (size_t slot = 0; slot < SCD4X_SENSOR_MAX; slot++) {
+        if (s_sensor_failed[slot]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// General Diagnostics HardwareFaultChange event, so controllers see a dead sensor without the vendor cluster
+static void report_sensor_fault(bool active)
+{
+    chip::DeviceLayer::GeneralFaults<chip::DeviceLayer::kMaxHardwareFaults> previous, current;
+    (active ? current : previous).add(chip::to_underlying(GeneralDiagnostics::HardwareFaultEnum::kSensor));
+    GeneralDiagnosticsServer::Instance().OnHardwareFaultsDetect(previous, current);
+}
+
+// Called from the sensor task after a failure or a recovery, user_data is the sensor task index
+static void sensor_health_notification(void *user_data)
+{
+    size_t sensor = (uintptr_t)user_data;
+    chip::DeviceLayer::SystemLayer().ScheduleLambda([sensor]() {
+        size_t slot = s_task_slot[sensor];
+        sensor_health_t health;
+        sensor_task_get_health(sensor, &health);
+        diag_attr_write(slot, DIAG_ATTR_HEALTH, esp_matter_enum8(health.state));
+        diag_attr_write(slot, DIAG_ATTR_CONSECUTIVE_FAILURES, esp_matter_uint32(health.consecutive_failures));
+        diag_attr_write(slot, DIAG_ATTR_FAILURES, esp_matter_uint32(health.failures));
+        diag_attr_write(slot, DIAG_ATTR_RESETS, esp_matter_uint32(health.resets));
+        diag_attr_write(slot, DIAG_ATTR_RECOVERIES, esp_matter_uint32(health.recoveries));
+
+        // one Sensor fault for the node, active while any sensor is failed
+        bool failed = health.state == SENSOR_HEALTH_FAILED;
+        if (failed != s_sensor_failed[slot]) {
+            ESP_LOGW(TAG, "Sensor %u %s", (unsigned)slot, failed ? "failed" : "back");
+            bool was_active = any_sensor_failed();
+            s_sensor_failed[slot] = failed;
+            if (any_sensor_failed() != was_active) {
+                report_sensor_fault(!was_active);
+            }
+        }
     });
 }
 
+#if CONFIG_SENSOR_CO2_ALARM
+// Manufacturer specific cluster on each air quality endpoint: the sensor_alarm.h level of the
+// filtered CO2, its thresholds, and a ThresholdCrossed event whenever the level changes
+typedef enum {
+    // enum8, 0 normal, 1 ventilate, 2 high
+    ALARM_ATTR_LEVEL,
+    // uint16 ppm each, writable, kept across reboots by esp_matter
+    ALARM_ATTR_VENTILATE_RISE,
+    ALARM_ATTR_VENTILATE_FALL,
+    ALARM_ATTR_HIGH_RISE,
+    ALARM_ATTR_HIGH_FALL,
+    ALARM_ATTR_COUNT,
+} alarm_attr_t;
+
+#define ALARM_EVENT_THRESHOLD_CROSSED 0x00
+
+static_assert(SENSOR_ALARM_LEVELS * 2 == ALARM_ATTR_COUNT - ALARM_ATTR_VENTILATE_RISE,
+              "a rise and a fall attribute per alarm level");
+
+// ThresholdCrossed: level (enum8), previous level (enum8), filtered CO2 in ppm (uint16).
+// Critical while the level rises, so it outlives routine events in the event buffers.
+struct alarm_threshold_crossed_event {
+    static constexpr bool kIsFabricScoped = false;
+
+    uint8_t level;
+    uint8_t previous;
+    uint16_t co2_ppm;
+
+    chip::app::PriorityLevel GetPriorityLevel() const
+    {
+        return level > previous ? chip::app::PriorityLevel::Critical : chip::app::PriorityLevel::Info;
+    }
+    static constexpr chip::EventId GetEventId() { return ALARM_EVENT_THRESHOLD_CROSSED; }
+    static constexpr chip::ClusterId GetClusterId() { return CONFIG_SENSOR_CO2_ALARM_CLUSTER_ID; }
+
+    CHIP_ERROR Encode(chip::TLV::TLVWriter &writer, chip::TLV::Tag tag) const
+    {
+        chip::TLV::TLVType outer;
+        ReturnErrorOnFailure(writer.StartContainer(tag, chip::TLV::kTLVType_Structure, outer));
+        ReturnErrorOnFailure(writer.Put(chip::TLV::ContextTag(0), level));
+        ReturnErrorOnFailure(writer.Put(chip::TLV::ContextTag(1), previous));
+        ReturnErrorOnFailure(writer.Put(chip::TLV::ContextTag(2), co2_ppm));
+        return writer.EndContainer(outer);
+    }
+};
+
+static attribute_t *s_alarm_attrs[SCD4X_SENSOR_MAX][ALARM_ATTR_COUNT];
+static uint16_t s_alarm_endpoint_ids[SCD4X_SENSOR_MAX];
+// by registry slot, matter thread only
+static sensor_alarm_t s_alarms[SCD4X_SENSOR_MAX];
 
-// Application cluster specification, 2.6.4.1. MeasuredValue Attribute
-// represents the humidity in percent.
-// humidity = (humidity in %) x 100
-static void humidity_sensor_notification(uint16_t endpoint_id, float humidity, void *user_data)
+static uint16_t *alarm_threshold(sensor_alarm_config_t *config, uint32_t attr)
 {
-    // schedule the attribute update so that we can report it from matter thread
-    chip::DeviceLayer::SystemLayer().ScheduleLambda([endpoint_id, humidity]() {
-        attribute_t * attribute = attribute::get(endpoint_id,
-                                                 RelativeHumidityMeasurement::Id,
-                                                 RelativeHumidityMeasurement::Attributes::MeasuredValue::Id);
+    sensor_alarm_threshold_t *level = &config->levels[(attr - ALARM_ATTR_VENTILATE_RISE) / 2];
+    return (attr - ALARM_ATTR_VENTILATE_RISE) % 2 == 0 ? &level->rise_ppm : &level->fall_ppm;
+}
 
+static void alarm_cluster_create(size_t slot, endpoint_t *endpoint)
+{
+    sensor_alarm_config_t config;
+    sensor_alarm_config_default(&config);
+    cluster_t *cluster = cluster::create(endpoint, CONFIG_SENSOR_CO2_ALARM_CLUSTER_ID, CLUSTER_FLAG_SERVER);
+    if (cluster == nullptr) {
+        ESP_LOGE(TAG, "Failed to create CO2 alarm cluster");
+        sensor_alarm_init(&s_alarms[slot], &config);
+        return;
+    }
+    attribute::create(cluster, Globals::Attributes::ClusterRevision::Id, 0, esp_matter_uint16(1));
+    attribute_t **attrs = s_alarm_attrs[slot];
+    attrs[ALARM_ATTR_LEVEL] = attribute::create(cluster, ALARM_ATTR_LEVEL, 0, esp_matter_enum8(0));
+    // a stored threshold comes back with the attribute
+    sensor_alarm_config_t stored = config;
+    for (uint32_t id = ALARM_ATTR_VENTILATE_RISE; id < ALARM_ATTR_COUNT; id++) {
+        attrs[id] = attribute::create(cluster, id, ATTRIBUTE_FLAG_WRITABLE | ATTRIBUTE_FLAG_NONVOLATILE,
+                                      esp_matter_uint16(*alarm_threshold(&config, id)));
         esp_matter_attr_val_t val = esp_matter_invalid(NULL);
-        attribute::get_val(attribute, &val);
-        val.val.u16 = static_cast<uint16_t>(humidity * 100);
+        if (attrs[id] && attribute::get_val(attrs[id], &val) == ESP_OK) {
+            *alarm_threshold(&stored, id) = val.val.u16;
+        }
+    }
+    if (sensor_alarm_config_valid(&stored)) {
+        config = stored;
+    } else {
+        ESP_LOGW(TAG, "Stored CO2 alarm thresholds of sensor %u are inconsistent, using the defaults", (unsigned)slot);
+    }
+    event::create(cluster, ALARM_EVENT_THRESHOLD_CROSSED);
+    s_alarm_endpoint_ids[slot] = endpoint::get_id(endpoint);
+    sensor_alarm_init(&s_alarms[slot], &config);
+}
 
-        attribute::update(endpoint_id, RelativeHumidityMeasurement::Id, RelativeHumidityMeasurement::Attributes::MeasuredValue::Id, &val);
-    });
+// Registry slot of an alarm cluster endpoint, SCD4X_SENSOR_MAX if none
+static size_t alarm_slot(uint16_t endpoint_id)
+{
+    for (size_t slot = 0; slot < SCD4X_SENSOR_MAX; slot++) {
+        if (s_alarm_attrs[slot][ALARM_ATTR_LEVEL] && s_alarm_endpoint_ids[slot] == endpoint_id) {
+            return slot;
+        }
+    }
+    return SCD4X_SENSOR_MAX;
 }
 
-// CO2 concentration measurement
-// represents CO2 concentration in parts per million (ppm)
-static void co2_sensor_notification(uint16_t endpoint_id, float co2_ppm, void *user_data)
+// A controller writes a threshold: refused unless the levels stay consistent, applied after the write
+static esp_err_t alarm_threshold_update(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t attribute_id,
+                                       const esp_matter_attr_val_t *val)
 {
-    chip::DeviceLayer::SystemLayer().ScheduleLambda([endpoint_id, co2_ppm]() {
-        // 1) CO2 MeasuredValue(float) 갱신
-        if (auto *attr = attribute::get(endpoint_id,
-                Clusters::CarbonDioxideConcentrationMeasurement::Id,
-                Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasuredValue::Id)) {
+    size_t slot = alarm_slot(endpoint_id);
+    if (slot == SCD4X_SENSOR_MAX || attribute_id < ALARM_ATTR_VENTILATE_RISE || attribute_id >= ALARM_ATTR_COUNT) {
+        return type == PRE_UPDATE ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+    }
+    sensor_alarm_config_t config = s_alarms[slot].config;
+    *alarm_threshold(&config, attribute_id) = val->val.u16;
+    if (!sensor_alarm_config_valid(&config)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (type == POST_UPDATE) {
+        sensor_alarm_set_config(&s_alarms[slot], &config);
+        ESP_LOGI(TAG, "Sensor %u CO2 alarm: ventilate %u/%u ppm, high %u/%u ppm", (unsigned)slot,
+                 config.levels[0].rise_ppm, config.levels[0].fall_ppm, config.levels[1].rise_ppm,
+                 config.levels[1].fall_ppm);
+    }
+    return ESP_OK;
+}
 
-            esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-            attribute::get_val(attr, &v);
-            v.val.f = co2_ppm;                 // 타입 지정 불필요(속성 타입 유지)
-            attribute::update(endpoint_id,
-                Clusters::CarbonDioxideConcentrationMeasurement::Id,
-                Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasuredValue::Id, &v);
+// The next sample after the sample interval rather than a stretched one
+static void alarm_sample_soon(size_t sensor)
+{
+#if CONFIG_SENSOR_ADAPTIVE_SAMPLING
+    sensor_task_set_interval(sensor, sensor_adapt_snap(&s_adapt[sensor]));
+#elif CONFIG_SENSOR_DEMAND_SAMPLING
+    if (sensor_demand_interval_ms(&s_demand, sensor) > s_demand.base_ms[sensor]) {
+        sensor_task_request_sample(sensor);
+    }
+#endif
+}
+
+// Drain pipeline alarm callback, ctx: the registry slot
+static void alarm_update(size_t sensor, sensor_alarm_result_t result, uint8_t previous, uint16_t co2_ppm, void *ctx)
+{
+    size_t slot = (uintptr_t)ctx;
+    sensor_alarm_t *alarm = &s_alarms[slot];
+    if (result == SENSOR_ALARM_PENDING) {
+        // confirmed by the next sample, which should not be a stretched interval away
+        alarm_sample_soon(sensor);
+        return;
+    }
+    if (s_alarm_attrs[slot][ALARM_ATTR_LEVEL]) {
+        esp_matter_attr_val_t val = esp_matter_enum8(alarm->level);
+        attribute::set_val(s_alarm_attrs[slot][ALARM_ATTR_LEVEL], &val);
+        MatterReportingAttributeChangeCallback(s_alarm_endpoint_ids[slot], CONFIG_SENSOR_CO2_ALARM_CLUSTER_ID,
+                                               ALARM_ATTR_LEVEL);
+        // subscribers that marked the event path urgent get it now, inside their min interval
+        alarm_threshold_crossed_event event = { alarm->level, previous, co2_ppm };
+        chip::EventNumber number;
+        CHIP_ERROR err = LogEvent(event, s_alarm_endpoint_ids[slot], number);
+        if (err != CHIP_NO_ERROR) {
+            ESP_LOGE(TAG, "Failed to log the CO2 alarm event, err:%" CHIP_ERROR_FORMAT, err.Format());
         }
+    }
+#if CONFIG_ENABLE_ICD_SERVER
+    // active mode now: the report leaves on the next fast poll, and a LIT device checks in with
+    // the clients that are not subscribed
+    chip::app::ICDNotifier::GetInstance().NotifyNetworkActivityNotification();
+#endif
+    ESP_LOGI(TAG, "Sensor %u CO2 %u ppm: %s -> %s", (unsigned)slot, co2_ppm, sensor_alarm_level_name(previous),
+             sensor_alarm_level_name(alarm->level));
+}
+#endif // CONFIG_SENSOR_CO2_ALARM
 
-        // 2) AirQuality(enum) 갱신 → HA의 "Air quality" 채워짐
-        if (auto *attr_aq = attribute::get(endpoint_id,
-                Clusters::AirQuality::Id,
-                Clusters::AirQuality::Attributes::AirQuality::Id)) {
-
-            esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-            attribute::get_val(attr_aq, &v);
-            v.val.u8 = map_co2_to_air_quality_enum(co2_ppm);  // enum 값
-            attribute::update(endpoint_id,
-                Clusters::AirQuality::Id,
-                Clusters::AirQuality::Attributes::AirQuality::Id, &v);
+#if CONFIG_ENABLE_CHIP_SHELL
+static esp_err_t boot_console_handler(int argc, char **argv)
+{
+    boot_timeline_print();
+    return ESP_OK;
+}
+
+static esp_err_t event_log_console_handler(int argc, char **argv)
+{
+    if (argc == 1 && strcmp(argv[0], "hex") == 0) {
+        event_log_print_hex();
+    } else if (argc == 1 && strcmp(argv[0], "clear") == 0) {
+        event_log_clear();
+    } else {
+        event_log_print();
+    }
+    return ESP_OK;
+}
+
+// sensors                                   print the table and each sensor's health
+// sensors set <i> <port> <sda> <scl> <ch|-1> <interval_s>   store slot i (i == count appends)
+// sensors erase                             back to the Kconfig table
+// Changes to the table take effect after a reboot.
+static esp_err_t sensors_console_handler(int argc, char **argv)
+{
+    sensor_registry_t registry;
+    sensor_registry_load(&registry);
+
+    if (argc == 1 && strcmp(argv[0], "erase") == 0) {
+        return sensor_registry_erase();
+    }
+    if (argc == 7 && strcmp(argv[0], "set") == 0) {
+        size_t i = (size_t)atoi(argv[1]);
+        int channel = atoi(argv[5]);
+        if (i > registry.count || i >= SCD4X_SENSOR_MAX || channel > 7) {
+            return ESP_ERR_INVALID_ARG;
         }
-    });
+        registry.slots[i] = {
+            .i2c_port = (uint8_t)atoi(argv[2]),
+            .sda_gpio = (uint8_t)atoi(argv[3]),
+            .scl_gpio = (uint8_t)atoi(argv[4]),
+            .mux_channel = channel < 0 ? (uint8_t)SENSOR_MUX_NONE : (uint8_t)channel,
+            .interval_s = (uint16_t)atoi(argv[6]),
+        };
+        if (i == registry.count) {
+            registry.count++;
+        }
+        return sensor_registry_save(&registry);
+    }
+
+    for (size_t slot = 0; slot < registry.count; slot++) {
+        const sensor_slot_t *s = &registry.slots[slot];
+        printf("slot %u: port %u sda %u scl %u channel %d interval %lu ms\n", (unsigned)slot, s->i2c_port,
+               s->sda_gpio, s->scl_gpio, s->mux_channel == SENSOR_MUX_NONE ? -1 : s->mux_channel,
+               (unsigned long)sensor_slot_interval_ms(s));
+    }
+    for (size_t sensor = 0; sensor < sensor_task_count(); sensor++) {
+        sensor_health_t health;
+        sensor_task_get_health(sensor, &health);
+        printf("sensor %u (slot %u): %s, %lu failures, %lu resets\n", (unsigned)sensor,
+               (unsigned)s_task_slot[sensor], sensor_health_name(health.state), (unsigned long)health.failures,
+               (unsigned long)health.resets);
+        scd41_bus_stats_t bus;
+        sensor_task_get_bus_stats(sensor, &bus);
+        printf("  bus %lu kHz, %lu fallbacks, %lu raises: %lu transactions, mean %lu us, max %lu us, %lu NACK, "
+               "%lu timeout, %lu CRC, %lu other\n", (unsigned long)(bus.clock_hz / 1000),
+               (unsigned long)bus.clock_fallbacks, (unsigned long)bus.clock_raises, (unsigned long)bus.transactions,
+               (unsigned long)(bus.transactions ? bus.busy_us / bus.transactions : 0), (unsigned long)bus.max_us,
+               (unsigned long)bus.nacks, (unsigned long)bus.timeouts, (unsigned long)bus.crc_errors,
+               (unsigned long)bus.other_errors);
+    }
+    return ESP_OK;
+}
+
+// report                                    print the report policy of each attribute
+// report <attr> <deadband> <min_s> <max_s>  store an attribute's policy, attr by its NVS key
+// A stored policy applies to every sensor from its next sample on.
+static esp_err_t report_console_handler(int argc, char **argv)
+{
+    if (argc == 4) {
+        int attr = 0;
+        while (attr < SENSOR_ATTR_COUNT && strcmp(argv[0], report_config_key((sensor_attr_t)attr)) != 0) {
+            attr++;
+        }
+        sensor_report_policy_t policy = {
+            .deadband = (uint32_t)strtoul(argv[1], NULL, 10),
+            .min_interval_s = (uint32_t)strtoul(argv[2], NULL, 10),
+            .max_interval_s = (uint32_t)strtoul(argv[3], NULL, 10),
+        };
+        if (attr == SENSOR_ATTR_COUNT || (policy.max_interval_s && policy.max_interval_s < policy.min_interval_s)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t err = report_config_save((sensor_attr_t)attr, &policy);
+        if (err != ESP_OK) {
+            return err;
+        }
+        // the commit state belongs to the matter thread
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        for (sensor_pipeline_t &state : s_sensor_state) {
+            state.commit.policy[attr] = policy;
+        }
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+        return ESP_OK;
+    }
+    if (argc != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT];
+    report_config_load(policy);
+    for (int attr = 0; attr < SENSOR_ATTR_COUNT; attr++) {
+        printf("%-12s deadband %lu, interval %lu..%lu s\n", report_config_key((sensor_attr_t)attr),
+               (unsigned long)policy[attr].deadband, (unsigned long)policy[attr].min_interval_s,
+               (unsigned long)policy[attr].max_interval_s);
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_SENSOR_HISTORY
+// history           samples as CSV, oldest first
+// history hex       the blocks as hex, for host/tools/history_decode
+// history flush     seal the partly filled blocks, e.g. before unplugging
+// The history belongs to the matter thread, it is copied out a block at a time.
+static esp_err_t history_console_handler(int argc, char **argv)
+{
+    if (argc == 1 && strcmp(argv[0], "flush") == 0) {
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        sensor_history_flush();
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+        return ESP_OK;
+    }
+    bool hex = argc == 1 && strcmp(argv[0], "hex") == 0;
+    uint8_t block[SENSOR_HISTORY_BLOCK_SIZE];
+    uint32_t first, next;
+    sensor_history_stats_t stats;
+    chip::DeviceLayer::PlatformMgr().LockChipStack();
+    sensor_history_range(&first, &next);
+    sensor_history_get_stats(&stats);
+    chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+
+    if (!hex) {
+        printf("boot,sensor,time_s,co2_ppm,temperature_c,humidity_pct\n");
+    }
+    for (uint32_t seq = first; seq < next; seq++) {
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        bool copied = sensor_history_copy_block(seq, block);
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+        if (copied) {
+            sensor_history_print_block(block, hex);
+        }
+    }
+    for (size_t sensor = 0; sensor < SCD4X_SENSOR_MAX; sensor++) {
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        bool copied = sensor_history_copy_open(sensor, block);
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+        if (copied) {
+            sensor_history_print_block(block, hex);
+        }
+    }
+    if (!hex) {
+        printf("# %lu samples in %lu bytes, %lu blocks sealed, %lu writes, %lu erases, %lu write errors\n",
+               (unsigned long)stats.samples, (unsigned long)stats.bytes, (unsigned long)stats.sealed,
+               (unsigned long)stats.writes, (unsigned long)stats.erases, (unsigned long)stats.write_errors);
+    }
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t heap_console_handler(int argc, char **argv)
+{
+    telemetry_t telemetry;
+    telemetry_read(&telemetry);
+    telemetry_print(&telemetry);
+    return ESP_OK;
+}
+
+#if CONFIG_SENSOR_PROBES
+static esp_err_t probes_console_handler(int argc, char **argv)
+{
+    if (argc == 1 && strcmp(argv[0], "reset") == 0) {
+        sensor_probe_reset();
+        return ESP_OK;
+    }
+    sensor_probe_print();
+    return ESP_OK;
+}
+#endif
+
+static void app_console_register(void)
+{
+    static const esp_matter::console::command_t commands[] = {
+        {
+            .name = "boot",
+            .description = "Boot timeline. Usage: matter esp boot",
+            .handler = boot_console_handler,
+        },
+        {
+            .name = "evlog",
+            .description = "Sensor event log. Usage: matter esp evlog [hex|clear]",
+            .handler = event_log_console_handler,
+        },
+        {
+            .name = "sensors",
+            .description = "Sensor table, health and bus counters. Usage: matter esp sensors "
+                           "[set <i> <port> <sda> <scl> <ch|-1> <interval_s>|erase]",
+            .handler = sensors_console_handler,
+        },
+        {
+            .name = "report",
+            .description = "Report policy per attribute. Usage: matter esp report "
+                           "[<attr> <deadband> <min_s> <max_s>]",
+            .handler = report_console_handler,
+        },
+        {
+            .name = "heap",
+            .description = "Heap, stack high-water marks and sample path allocations. Usage: matter esp heap",
+            .handler = heap_console_handler,
+        },
+#if CONFIG_SENSOR_HISTORY
+        {
+            .name = "history",
+            .description = "Compressed sample history. Usage: matter esp history [hex|flush]",
+            .handler = history_console_handler,
+        },
+#endif
+#if CONFIG_SENSOR_PROBES
+        {
+            .name = "probes",
+            .description = "Sensor hot path histograms and counters. Usage: matter esp probes [reset]",
+            .handler = probes_console_handler,
+        },
+#endif
+    };
+    esp_matter::console::add_commands(commands, sizeof(commands) / sizeof(commands[0]));
+}
+#endif
+
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+static void demand_changed(void)
+{
+    for (size_t sensor = 0; sensor < s_task_count; sensor++) {
+#if CONFIG_SENSOR_ADAPTIVE_SAMPLING
+        // the demand caps how far a flat room stretches the interval
+        sensor_adapt_set_range(&s_adapt[sensor], s_demand.base_ms[sensor], sensor_demand_interval_ms(&s_demand, sensor));
+        sensor_task_set_interval(sensor, s_adapt[sensor].interval_ms);
+#else
+        sensor_task_set_interval(sensor, sensor_demand_interval_ms(&s_demand, sensor));
+#endif
+    }
+}
+
+// the sensor's measured attributes include one matched by path
+static bool path_covers_sensor(const AttributePathParams &path, size_t sensor)
+{
+    for (const measured_attr_t &attr : s_measured_attrs[s_task_slot[sensor]]) {
+        if ((path.HasWildcardEndpointId() || path.mEndpointId == attr.endpoint_id) &&
+                (path.HasWildcardClusterId() || path.mClusterId == attr.cluster_id) &&
+                (path.HasWildcardAttributeId() || path.mAttributeId == attr.attribute_id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bit i set: the subscription reports sensor i
+static uint32_t subscription_sensor_mask(ReadHandler &handler)
+{
+    uint32_t mask = 0;
+    for (auto *node = handler.GetAttributePathList(); node != nullptr; node = node->mpNext) {
+        for (size_t sensor = 0; sensor < s_task_count; sensor++) {
+            if (path_covers_sensor(node->mValue, sensor)) {
+                mask |= 1u << sensor;
+            }
+        }
+    }
+    return mask;
+}
+
+// Event only subscriptions and ones on other endpoints end up with an empty mask and do not count
+class sensor_demand_callback : public ReadHandler::ApplicationCallback {
+public:
+    void OnSubscriptionEstablished(ReadHandler &handler) override
+    {
+        uint16_t min_interval_s, max_interval_s;
+        handler.GetReportingIntervals(min_interval_s, max_interval_s);
+        sensor_demand_subscribe(&s_demand, &handler, subscription_sensor_mask(handler), max_interval_s * 1000u);
+        demand_changed();
+    }
+
+    void OnSubscriptionTerminated(ReadHandler &handler) override
+    {
+        // the path list is still there, it gives the same mask as when the subscription was added
+        sensor_demand_unsubscribe(&s_demand, &handler, subscription_sensor_mask(handler));
+        demand_changed();
+    }
+};
+
+static sensor_demand_callback s_demand_callback;
+#endif // CONFIG_SENSOR_DEMAND_SAMPLING
+
+#if CONFIG_SENSOR_SAMPLE_ON_READ
+/*
+  Sees every read of a measured cluster, including the ones that build
+  subscription reports, but encodes nothing, so the value still comes from
+  the attribute store. sensor_demand_on_read() leaves subscribed sensors alone.
+*/
+class sensor_read_trigger : public AttributeAccessInterface {
+public:
+    explicit sensor_read_trigger(chip::ClusterId cluster_id) : AttributeAccessInterface(chip::NullOptional, cluster_id) {}
+
+    CHIP_ERROR Read(const ConcreteReadAttributePath &path, AttributeValueEncoder &encoder) override
+    {
+        int64_t now = esp_timer_get_time();
+        for (size_t sensor = 0; sensor < s_task_count; sensor++) {
+            if (path_covers_sensor(AttributePathParams(path.mEndpointId, path.mClusterId, path.mAttributeId), sensor) &&
+                    sensor_demand_on_read(&s_demand, sensor, now - s_last_sample_us[sensor])) {
+                sensor_task_request_sample(sensor);
+            }
+        }
+        return CHIP_NO_ERROR;
+    }
+};
+
+static sensor_read_trigger s_read_triggers[] = {
+    sensor_read_trigger(TemperatureMeasurement::Id),
+    sensor_read_trigger(RelativeHumidityMeasurement::Id),
+    sensor_read_trigger(CDCM::Id),
+    sensor_read_trigger(AirQuality::Id),
+};
+#endif // CONFIG_SENSOR_SAMPLE_ON_READ
+
+// set while a drain is scheduled on the matter thread
+static std::atomic<bool> s_drain_pending;
+
+// matter thread, arg: the probe cycle count the hop started at
+static void drain_measurements(intptr_t arg)
+{
+#if CONFIG_SENSOR_PROBES
+    uint32_t hop_start = (uint32_t)arg;
+    SENSOR_PROBE_END(SENSOR_PROBE_HOP, hop_start);
+#endif
+    // clear first: a measurement queued during the drain schedules a new one
+    s_drain_pending = false;
+    // from here to the end of the loop nothing may allocate, telemetry.h counts it if something does
+    telemetry_drain_begin();
+    sensor_measurement_t measurement;
+    while (sensor_measurement_pop(&measurement)) {
+        // the previous boot's last values only go back into the attributes, they set no boot timeline mark
+        if (!sensor_pipeline_apply(&s_sensor_state[s_task_slot[measurement.sensor]], &measurement,
+                                   esp_timer_get_time())) {
+            continue;
+        }
+        boot_timeline_mark(BOOT_MARK_FIRST_SAMPLE);
+#if CONFIG_SENSOR_SAMPLE_ON_READ
+        s_last_sample_us[measurement.sensor] = esp_timer_get_time();
+#endif
+        // the first sample writes every attribute, they stop being null
+        if (boot_timeline_mark(BOOT_MARK_FIRST_REPORT)) {
+            scd4x_sensor_stats_t stats;
+            sensor_task_get_stats(measurement.sensor, &stats);
+            boot_timeline_mark_at(BOOT_MARK_SENSOR_READY, stats.ready_us);
+            boot_timeline_print();
+            // startup is over, the next drains and the sensor task are watched
+            telemetry_watch_start();
+        }
+    }
+    telemetry_drain_end();
+#if CONFIG_SENSOR_PROBES
+    // the octet string attribute is reallocated by set_val, outside the watched part
+    probe_attr_refresh();
+#endif
+    telemetry_refresh();
+}
+
+static void sensor_notification(void *user_data)
+{
+    // one matter thread hop drains everything queued until it runs. The hop is a plain work item
+    // copied into the platform event queue and there is never more than one in flight, so handing
+    // samples over takes no memory beyond the static measurement queue.
+    if (s_drain_pending.exchange(true)) {
+        return;
+    }
+#if CONFIG_SENSOR_PROBES
+    SENSOR_PROBE_BEGIN(hop_start);
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(drain_measurements, (intptr_t)hop_start);
+#else
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(drain_measurements, 0);
+#endif
+}
+
+#if CONFIG_ENABLE_ICD_SERVER
+static sensor_icd_mode_t current_icd_mode(void)
+{
+    return chip::ICDConfigurationData::GetInstance().GetICDMode() == chip::ICDConfigurationData::ICDMode::LIT
+           ? SENSOR_ICD_LIT : SENSOR_ICD_SIT;
+}
+
+#if CONFIG_SENSOR_WAKE_COALESCING
+// Idle mode starts the slow data polls, they and the next check-in follow on this grid
+static void wake_grid_update(void)
+{
+    uint32_t period_ms = chip::ICDConfigurationData::GetInstance().GetSlowPollingInterval().count();
+    sensor_task_set_wake_grid(period_ms, esp_timer_get_time(), CONFIG_SENSOR_WAKE_SLIP_PCT);
+}
+#endif
+
+// A LIT ICD runs as SIT until a client registers, the sensor mode follows
+class sensor_icd_observer : public chip::app::ICDStateObserver {
+public:
+    void OnEnterActiveMode() override {}
+#if CONFIG_SENSOR_WAKE_COALESCING
+    void OnEnterIdleMode() override { wake_grid_update(); }
+#else
+    void OnEnterIdleMode() override {}
+#endif
+    void OnTransitionToIdle() override {}
+    void OnICDModeChange() override { sensor_task_set_icd_mode(current_icd_mode()); }
+};
+
+static sensor_icd_observer s_icd_observer;
+#endif
+
+// the sensor kept its supply, so RTC retained sensor state is still true
+static bool is_warm_reset(void)
+{
+    switch (esp_reset_reason()) {
+    case ESP_RST_POWERON:
+    case ESP_RST_BROWNOUT:
+    case ESP_RST_UNKNOWN:
+        return false;
+    default:
+        return true;
+    }
 }
 
 constexpr auto k_timeout_seconds = 300;
@@ -168,6 +1080,34 @@ constexpr auto k_timeout_seconds = 300;
 static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
 {
     switch (event->Type) {
+    case chip::DeviceLayer::DeviceEventType::kServerReady:
+        boot_timeline_mark(BOOT_MARK_SERVER_READY);
+#if CONFIG_ENABLE_ICD_SERVER
+        chip::Server::GetInstance().GetICDManager().RegisterObserver(&s_icd_observer);
+        sensor_task_set_icd_mode(current_icd_mode());
+#endif
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+        InteractionModelEngine::GetInstance()->RegisterReadHandlerAppCallback(&s_demand_callback);
+#endif
+#if CONFIG_SENSOR_SAMPLE_ON_READ
+        for (sensor_read_trigger &trigger : s_read_triggers) {
+            if (!AttributeAccessInterfaceRegistry::Instance().Register(&trigger)) {
+                ESP_LOGW(TAG, "Read trigger for cluster 0x%04" PRIx32 " not registered", trigger.GetClusterId());
+            }
+        }
+#endif
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kCHIPoBLEAdvertisingChange:
+        if (event->CHIPoBLEAdvertisingChange.Result == chip::DeviceLayer::kActivity_Started) {
+            boot_timeline_mark(BOOT_MARK_ADVERTISE);
+        }
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kDnssdInitialized:
+        boot_timeline_mark(BOOT_MARK_ADVERTISE);
+        break;
+
     case chip::DeviceLayer::DeviceEventType::kInterfaceIpAddressChanged:
         ESP_LOGI(TAG, "Interface IP Address changed");
         break;
@@ -176,6 +1116,15 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
         ESP_LOGI(TAG, "Commissioning complete");
         break;
 
+#if CONFIG_SENSOR_HISTORY
+    case chip::DeviceLayer::DeviceEventType::kOtaStateChanged:
+        // the restart into the new image would lose the blocks being filled
+        if (event->OtaStateChanged.newState == chip::DeviceLayer::kOtaApplyComplete) {
+            sensor_history_flush();
+        }
+        break;
+#endif
+
     case chip::DeviceLayer::DeviceEventType::kFailSafeTimerExpired:
         ESP_LOGI(TAG, "Commissioning failed, fail safe timer expired");
         break;
@@ -189,6 +1138,7 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
         break;
 
     case chip::DeviceLayer::DeviceEventType::kCommissioningWindowOpened:
+        boot_timeline_mark(BOOT_MARK_ADVERTISE);
         ESP_LOGI(TAG, "Commissioning window opened");
         break;
 
@@ -250,90 +1200,61 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
     if (type == PRE_UPDATE) {
         /* Driver update */
     }
+#if CONFIG_SENSOR_CO2_ALARM
+    if (cluster_id == CONFIG_SENSOR_CO2_ALARM_CLUSTER_ID && (type == PRE_UPDATE || type == POST_UPDATE)) {
+        err = alarm_threshold_update(type, endpoint_id, attribute_id, val);
+    }
+#endif
 
     return err;
 }
 
-typedef struct {
-    scd4x_sensor_config_t *config;
-    esp_timer_handle_t timer;
-    bool is_initialized = false;
-} scd4x_sensor_ctx_t;
-
-static scd4x_sensor_ctx_t s_ctx;
-
-static void timer_cb_internal(void *arg)
+// Temperature, humidity and air quality (with CO2 concentration) endpoints of one sensor
+static esp_err_t create_sensor_endpoints(node_t *node, endpoint_t *eps[SENSOR_EP_COUNT])
 {
-    auto *ctx = (scd4x_sensor_ctx_t *) arg;
-    if (!(ctx && ctx->config)) {
-        return;
-    }
-
-    float temp, humidity;
-    uint16_t co2;
-    esp_err_t err = sensor_get(&temp, &humidity, &co2);
-    if (err != ESP_OK) {
-        return;
-    }
-    if (ctx->config->temperature.cb) {
-        ctx->config->temperature.cb(ctx->config->temperature.endpoint_id, temp, ctx->config->user_data);
-    }
-    if (ctx->config->humidity.cb) {
-        ctx->config->humidity.cb(ctx->config->humidity.endpoint_id, humidity, ctx->config->user_data);
-    }
-    if (ctx->config->co2.cb) {
-        ctx->config->co2.cb(ctx->config->co2.endpoint_id, (float)co2, ctx->config->user_data);
-    }    
-}
+    // add temperature sensor device
+    temperature_sensor::config_t temp_sensor_config;
+    eps[SENSOR_EP_TEMPERATURE] = temperature_sensor::create(node, &temp_sensor_config, ENDPOINT_FLAG_NONE, NULL);
 
-static esp_err_t sensor_timer_init( scd4x_sensor_config_t *config )
-{
-    esp_err_t err = ESP_OK;
+    // add the humidity sensor device
+    humidity_sensor::config_t humidity_sensor_config;
+    eps[SENSOR_EP_HUMIDITY] = humidity_sensor::create(node, &humidity_sensor_config, ENDPOINT_FLAG_NONE, NULL);
 
-    if (config == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    // we need at least one callback so that we can start notifying application layer
-    if (config->temperature.cb == NULL || config->humidity.cb == NULL) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    if (s_ctx.is_initialized) {
-        return ESP_ERR_INVALID_STATE;
+    // add CO2 sensor device
+    air_quality_sensor::config_t co2_sensor_config;
+    eps[SENSOR_EP_AIR_QUALITY] = air_quality_sensor::create(node, &co2_sensor_config, ENDPOINT_FLAG_NONE, NULL);
+    if (!eps[SENSOR_EP_TEMPERATURE] || !eps[SENSOR_EP_HUMIDITY] || !eps[SENSOR_EP_AIR_QUALITY]) {
+        return ESP_FAIL;
     }
 
-    // keep the pointer to config
-    s_ctx.config = config;    
-
-    esp_timer_create_args_t args = {
-        .callback = timer_cb_internal,
-        .arg = &s_ctx,
-    };
-
-    err = esp_timer_create(&args, &s_ctx.timer);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_timer_create failed, err:%d", err);
-        return err;
+    // [ADD] Air Quality 엔드포인트에 CO2 농도 측정 클러스터(서버) 붙이기
+    cluster_t *co2_cluster = cluster::create(eps[SENSOR_EP_AIR_QUALITY], CDCM::Id, CLUSTER_FLAG_SERVER);
+    if (co2_cluster == nullptr) {
+        ESP_LOGE(TAG, "Failed to create CO2 cluster");
+        return ESP_FAIL;
     }
-
-    #if 1
-    err = esp_timer_start_periodic(s_ctx.timer, config->interval_ms * 1000);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_timer_start_periodic failed: %d", err);
-        return err;
+    create_attributes(co2_cluster, k_co2_attr_descs, sizeof(k_co2_attr_descs) / sizeof(k_co2_attr_descs[0]));
+
+    // FeatureMap: numeric measurement with peak and average
+    uint32_t feature_map = chip::to_underlying(CDCM::Feature::kNumericMeasurement) |
+                           chip::to_underlying(CDCM::Feature::kPeakMeasurement) |
+                           chip::to_underlying(CDCM::Feature::kAverageMeasurement);
+    attribute_t *feature_attr = attribute::get(co2_cluster, Globals::Attributes::FeatureMap::Id);
+    if (feature_attr) {
+        esp_matter_attr_val_t v = esp_matter_invalid(NULL);
+        attribute::get_val(feature_attr, &v);
+        v.val.u32 |= feature_map;
+        attribute::set_val(feature_attr, &v);
+    } else {
+        attribute::create(co2_cluster, Globals::Attributes::FeatureMap::Id, 0, esp_matter_bitmap32(feature_map));
     }
-    #endif
-
-
-    s_ctx.is_initialized = true;
-    ESP_LOGI(TAG, "shtc3 initialized successfully");
-    
     return ESP_OK;
 }
 
-
 extern "C" void app_main()
 {
     esp_err_t err = ESP_OK;
+    boot_timeline_mark(BOOT_MARK_APP_MAIN);
 
     /* Initialize the ESP NVS layer */
     nvs_flash_init();
@@ -352,14 +1273,22 @@ extern "C" void app_main()
     app_driver_button_init();
 #endif
 
-    sensor_init();
+    sensor_registry_t registry;
+    sensor_registry_load(&registry);
+    scd41_t *devs[SCD4X_SENSOR_MAX];
+    size_t sensor_count = sensor_init(&registry, devs);
+    if (sensor_count < registry.count) {
+        ESP_LOGW(TAG, "%u of %u sensors could not be set up", (unsigned)(registry.count - sensor_count),
+                 (unsigned)registry.count);
+    }
 #if 0
     float temp, humidity;
     uint16_t co2;
 
+    sensor_start(devs[0]);
     for( int i = 0; i < 100000; i++ ) {
         vTaskDelay(pdMS_TO_TICKS(5000));
-        sensor_get(&temp, &humidity, &co2);
+        sensor_get(devs[0], &temp, &humidity, &co2);
     }
 #endif
     /* Create a Matter node and add the mandatory Root Node device type on endpoint 0 */
@@ -373,92 +1302,99 @@ extern "C" void app_main()
     ABORT_APP_ON_FAILURE(app_endpoint != nullptr, ESP_LOGE(TAG, "Failed to create on off light endpoint"));
 #endif    
 
-    // add temperature sensor device
-    temperature_sensor::config_t temp_sensor_config;
-    endpoint_t * temp_sensor_ep = temperature_sensor::create(node, &temp_sensor_config, ENDPOINT_FLAG_NONE, NULL);
-    ABORT_APP_ON_FAILURE(temp_sensor_ep != nullptr, ESP_LOGE(TAG, "Failed to create temperature_sensor endpoint"));
-
-    // add the humidity sensor device
-    humidity_sensor::config_t humidity_sensor_config;
-    endpoint_t * humidity_sensor_ep = humidity_sensor::create(node, &humidity_sensor_config, ENDPOINT_FLAG_NONE, NULL);
-    ABORT_APP_ON_FAILURE(humidity_sensor_ep != nullptr, ESP_LOGE(TAG, "Failed to create humidity_sensor endpoint"));
-
-    // add CO2 sensor device
-    air_quality_sensor::config_t co2_sensor_config;
-    endpoint_t * co2_sensor_ep = air_quality_sensor::create(node, &co2_sensor_config, ENDPOINT_FLAG_NONE, NULL);
-    ABORT_APP_ON_FAILURE(co2_sensor_ep != nullptr, ESP_LOGE(TAG, "Failed to create CO2 sensor endpoint"));
-
-    // [ADD] Air Quality 엔드포인트에 CO2 농도 측정 클러스터(서버) 붙이기
-    cluster_t *co2_cluster = cluster::create(co2_sensor_ep,
-    CarbonDioxideConcentrationMeasurement::Id, CLUSTER_FLAG_SERVER);
-    ABORT_APP_ON_FAILURE(co2_cluster != nullptr, ESP_LOGE(TAG, "Failed to create CO2 cluster"));    
-
-{
-    using namespace chip::app::Clusters;
+    sensor_report_policy_t report_policy[SENSOR_ATTR_COUNT];
+    report_config_load(report_policy);
+    sensor_filter_config_t filter_config;
+    sensor_filter_config_default(&filter_config);
+
+    // Endpoints for every registry slot, also one whose bus failed: endpoint IDs
+    // follow the slot order and must not shift when a sensor is missing
+    for (size_t slot = 0; slot < registry.count; slot++) {
+        endpoint_t *sensor_eps[SENSOR_EP_COUNT];
+        err = create_sensor_endpoints(node, sensor_eps);
+        ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to create sensor %u endpoints", (unsigned)slot));
+        err = measured_attrs_bind(slot, sensor_eps);
+        ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to bind measured attributes"));
+        diag_attrs_create(slot, sensor_eps[SENSOR_EP_AIR_QUALITY]);
+#if CONFIG_SENSOR_CO2_ALARM
+        alarm_cluster_create(slot, sensor_eps[SENSOR_EP_AIR_QUALITY]);
+#endif
 
-    // 1) MeasuredValue (float = 0.0)
-    if (!attribute::get(co2_cluster,
-        Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasuredValue::Id)) {
-        esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-        v.type  = ESP_MATTER_VAL_TYPE_FLOAT;
-        v.val.f = 0.0f;
-        attribute::create(co2_cluster,
-            Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasuredValue::Id,
-            /*flags*/0, /*value*/ v);
+        sensor_pipeline_t *state = &s_sensor_state[slot];
+        sensor_commit_init(&state->commit, report_policy);
+        filter_config.interval_ms = sensor_slot_interval_ms(&registry.slots[slot]);
+        sensor_filter_init(&state->filter, &filter_config);
+        sensor_window_init(&state->co2_window, CONFIG_SENSOR_CO2_WINDOW_SEC, esp_timer_get_time());
+        state->write = write_measured_attribute;
+        state->write_ctx = s_measured_attrs[slot];
+#if CONFIG_SENSOR_CO2_ALARM
+        state->alarm = &s_alarms[slot];
+        state->alarm_cb = alarm_update;
+        state->alarm_ctx = (void *)(uintptr_t)slot;
+#endif
+#if CONFIG_SENSOR_HISTORY
+        state->history = true;
+#endif
+        state->slot = (uint8_t)slot;
     }
+#if CONFIG_SENSOR_PROBES
+    probe_attr_create(node);
+#endif
+    telemetry_attrs_create(node);
 
-    // 2) MeasurementUnit (uint8 = ppm)
-    if (!attribute::get(co2_cluster,
-        Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasurementUnit::Id)) {
-        esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-        v.type   = ESP_MATTER_VAL_TYPE_UINT8;
-        v.val.u8 = (uint8_t)Clusters::CarbonDioxideConcentrationMeasurement::MeasurementUnitEnum::kPpm;
-        attribute::create(co2_cluster,
-            Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MeasurementUnit::Id,
-            0, v);
+    static scd4x_sensor_config_t scd4x_configs[SCD4X_SENSOR_MAX];
+    size_t task_count = 0;
+    for (size_t slot = 0; slot < registry.count; slot++) {
+        if (devs[slot] == nullptr) {
+            continue;
+        }
+        scd4x_sensor_config_t *config = &scd4x_configs[task_count];
+        config->dev = devs[slot];
+        config->cb = sensor_notification;
+        config->health_cb = sensor_health_notification;
+        config->user_data = (void *)(uintptr_t)task_count;
+        config->slot = (uint8_t)slot;
+        config->i2c_port = registry.slots[slot].i2c_port;
+        config->mux_channel = registry.slots[slot].mux_channel;
+        config->interval_ms = sensor_slot_interval_ms(&registry.slots[slot]);
+        config->co2_interval_ms = CONFIG_SENSOR_LIT_CO2_INTERVAL_SEC * 1000;
+#if CONFIG_ENABLE_ICD_SERVER
+        config->icd_mode = SENSOR_ICD_SIT;
+#endif
+        s_task_slot[task_count++] = (uint8_t)slot;
     }
-
-    // 3) MinMeasuredValue (float = 0.0)
-    if (!attribute::get(co2_cluster,
-        Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MinMeasuredValue::Id)) {
-        esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-        v.type  = ESP_MATTER_VAL_TYPE_FLOAT;
-        v.val.f = 0.0f;
-        attribute::create(co2_cluster,
-            Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MinMeasuredValue::Id,
-            0, v);
+    s_task_count = task_count;
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+    uint32_t base_ms[SCD4X_SENSOR_MAX];
+    for (size_t i = 0; i < task_count; i++) {
+        base_ms[i] = scd4x_configs[i].interval_ms;
     }
-
-    // 4) MaxMeasuredValue (float = 40000.0)
-    if (!attribute::get(co2_cluster,
-        Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MaxMeasuredValue::Id)) {
-        esp_matter_attr_val_t v = esp_matter_invalid(NULL);
-        v.type  = ESP_MATTER_VAL_TYPE_FLOAT;
-        v.val.f = 40000.0f;
-        attribute::create(co2_cluster,
-            Clusters::CarbonDioxideConcentrationMeasurement::Attributes::MaxMeasuredValue::Id,
-            0, v);
+    sensor_demand_init(&s_demand, task_count, base_ms, CONFIG_SENSOR_MAINTENANCE_INTERVAL_SEC * 1000);
+#endif
+#if CONFIG_SENSOR_ADAPTIVE_SAMPLING
+    sensor_adapt_config_t adapt_config;
+    sensor_adapt_config_default(&adapt_config);
+    for (size_t i = 0; i < task_count; i++) {
+        adapt_config.min_ms = scd4x_configs[i].interval_ms;
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+        adapt_config.max_ms = CONFIG_SENSOR_MAINTENANCE_INTERVAL_SEC * 1000;
+#else
+        adapt_config.max_ms = CONFIG_SENSOR_ADAPTIVE_MAX_INTERVAL_SEC * 1000;
+#endif
+        sensor_adapt_init(&s_adapt[i], &adapt_config);
+        s_sensor_state[s_task_slot[i]].adapt = &s_adapt[i];
     }
-}
-
+#endif
 
-    static scd4x_sensor_config_t scd4x_config = {
-        .temperature = {
-            .cb = temp_sensor_notification,
-            .endpoint_id = endpoint::get_id(temp_sensor_ep),
-        },
-        .humidity = {
-            .cb = humidity_sensor_notification,
-            .endpoint_id = endpoint::get_id(humidity_sensor_ep),
-        },
-        .co2 = {
-            .cb = co2_sensor_notification,
-            .endpoint_id = endpoint::get_id(co2_sensor_ep),
-        },        
-    };    
+#if CONFIG_SENSOR_HISTORY
+    // before the sensor task starts, the drain adds to it from the first sample on
+    sensor_history_store_t history_store;
+    sensor_history_init(sensor_history_flash_store(&history_store) == ESP_OK ? &history_store : NULL);
+#endif
 
-    err = sensor_timer_init( &scd4x_config );
-    ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to initialize temperature sensor driver"));
+#if CONFIG_SENSOR_TIMER_JITTER_PROBE
+    timer_jitter_start(CONFIG_SENSOR_TIMER_JITTER_PROBE_PERIOD_MS);
+#endif
 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
     /* Set OpenThread platform config */
@@ -470,7 +1406,37 @@ extern "C" void app_main()
     set_openthread_platform_config(&config);
 #endif
 
+#if CONFIG_SENSOR_DELTA_OTA
+    err = ota_delta_requestor_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Delta OTA not available, err:%d", err);
+    }
+#endif
+
     /* Matter start */
     err = esp_matter::start(app_event_cb);
     ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to start Matter, err:%d", err));
+    boot_timeline_mark(BOOT_MARK_MATTER_START);
+
+    // The sensors come up on their own task while Matter advertises and attaches.
+    // Without a sensor the device still runs, its measured values stay null.
+    if (task_count) {
+        bool warm_start = is_warm_reset();
+        for (size_t i = 0; i < task_count; i++) {
+            scd4x_configs[i].warm_start = warm_start;
+        }
+        err = sensor_task_init(scd4x_configs, task_count);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start the sensor task, err:%d", err);
+        }
+#if CONFIG_SENSOR_DEMAND_SAMPLING
+        // init started every sensor at its configured interval, resumed subscriptions may already be known
+        chip::DeviceLayer::SystemLayer().ScheduleLambda([]() { demand_changed(); });
+#endif
+    }
+
+#if CONFIG_ENABLE_CHIP_SHELL
+    app_console_register();
+    esp_matter::console::init();
+#endif
 }
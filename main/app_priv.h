@@ -11,10 +11,17 @@
 #include <esp_err.h>
 #include <esp_matter.h>
 
+#include <scd41.h>
+#include <sensor_registry.h>
+
 typedef void *app_driver_handle_t;
 
 app_driver_handle_t app_driver_button_init();
 
+// Set up the I2C buses of the registry slots only. devs[i] is the sensor of slot i,
+// NULL if its bus could not be set up. Returns the number of sensors set up.
+size_t sensor_init(const sensor_registry_t *registry, scd41_t *devs[SCD4X_SENSOR_MAX]);
+
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include "esp_openthread_types.h"
 #endif
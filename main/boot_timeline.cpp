@@ -0,0 +1,67 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <boot_timeline.h>
+
+static const char *TAG = "boot";
+
+static const char *const s_mark_names[BOOT_MARK_COUNT] = {
+    [BOOT_MARK_APP_MAIN] = "app_main",
+    [BOOT_MARK_MATTER_START] = "matter started",
+    [BOOT_MARK_ADVERTISE] = "advertising",
+    [BOOT_MARK_SERVER_READY] = "server ready",
+    [BOOT_MARK_SENSOR_READY] = "sensor ready",
+    [BOOT_MARK_FIRST_SAMPLE] = "first sample",
+    [BOOT_MARK_FIRST_REPORT] = "first report",
+};
+
+// 0: not reached, esp_timer is already well above 0 when app_main runs
+static int64_t s_marks_us[BOOT_MARK_COUNT];
+
+bool boot_timeline_mark_at(boot_mark_t mark, int64_t time_us)
+{
+    if (s_marks_us[mark] != 0 || time_us <= 0) {
+        return false;
+    }
+    s_marks_us[mark] = time_us;
+    return true;
+}
+
+bool boot_timeline_mark(boot_mark_t mark)
+{
+    if (s_marks_us[mark] != 0) {
+        return false;
+    }
+    return boot_timeline_mark_at(mark, esp_timer_get_time());
+}
+
+int64_t boot_timeline_get(boot_mark_t mark)
+{
+    return s_marks_us[mark] ? s_marks_us[mark] : -1;
+}
+
+void boot_timeline_reset(void)
+{
+    for (int i = 0; i < BOOT_MARK_COUNT; i++) {
+        s_marks_us[i] = 0;
+    }
+}
+
+void boot_timeline_print(void)
+{
+    for (int i = 0; i < BOOT_MARK_COUNT; i++) {
+        if (s_marks_us[i]) {
+            ESP_LOGI(TAG, "%-15s %6lld ms", s_mark_names[i], (long long)(s_marks_us[i] / 1000));
+        } else {
+            ESP_LOGI(TAG, "%-15s      -", s_mark_names[i]);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Boot timeline.
+
+  esp_timer time of the first occurrence of each startup milestone, so
+  time-to-advertise and time-to-first-report can be read off every boot.
+  Printed once when the first report is queued, and on demand.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    BOOT_MARK_APP_MAIN,
+    // esp_matter::start() returned
+    BOOT_MARK_MATTER_START,
+    // BLE commissioning advertisement, commissioning window or DNS-SD up, whichever comes first
+    BOOT_MARK_ADVERTISE,
+    BOOT_MARK_SERVER_READY,
+    // sensor bring-up done
+    BOOT_MARK_SENSOR_READY,
+    BOOT_MARK_FIRST_SAMPLE,
+    // first measured attribute written and marked for reporting
+    BOOT_MARK_FIRST_REPORT,
+    BOOT_MARK_COUNT,
+} boot_mark_t;
+
+// Record now as the time of mark, returns false if it was already recorded
+bool boot_timeline_mark(boot_mark_t mark);
+bool boot_timeline_mark_at(boot_mark_t mark, int64_t time_us);
+
+// Time of mark in microseconds, -1 if not reached yet
+int64_t boot_timeline_get(boot_mark_t mark);
+
+void boot_timeline_reset(void);
+
+void boot_timeline_print(void);
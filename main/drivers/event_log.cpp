@@ -0,0 +1,158 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <event_log.h>
+#include <scd41_mode.h>
+#include <sensor_health.h>
+
+#if CONFIG_SENSOR_EVENT_LOG_ECHO
+static const char *TAG = "event_log";
+#endif
+
+static event_log_record_t s_records[CONFIG_SENSOR_EVENT_LOG_LEN];
+// records ever written, the next one goes to s_head % CONFIG_SENSOR_EVENT_LOG_LEN
+static std::atomic<uint32_t> s_head;
+
+static_assert(EVENT_LOG_ID_COUNT <= 32, "event ids must fit 5 bits");
+
+void event_log_write(event_log_id_t id, uint8_t sensor, uint16_t a, uint16_t b, uint16_t c)
+{
+    uint32_t seq = s_head.fetch_add(1, std::memory_order_relaxed);
+    event_log_record_t *record = &s_records[seq % CONFIG_SENSOR_EVENT_LOG_LEN];
+    record->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    record->id = id;
+    record->sensor = sensor & 0x07;
+    record->seq = (uint8_t)seq;
+    record->args[0] = a;
+    record->args[1] = b;
+    record->args[2] = c;
+
+#if CONFIG_SENSOR_EVENT_LOG_ECHO
+    char line[128];
+    event_log_format(record, line, sizeof(line));
+    ESP_LOGI(TAG, "%s", line);
+#endif
+}
+
+void event_log_foreach(void (*cb)(const event_log_record_t *record, void *ctx), void *ctx)
+{
+    uint32_t head = s_head.load(std::memory_order_relaxed);
+    uint32_t first = head > CONFIG_SENSOR_EVENT_LOG_LEN ? head - CONFIG_SENSOR_EVENT_LOG_LEN : 0;
+    for (uint32_t i = first; i < head; i++) {
+        // a writer may be overwriting the oldest records meanwhile, copy before use
+        event_log_record_t record = s_records[i % CONFIG_SENSOR_EVENT_LOG_LEN];
+        cb(&record, ctx);
+    }
+}
+
+void event_log_clear(void)
+{
+    s_head.store(0, std::memory_order_relaxed);
+}
+
+int event_log_format(const event_log_record_t *record, char *buf, size_t len)
+{
+    const uint16_t *args = record->args;
+    int n = snprintf(buf, len, "%lu.%03lu #%u sensor %u ", (unsigned long)(record->time_ms / 1000),
+                     (unsigned long)(record->time_ms % 1000), record->seq, record->sensor);
+    if (n < 0 || (size_t)n >= len) {
+        return n;
+    }
+    buf += n;
+    len -= n;
+
+    int m;
+    switch (record->id) {
+    case EVENT_LOG_SAMPLE: {
+        int temp = (int16_t)args[1];
+        m = snprintf(buf, len, "sample CO2: %u ppm, Temperature: %s%d.%02d °C, Humidity: %u.%02u %%", args[0],
+                     temp < 0 ? "-" : "", abs(temp) / 100, abs(temp) % 100, args[2] / 100, args[2] % 100);
+        break;
+    }
+    case EVENT_LOG_READ_ERROR:
+        m = snprintf(buf, len, "read error 0x%x in state %u", args[0], args[1]);
+        break;
+    case EVENT_LOG_MODE:
+        m = snprintf(buf, len, "mode %s, CO2 every %u samples, about %u mA·s/h",
+                     scd41_mode_name((scd41_mode_t)args[0]), args[1], args[2]);
+        break;
+    case EVENT_LOG_HEALTH:
+        m = snprintf(buf, len, "health %s, %u failures in a row, next try in %u s",
+                     sensor_health_name((sensor_health_state_t)args[0]), args[1], args[2]);
+        break;
+    case EVENT_LOG_BUS_CLOCK:
+        m = snprintf(buf, len, "bus clock %s to %u kHz from %u kHz, %u fallbacks so far",
+                     args[0] < args[1] ? "down" : "up", args[0], args[1], args[2]);
+        break;
+    default:
+        m = snprintf(buf, len, "event %u: %u %u %u", record->id, args[0], args[1], args[2]);
+        break;
+    }
+    return m < 0 ? m : n + m;
+}
+
+void event_log_encode(const event_log_record_t *record, uint8_t out[EVENT_LOG_RECORD_SIZE])
+{
+    out[0] = (uint8_t)record->time_ms;
+    out[1] = (uint8_t)(record->time_ms >> 8);
+    out[2] = (uint8_t)(record->time_ms >> 16);
+    out[3] = (uint8_t)(record->time_ms >> 24);
+    out[4] = (uint8_t)(record->id | record->sensor << 5);
+    out[5] = record->seq;
+    for (int i = 0; i < 3; i++) {
+        out[6 + 2 * i] = (uint8_t)record->args[i];
+        out[7 + 2 * i] = (uint8_t)(record->args[i] >> 8);
+    }
+}
+
+void event_log_decode(const uint8_t in[EVENT_LOG_RECORD_SIZE], event_log_record_t *record)
+{
+    record->time_ms = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+    record->id = (event_log_id_t)(in[4] & 0x1f);
+    record->sensor = in[4] >> 5;
+    record->seq = in[5];
+    for (int i = 0; i < 3; i++) {
+        record->args[i] = (uint16_t)(in[6 + 2 * i] | (in[7 + 2 * i] << 8));
+    }
+}
+
+static void print_record(const event_log_record_t *record, void *ctx)
+{
+    char line[128];
+    event_log_format(record, line, sizeof(line));
+    printf("%s\n", line);
+}
+
+static void print_record_hex(const event_log_record_t *record, void *ctx)
+{
+    uint8_t raw[EVENT_LOG_RECORD_SIZE];
+    event_log_encode(record, raw);
+    for (int i = 0; i < EVENT_LOG_RECORD_SIZE; i++) {
+        printf("%02x", raw[i]);
+    }
+    printf("\n");
+}
+
+void event_log_print(void)
+{
+    event_log_foreach(print_record, NULL);
+}
+
+void event_log_print_hex(void)
+{
+    event_log_foreach(print_record_hex, NULL);
+}
@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Binary event log.
+
+  The per-sample path stores fixed size records (timestamp, event id, raw
+  integer payload) in a RAM ring instead of formatting text for the UART,
+  which kept the core awake for milliseconds per sample. Text is only made
+  on demand: event_log_print() from the console, or the host decoder
+  (host/tools/event_log_decode.cpp) reading the event_log_print_hex() dump.
+
+  Writers may run on any task, the newest records overwrite the oldest.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+typedef enum : uint8_t {
+    // a: CO2 ppm, b: temperature 0.01 °C (int16), c: humidity 0.01 %
+    EVENT_LOG_SAMPLE,
+    // a: esp_err_t (low 16 bits), b: sensor state
+    EVENT_LOG_READ_ERROR,
+    // a: scd41_mode_t, b: CO2 every n samples, c: modelled sensor charge mA·s/h
+    EVENT_LOG_MODE,
+    // a: sensor_health_state_t, b: consecutive failures, c: seconds until the next attempt
+    EVENT_LOG_HEALTH,
+    // a: new bus clock kHz, b: previous kHz, c: fallbacks of the bus so far
+    EVENT_LOG_BUS_CLOCK,
+    EVENT_LOG_ID_COUNT,
+} event_log_id_t;
+
+typedef struct {
+    // esp_timer milliseconds, wraps after 49 days
+    uint32_t time_ms;
+    event_log_id_t id;
+    // registry slot of the sensor, 0-7
+    uint8_t sensor;
+    // write sequence, a gap between neighbours means overwritten records
+    uint8_t seq;
+    uint16_t args[3];
+} event_log_record_t;
+
+// wire size of a record: the fields above, little endian, no padding, except
+// that id and sensor share a byte (id in the low 5 bits)
+#define EVENT_LOG_RECORD_SIZE 12
+
+void event_log_write(event_log_id_t id, uint8_t sensor, uint16_t a, uint16_t b, uint16_t c);
+
+// Visit the records oldest first
+void event_log_foreach(void (*cb)(const event_log_record_t *record, void *ctx), void *ctx);
+
+void event_log_clear(void);
+
+// One line of text for a record, returns the length as snprintf does
+int event_log_format(const event_log_record_t *record, char *buf, size_t len);
+
+void event_log_encode(const event_log_record_t *record, uint8_t out[EVENT_LOG_RECORD_SIZE]);
+void event_log_decode(const uint8_t in[EVENT_LOG_RECORD_SIZE], event_log_record_t *record);
+
+// Console dumps to stdout: formatted, or one hex encoded record per line for the host decoder
+void event_log_print(void);
+void event_log_print_hex(void);
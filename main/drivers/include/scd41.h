@@ -0,0 +1,207 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sensirion SCD4x command layer.
+
+  Only speaks the Sensirion I2C framing (16 bit command, 16 bit words each
+  followed by a CRC-8) on top of scd41_bus_t, so the same code runs against
+  i2cdev on the target and against the simulated sensor in host/.
+
+  Every transaction is timed and its outcome counted in scd41_t::stats.
+  Sensors attached to a scd41_clock_t share the clock policy of their
+  bus: a port and everything on it, directly or behind a mux. Only a rate
+  that carried a transaction is ever lowered, when the sensors that
+  answer fail too often within a window; a run of failures counts once,
+  since a sensor that is busy recovering fails every transaction, a
+  marginal clock only some. While nothing on the bus ever answered, a
+  silent sensor gets one try at the lowest clock, for wiring too slow for
+  the start rate; if it stays silent there it is absent, and the bus goes
+  back. After enough clean transactions a lowered clock is tried one
+  step up again.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#define SCD41_I2C_ADDR                              0x62
+
+#define SCD41_CMD_START_PERIODIC_MEASUREMENT        0x21B1
+#define SCD41_CMD_READ_MEASUREMENT                  0xEC05
+#define SCD41_CMD_STOP_PERIODIC_MEASUREMENT         0x3F86
+#define SCD41_CMD_START_LOW_POWER_PERIODIC          0x21AC
+#define SCD41_CMD_GET_DATA_READY_STATUS             0xE4B8
+#define SCD41_CMD_GET_SERIAL_NUMBER                 0x3682
+#define SCD41_CMD_REINIT                            0x3646
+#define SCD41_CMD_MEASURE_SINGLE_SHOT               0x219D
+#define SCD41_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY      0x2196
+#define SCD41_CMD_POWER_DOWN                        0x36E0
+#define SCD41_CMD_WAKE_UP                           0x36F6
+
+// Command execution times from the SCD4x datasheet, in milliseconds
+#define SCD41_DELAY_READ_MEASUREMENT_MS             1
+#define SCD41_DELAY_STOP_PERIODIC_MS                500
+#define SCD41_DELAY_GET_DATA_READY_MS               1
+#define SCD41_DELAY_GET_SERIAL_NUMBER_MS            1
+#define SCD41_DELAY_REINIT_MS                       30
+#define SCD41_DELAY_MEASURE_SINGLE_SHOT_MS          5000
+#define SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS      50
+#define SCD41_DELAY_POWER_DOWN_MS                   1
+#define SCD41_DELAY_WAKE_UP_MS                      30
+
+typedef struct {
+    // Write len bytes as one I2C write transaction
+    esp_err_t (*write)(void *ctx, const uint8_t *data, size_t len);
+    // Read len bytes as one I2C read transaction
+    esp_err_t (*read)(void *ctx, uint8_t *data, size_t len);
+    // Wait for a command execution time
+    void (*delay_ms)(void *ctx, uint32_t ms);
+    // Optional: free a bus a slave holds SDA low on (SCL clock-out and STOP), NULL if not possible
+    esp_err_t (*recover)(void *ctx);
+    void *ctx;
+} scd41_bus_t;
+
+typedef struct {
+    // rate to start at, Hz
+    uint32_t clock_hz;
+    // fallbacks stop here
+    uint32_t min_clock_hz;
+    // transactions the error rate is taken over, 0: no fallback
+    uint16_t window;
+    // failed transactions per window, in %, that halve the clock
+    uint8_t error_pct;
+    // clean transactions at a lowered rate before the next one up is tried, 0: never
+    uint16_t raise_after;
+} scd41_clock_config_t;
+
+// Clock policy of one bus, shared by the sensors on it and driven from the one task stepping them
+typedef struct {
+    scd41_clock_config_t config;
+    // SCL rate of the whole bus in Hz from the next transaction on
+    esp_err_t (*set)(void *ctx, uint32_t hz);
+    void *ctx;
+    uint32_t hz;
+    // a transaction succeeded at the current rate
+    bool proven;
+    // sensors on the bus that ever answered
+    uint8_t present;
+    // the current rate is a try up from this one that has not lasted a window yet, 0 if not
+    uint32_t raised_from_hz;
+    // the lowest clock tried for a silent bus, back to this rate if nothing answers, 0 if not
+    uint32_t probe_from_hz;
+    // fallback window so far, failures counted once a success ended them
+    uint16_t window_count;
+    uint16_t window_errors;
+    // failed transactions in a row of present sensors, while the rate is unproven
+    uint16_t fail_streak;
+    // successes since the last counted failure or rate change
+    uint32_t clean;
+    // clean transactions the next try up waits for, doubled by every try that falls back
+    uint32_t raise_after;
+    uint32_t fallbacks;
+    uint32_t raises;
+} scd41_clock_t;
+
+// Written by the task driving the sensor only, readers may see a transaction half counted
+typedef struct {
+    // wake_up is left out, the sensor never acknowledges it
+    uint32_t transactions;
+    // not acknowledged: sensor absent, busy, or the bits garbled on the wire
+    uint32_t nacks;
+    uint32_t timeouts;
+    uint32_t crc_errors;
+    uint32_t other_errors;
+    // time spent inside transactions, bus lock included
+    int64_t busy_us;
+    uint32_t max_us;
+    // the bus's, filled in by scd41_get_bus_stats(): current rate (0 without a clock policy) and changes
+    uint32_t clock_hz;
+    uint32_t clock_fallbacks;
+    uint32_t clock_raises;
+} scd41_bus_stats_t;
+
+typedef struct {
+    scd41_bus_t bus;
+    scd41_bus_stats_t stats;
+    // NULL: the bus runs at a fixed rate
+    scd41_clock_t *clock;
+    // failed transactions in a row
+    uint16_t fail_streak;
+    // a transaction ever succeeded, until then the sensor counts as absent
+    bool present;
+    // had its try at the lowest clock
+    bool probed;
+} scd41_t;
+
+uint8_t scd41_crc8(const uint8_t *data, size_t len);
+
+// Single transactions for callers that wait out the execution time themselves
+esp_err_t scd41_send_command(scd41_t *dev, uint16_t cmd);
+esp_err_t scd41_read_words(scd41_t *dev, uint16_t *words, size_t count);
+
+// Bus recovery through scd41_bus_t::recover, ESP_ERR_NOT_SUPPORTED without one
+esp_err_t scd41_recover_bus(scd41_t *dev);
+
+// Kconfig defaults (CONFIG_SENSOR_I2C_*)
+void scd41_clock_config_default(scd41_clock_config_t *config);
+
+// Set the bus to config->clock_hz through set(ctx, hz), which has to change it for every sensor on the bus
+esp_err_t scd41_clock_init(scd41_clock_t *clock, const scd41_clock_config_t *config,
+                           esp_err_t (*set)(void *ctx, uint32_t hz), void *ctx);
+
+// Let the sensor's transactions drive the bus clock, NULL detaches
+void scd41_clock_attach(scd41_t *dev, scd41_clock_t *clock);
+
+// dev->stats with the clock fields of its bus
+void scd41_get_bus_stats(const scd41_t *dev, scd41_bus_stats_t *stats);
+
+// get_data_ready_status word: least significant 11 bits are 0 when no new measurement is available
+static inline bool scd41_data_ready(uint16_t status)
+{
+    return (status & 0x07ff) != 0;
+}
+
+void scd41_ticks_to_float(uint16_t t_raw, uint16_t rh_raw, float *temperature, float *humidity);
+
+/*
+  Integer conversions straight to the Matter units, rounded to nearest.
+  The targets have no FPU, so these replace the soft-float path on every
+  sample. T = -45 + 175 * t_raw / 2^16 °C, RH = 100 * rh_raw / 2^16 %.
+*/
+
+// 0.01 °C
+static inline int16_t scd41_ticks_to_centi_celsius(uint16_t t_raw)
+{
+    return (int16_t)((((uint32_t)t_raw * 17500 + 0x8000) >> 16) - 4500);
+}
+
+// 0.01 %
+static inline uint16_t scd41_ticks_to_centi_percent(uint16_t rh_raw)
+{
+    return (uint16_t)(((uint32_t)rh_raw * 10000 + 0x8000) >> 16);
+}
+
+esp_err_t scd41_wake_up(scd41_t *dev);
+esp_err_t scd41_power_down(scd41_t *dev);
+esp_err_t scd41_reinit(scd41_t *dev);
+esp_err_t scd41_get_serial_number(scd41_t *dev, uint16_t *serial0, uint16_t *serial1, uint16_t *serial2);
+
+esp_err_t scd41_start_periodic_measurement(scd41_t *dev);
+esp_err_t scd41_start_low_power_periodic_measurement(scd41_t *dev);
+esp_err_t scd41_stop_periodic_measurement(scd41_t *dev);
+esp_err_t scd41_measure_single_shot(scd41_t *dev);
+esp_err_t scd41_measure_single_shot_rht_only(scd41_t *dev);
+esp_err_t scd41_get_data_ready_status(scd41_t *dev, bool *data_ready);
+
+// Raw sensor words as transmitted, CRC already checked
+esp_err_t scd41_read_measurement_ticks(scd41_t *dev, uint16_t *co2, uint16_t *temperature, uint16_t *humidity);
+esp_err_t scd41_read_measurement(scd41_t *dev, uint16_t *co2, float *temperature, float *humidity);
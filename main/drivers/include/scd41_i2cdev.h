@@ -0,0 +1,54 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <i2cdev.h>
+
+#include <scd41.h>
+
+#define TCA9548A_I2C_ADDR_DEFAULT   0x70
+#define TCA9548A_CHANNELS           8
+
+// start, address, data, stop: room for a whole transaction, so no command link is allocated
+#define SCD41_I2C_CMD_LINK_SIZE     I2C_LINK_RECOMMENDED_SIZE(2)
+
+// TCA9548A I2C multiplexer, shared by the sensors behind it
+typedef struct {
+    i2c_dev_t i2c;
+    // channel currently switched through, -1 unknown
+    int8_t channel;
+    // the first transaction went through i2cdev, which set up the port
+    bool port_ready;
+    uint8_t cmd_link[SCD41_I2C_CMD_LINK_SIZE];
+} scd41_i2c_mux_t;
+
+// i2cdev binding of one sensor, must outlive the scd41_t
+typedef struct {
+    i2c_dev_t i2c;
+    // NULL when the sensor is wired to the bus directly
+    scd41_i2c_mux_t *mux;
+    uint8_t mux_channel;
+    bool port_ready;
+    uint8_t cmd_link[SCD41_I2C_CMD_LINK_SIZE];
+} scd41_i2cdev_t;
+
+// Bind an SCD41 to an i2cdev descriptor. i2cdev_init() must have been called.
+esp_err_t scd41_i2cdev_init(scd41_t *dev, scd41_i2cdev_t *binding, i2c_port_t port, gpio_num_t sda_gpio,
+                            gpio_num_t scl_gpio);
+
+esp_err_t scd41_i2c_mux_init(scd41_i2c_mux_t *mux, i2c_port_t port, uint8_t addr, gpio_num_t sda_gpio,
+                             gpio_num_t scl_gpio);
+
+// Same as scd41_i2cdev_init() for a sensor on a mux channel. Every transaction
+// holds the mux lock and switches the channel first if another one is selected.
+esp_err_t scd41_i2cdev_init_mux(scd41_t *dev, scd41_i2cdev_t *binding, scd41_i2c_mux_t *mux, uint8_t channel);
+
+// SCL rate from the next transaction on, for the binding and its mux. The clock is
+// the port's: a scd41_clock_t::set has to call this for every binding on the port.
+esp_err_t scd41_i2cdev_set_clock(scd41_i2cdev_t *binding, uint32_t hz);
@@ -0,0 +1,64 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  SCD41 measurement mode selection and power model.
+
+  Picks the measurement mode with the lowest modelled sensor charge that
+  still delivers a fresh sample every interval. Continuous modes only for
+  always-on devices; ICDs may also use single shots, and a LIT ICD takes
+  temperature/humidity-only shots between CO2 shots.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Typical SCD41 supply current at 3.3 V from the datasheet, in µA
+#define SCD41_CURRENT_PERIODIC_UA               15000
+#define SCD41_CURRENT_LOW_POWER_PERIODIC_UA     3200
+// idle between single shots
+#define SCD41_CURRENT_IDLE_UA                   150
+// one single shot above idle: datasheet average of 450 µA at one shot per 5 minutes
+#define SCD41_CHARGE_SINGLE_SHOT_UAS            90000
+// temperature/humidity only, no IR lamp: 50 ms at about 2 mA (estimate)
+#define SCD41_CHARGE_SINGLE_SHOT_RHT_UAS        100
+
+#define SCD41_PERIODIC_INTERVAL_MS              5000
+#define SCD41_LOW_POWER_PERIODIC_INTERVAL_MS    30000
+
+typedef enum : uint8_t {
+    // not measuring, also between single shots
+    SCD41_MODE_IDLE,
+    SCD41_MODE_PERIODIC,
+    SCD41_MODE_LOW_POWER_PERIODIC,
+    SCD41_MODE_SINGLE_SHOT,
+} scd41_mode_t;
+
+typedef enum : uint8_t {
+    // not an ICD, always on
+    SENSOR_ICD_NONE,
+    // short idle time ICD, also a LIT ICD without registered clients
+    SENSOR_ICD_SIT,
+    // long idle time ICD with registered clients
+    SENSOR_ICD_LIT,
+} sensor_icd_mode_t;
+
+typedef struct {
+    scd41_mode_t mode;
+    // single shot only: every co2_every-th sample is a full shot, the others are temperature/humidity only
+    uint16_t co2_every;
+} scd41_mode_plan_t;
+
+// interval_ms: sample interval, co2_interval_ms: how often a LIT ICD needs a new CO2 value (0: every sample)
+scd41_mode_plan_t scd41_mode_select(uint32_t interval_ms, uint32_t co2_interval_ms, sensor_icd_mode_t icd_mode);
+
+// Modelled sensor charge in mA·s per hour when sampling every interval_ms with plan
+uint32_t scd41_mode_charge_mas_per_hour(const scd41_mode_plan_t *plan, uint32_t interval_ms);
+
+const char *scd41_mode_name(scd41_mode_t mode);
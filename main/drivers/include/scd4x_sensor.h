@@ -0,0 +1,187 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <esp_err.h>
+
+#include <scd41.h>
+#include <scd41_mode.h>
+#include <sensor_health.h>
+
+// sensors one sensor task can drive
+#define SCD4X_SENSOR_MAX 4
+
+// One reading converted to the Matter representation of each attribute
+typedef struct {
+    // TemperatureMeasurement MeasuredValue, 0.01 °C
+    int16_t temperature;
+    // RelativeHumidityMeasurement MeasuredValue, 0.01 %
+    uint16_t humidity;
+    // CarbonDioxideConcentrationMeasurement MeasuredValue, ppm (a float attribute, converted when written)
+    uint16_t co2;
+    // AirQuality AirQuality, air_quality_t
+    uint8_t air_quality;
+    // CO2 PeakMeasuredValue / AverageMeasuredValue, ppm, filled on the matter thread
+    uint16_t co2_peak;
+    uint16_t co2_average;
+    // index of the sensor in the sensor_task_init() configs
+    uint8_t sensor;
+    // the last sample of the previous boot, published after a warm start. Only its values count:
+    // it was taken before this boot's clock started and must not feed filters, windows or history.
+    bool retained;
+} sensor_measurement_t;
+
+// Called from the sensor task after a measurement was queued, drain with sensor_measurement_pop()
+using scd4x_sensor_cb_t = void (*)(void *user_data);
+
+typedef struct {
+    // sensor the task reads from
+    scd41_t *dev = NULL;
+
+    // This callback function will be called whenever a new measurement is queued.
+    scd4x_sensor_cb_t cb = NULL;
+
+    // Optional, called from the sensor task after every failed sample and when the
+    // sensor recovers, read the state with sensor_task_get_health()
+    scd4x_sensor_cb_t health_cb = NULL;
+
+    // user data, passed to both callbacks
+    void *user_data = NULL;
+
+    // registry slot of the sensor (sensor_registry.h): the sensor in logs, the event log and RTC memory
+    uint8_t slot = 0;
+
+    // where the slot's sensor sits, as in sensor_slot_t: its retained state is only used
+    // for a sensor at the same port and multiplexer channel (0xff: none)
+    uint8_t i2c_port = 0;
+    uint8_t mux_channel = 0xff;
+
+    // time between reads in milliseconds, defaults to 10000 ms
+    uint32_t interval_ms = 10000;
+
+    // LIT ICD only: CO2 is measured this often, temperature/humidity-only shots in between (0: every sample)
+    uint32_t co2_interval_ms = 0;
+
+    // ICD mode at start (the first config's counts), later changes through sensor_task_set_icd_mode()
+    sensor_icd_mode_t icd_mode = SENSOR_ICD_NONE;
+
+    // The chip was reset without losing power (software reset, watchdog, OTA reboot):
+    // trust the RTC retained sensor mode and last sample of the slot. If the sensor is still
+    // measuring it is resumed without stop/reinit. The last sample is queued once the sensor
+    // is known to be the same one: still measuring, or answering with the retained serial number.
+    bool warm_start = false;
+} scd4x_sensor_config_t;
+
+typedef struct {
+    uint32_t samples;
+    // failed I2C transactions, CRC errors or a periodic measurement that stopped delivering
+    uint32_t read_errors;
+    // data ready polls that found no new measurement
+    uint32_t not_ready;
+    // measurements lost because the consumer fell behind
+    uint32_t dropped;
+    uint32_t mode_switches;
+    // bring-up attempts that failed and were retried
+    uint32_t bringup_failures;
+    // bus recoveries (SCL clock-out) that completed
+    uint32_t bus_recoveries;
+    // warm starts that resumed a running periodic measurement
+    uint32_t warm_resumes;
+    // samples brought forward by sensor_task_request_sample()
+    uint32_t requested;
+    // samples placed on the wake grid, see sensor_task_set_wake_grid()
+    uint32_t aligned;
+    // esp_timer time the bring-up completed, 0 before
+    int64_t ready_us;
+} scd4x_sensor_stats_t;
+
+// AirQualityEnum values of the Air Quality cluster
+typedef enum : uint8_t {
+    AIR_QUALITY_UNKNOWN = 0,
+    AIR_QUALITY_GOOD = 1,
+    AIR_QUALITY_FAIR = 2,
+    AIR_QUALITY_MODERATE = 3,
+    AIR_QUALITY_POOR = 4,
+    AIR_QUALITY_VERY_POOR = 5,
+    AIR_QUALITY_EXTREMELY_POOR = 6,
+} air_quality_t;
+
+// CO2(ppm) → AirQuality(enum) 간단 매핑
+air_quality_t map_co2_to_air_quality_enum(uint16_t ppm);
+
+// Raw sensor words to the Matter units, integer only
+void sensor_measurement_from_ticks(sensor_measurement_t *measurement, uint16_t co2, uint16_t t_raw, uint16_t rh_raw);
+
+// Bring the sensor to a known idle state, blocking for about 560 ms.
+// sensor_task_init() does the same without blocking, this is for the legacy sensor_get() loop.
+esp_err_t sensor_start(scd41_t *dev);
+
+esp_err_t sensor_get(scd41_t *dev, float *temp, float *humidity, uint16_t *co2);
+
+/*
+  Sampling runs as one state machine per sensor, all stepped by one low
+  priority task instead of the shared esp_timer task. Each first brings its
+  sensor up (retried while the sensor does not answer), then in periodic
+  modes polls get_data_ready_status and reads only when a fresh measurement
+  exists, in single shot mode triggers one shot per sample, then queues it
+  for the Matter thread. Every I2C command execution time is a task sleep
+  between two steps, so nothing else waits for the sensor, and the waits of
+  several sensors overlap. Failures are retried with the escalation and
+  backoff of sensor_health.h.
+*/
+
+// Start sampling count sensors, each at its own interval, configs must stay valid while running.
+// Sensor i tags its measurements with i and is addressed as i by the getters below.
+esp_err_t sensor_task_init(scd4x_sensor_config_t *configs, size_t count);
+
+esp_err_t sensor_task_deinit(void);
+
+// Step every sensor that is due, returns the milliseconds to sleep until the next one is
+uint32_t sensor_task_step(void);
+
+size_t sensor_task_count(void);
+
+// Consumer side of the measurement queue, call from a single thread
+bool sensor_measurement_pop(sensor_measurement_t *measurement);
+
+void sensor_task_get_stats(size_t sensor, scd4x_sensor_stats_t *stats);
+
+void sensor_task_get_health(size_t sensor, sensor_health_t *health);
+
+// Transaction counters and timing of the sensor, clock of its bus (scd41.h)
+void sensor_task_get_bus_stats(size_t sensor, scd41_bus_stats_t *stats);
+
+// The measurement mode is re-selected (scd41_mode_select) before every sample, for all sensors
+void sensor_task_set_icd_mode(sensor_icd_mode_t icd_mode);
+
+// Sample every interval_ms from now on instead of the configured interval (0: back to it).
+// A shorter interval takes effect right away, counted from the last sample. Any thread.
+void sensor_task_set_interval(size_t sensor, uint32_t interval_ms);
+
+// Sample as soon as possible if the sensor is waiting for its next sample,
+// the interval then counts from this one. Any thread.
+void sensor_task_request_sample(size_t sensor);
+
+// Wakes the chip has anyway, e.g. the data polls of a sleepy Thread device: every
+// period_ms, one of them at anchor_us (esp_timer time). A sample moves by up to slip_pct %
+// of its interval (single shots either way, periodic reads only later) so that its read and
+// the commit land just before one, period_ms 0 turns this off. Applies to all sensors from
+// their next sample. Any thread.
+void sensor_task_set_wake_grid(uint32_t period_ms, int64_t anchor_us, uint8_t slip_pct);
+
+// Mode the sensor is currently in
+void sensor_task_get_plan(size_t sensor, scd41_mode_plan_t *plan);
+
+// Platform part: run sensor_task_step() in a loop (scd4x_sensor_task.cpp on target),
+// sensor_task_wake() cuts the current sleep short
+esp_err_t sensor_task_create(void);
+void sensor_task_delete(void);
+void sensor_task_wake(void);
@@ -0,0 +1,63 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sensor health.
+
+  Counts consecutive failed sampling cycles and decides what the sensor
+  task does next:
+
+  - the first SENSOR_HEALTH_RECOVER_AFTER - 1 failures are retried at the
+    normal interval, most are a single disturbed transaction
+  - from then on every retry first recovers the I2C bus (SCL clock-out)
+    and runs the full bring-up (wake_up, stop, reinit), and the wait
+    doubles each time up to CONFIG_SENSOR_HEALTH_MAX_BACKOFF_SEC, so a dead
+    sensor no longer wakes the device every interval
+  - after SENSOR_HEALTH_FAILED_AFTER failures the sensor counts as failed,
+    which is reported over Matter, until the next good sample
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SENSOR_HEALTH_RECOVER_AFTER     3
+#define SENSOR_HEALTH_FAILED_AFTER      5
+
+typedef enum : uint8_t {
+    SENSOR_HEALTH_OK,
+    // failing, still being retried
+    SENSOR_HEALTH_DEGRADED,
+    SENSOR_HEALTH_FAILED,
+} sensor_health_state_t;
+
+typedef enum {
+    SENSOR_RECOVERY_RETRY,
+    // recover the bus, then bring the sensor up again
+    SENSOR_RECOVERY_RESET,
+} sensor_recovery_t;
+
+typedef struct {
+    sensor_health_state_t state;
+    uint32_t consecutive_failures;
+    // totals since start
+    uint32_t failures;
+    uint32_t resets;
+    // times the sensor came back after failing
+    uint32_t recoveries;
+} sensor_health_t;
+
+void sensor_health_init(sensor_health_t *health);
+
+// A sampling cycle failed. Returns what to do and sets *wait_ms to the time before trying again.
+sensor_recovery_t sensor_health_failure(sensor_health_t *health, uint32_t interval_ms, uint32_t *wait_ms);
+
+// A good sample arrived, returns true if the sensor was failing before
+bool sensor_health_success(sensor_health_t *health);
+
+const char *sensor_health_name(sensor_health_state_t state);
@@ -0,0 +1,105 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Hot path instrumentation (CONFIG_SENSOR_PROBES).
+
+  Cycle counter probes around each stage of a sample feed fixed log2
+  histograms, next to a few event counters. Every histogram and counter
+  has a single writer (the sensor task or the matter thread), readers
+  take a snapshot that may mix two samples, which is fine for
+  diagnostics. With the option off the macros expand to nothing and no
+  state exists, so production builds pay nothing.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+typedef enum {
+    // one sensor_task_step() call
+    SENSOR_PROBE_STEP,
+    // read of the measurement words: I2C read plus CRC check
+    SENSOR_PROBE_I2C,
+    // ScheduleLambda enqueue until the drain runs on the matter thread
+    SENSOR_PROBE_HOP,
+    // one measured attribute write into the data model
+    SENSOR_PROBE_WRITE,
+    SENSOR_PROBE_COUNT,
+} sensor_probe_t;
+
+typedef enum {
+    SENSOR_COUNTER_SAMPLES,
+    SENSOR_COUNTER_READ_ERRORS,
+    // attributes written because their value changed
+    SENSOR_COUNTER_UPDATES,
+    // attributes of a sample the commit did not write
+    SENSOR_COUNTER_SUPPRESSED,
+    // paths marked dirty for reporting, updates plus heartbeats. Not reports sent: without a
+    // subscriber nothing is sent, and marks within a subscription's min interval merge into one report
+    SENSOR_COUNTER_DIRTY_MARKS,
+    SENSOR_COUNTER_COUNT,
+} sensor_counter_t;
+
+// bucket i holds durations of [2^i, 2^(i+1)) cycles, bucket 0 also 0, the last one everything longer
+#define SENSOR_PROBE_BUCKETS 24
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+    uint32_t buckets[SENSOR_PROBE_BUCKETS];
+} sensor_probe_hist_t;
+
+typedef struct {
+    sensor_probe_hist_t hist[SENSOR_PROBE_COUNT];
+    uint32_t counters[SENSOR_COUNTER_COUNT];
+} sensor_probe_snapshot_t;
+
+// sensor_probe_encode() output: version byte, counters as u32 in sensor_counter_t order, then per
+// probe count and max as u32 and the buckets as u16 (saturated), all little endian
+#define SENSOR_PROBE_ENCODING_VERSION 1
+#define SENSOR_PROBE_ENCODED_LEN \
+    (1 + 4 * SENSOR_COUNTER_COUNT + SENSOR_PROBE_COUNT * (4 + 4 + 2 * SENSOR_PROBE_BUCKETS))
+
+#if CONFIG_SENSOR_PROBES
+
+#include <esp_cpu.h>
+
+static inline uint32_t sensor_probe_cycles(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+void sensor_probe_record(sensor_probe_t probe, uint32_t cycles);
+void sensor_probe_add(sensor_counter_t counter, uint32_t n);
+
+void sensor_probe_snapshot(sensor_probe_snapshot_t *snapshot);
+void sensor_probe_reset(void);
+
+// Print the histograms and counters to stdout (console command)
+void sensor_probe_print(void);
+
+// Compact binary form for the diagnostic attribute, returns the length or 0 if len is too short
+size_t sensor_probe_encode(uint8_t *buf, size_t len);
+
+#define SENSOR_PROBE_BEGIN(name)            uint32_t name = sensor_probe_cycles()
+#define SENSOR_PROBE_END(probe, name)       sensor_probe_record((probe), sensor_probe_cycles() - (name))
+#define SENSOR_PROBE_COUNT(counter, n)      sensor_probe_add((counter), (n))
+
+#else
+
+#define SENSOR_PROBE_BEGIN(name)
+#define SENSOR_PROBE_END(probe, name)
+// unevaluated, only keeps variables computed for n from looking unused
+#define SENSOR_PROBE_COUNT(counter, n)      ((void)sizeof(n))
+
+#endif
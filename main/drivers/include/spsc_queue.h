@@ -0,0 +1,66 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Lock-free single-producer/single-consumer ring.
+
+  push() may only be called from one thread and pop() from one other
+  thread. Each index is written by exactly one side, so acquire/release
+  ordering on the indices is all the synchronisation needed.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+template <typename T, size_t N>
+class spsc_queue {
+    static_assert(N && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // Producer side. Returns false and drops item when the queue is full.
+    bool push(const T &item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        m_items[head & (N - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the queue is empty.
+    bool pop(T *item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *item = m_items[tail & (N - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only meaningful when neither side is running
+    void reset()
+    {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    T m_items[N];
+    // next slot to write, owned by the producer
+    std::atomic<uint32_t> m_head{0};
+    // next slot to read, owned by the consumer
+    std::atomic<uint32_t> m_tail{0};
+};
@@ -0,0 +1,443 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <scd41.h>
+
+static const char *TAG = "scd41";
+
+#define SCD41_MAX_WORDS 3
+
+// CRC-8, polynomial 0x31 (x^8 + x^5 + x^4 + 1), one table step per byte
+static const uint8_t s_crc8_table[256] = {
+    0x00, 0x31, 0x62, 0x53, 0xc4, 0xf5, 0xa6, 0x97, 0xb9, 0x88, 0xdb, 0xea, 0x7d, 0x4c, 0x1f, 0x2e,
+    0x43, 0x72, 0x21, 0x10, 0x87, 0xb6, 0xe5, 0xd4, 0xfa, 0xcb, 0x98, 0xa9, 0x3e, 0x0f, 0x5c, 0x6d,
+    0x86, 0xb7, 0xe4, 0xd5, 0x42, 0x73, 0x20, 0x11, 0x3f, 0x0e, 0x5d, 0x6c, 0xfb, 0xca, 0x99, 0xa8,
+    0xc5, 0xf4, 0xa7, 0x96, 0x01, 0x30, 0x63, 0x52, 0x7c, 0x4d, 0x1e, 0x2f, 0xb8, 0x89, 0xda, 0xeb,
+    0x3d, 0x0c, 0x5f, 0x6e, 0xf9, 0xc8, 0x9b, 0xaa, 0x84, 0xb5, 0xe6, 0xd7, 0x40, 0x71, 0x22, 0x13,
+    0x7e, 0x4f, 0x1c, 0x2d, 0xba, 0x8b, 0xd8, 0xe9, 0xc7, 0xf6, 0xa5, 0x94, 0x03, 0x32, 0x61, 0x50,
+    0xbb, 0x8a, 0xd9, 0xe8, 0x7f, 0x4e, 0x1d, 0x2c, 0x02, 0x33, 0x60, 0x51, 0xc6, 0xf7, 0xa4, 0x95,
+    0xf8, 0xc9, 0x9a, 0xab, 0x3c, 0x0d, 0x5e, 0x6f, 0x41, 0x70, 0x23, 0x12, 0x85, 0xb4, 0xe7, 0xd6,
+    0x7a, 0x4b, 0x18, 0x29, 0xbe, 0x8f, 0xdc, 0xed, 0xc3, 0xf2, 0xa1, 0x90, 0x07, 0x36, 0x65, 0x54,
+    0x39, 0x08, 0x5b, 0x6a, 0xfd, 0xcc, 0x9f, 0xae, 0x80, 0xb1, 0xe2, 0xd3, 0x44, 0x75, 0x26, 0x17,
+    0xfc, 0xcd, 0x9e, 0xaf, 0x38, 0x09, 0x5a, 0x6b, 0x45, 0x74, 0x27, 0x16, 0x81, 0xb0, 0xe3, 0xd2,
+    0xbf, 0x8e, 0xdd, 0xec, 0x7b, 0x4a, 0x19, 0x28, 0x06, 0x37, 0x64, 0x55, 0xc2, 0xf3, 0xa0, 0x91,
+    0x47, 0x76, 0x25, 0x14, 0x83, 0xb2, 0xe1, 0xd0, 0xfe, 0xcf, 0x9c, 0xad, 0x3a, 0x0b, 0x58, 0x69,
+    0x04, 0x35, 0x66, 0x57, 0xc0, 0xf1, 0xa2, 0x93, 0xbd, 0x8c, 0xdf, 0xee, 0x79, 0x48, 0x1b, 0x2a,
+    0xc1, 0xf0, 0xa3, 0x92, 0x05, 0x34, 0x67, 0x56, 0x78, 0x49, 0x1a, 0x2b, 0xbc, 0x8d, 0xde, 0xef,
+    0x82, 0xb3, 0xe0, 0xd1, 0x46, 0x77, 0x24, 0x15, 0x3b, 0x0a, 0x59, 0x68, 0xff, 0xce, 0x9d, 0xac,
+};
+
+uint8_t scd41_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0xff;
+    for (size_t i = 0; i < len; i++) {
+        crc = s_crc8_table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+// Failures in a row before a rate without proof is given up: a try up, or the lowest clock for a silent bus
+#define SCD41_CLOCK_UNPROVEN_FAILURES 3
+// raise_after grows up to this multiple of the configured one
+#define SCD41_CLOCK_RAISE_BACKOFF_MAX 64
+
+static bool clock_apply(scd41_clock_t *clock, uint32_t hz)
+{
+    if (hz == clock->hz || clock->set(clock->ctx, hz) != ESP_OK) {
+        return false;
+    }
+    clock->hz = hz;
+    clock->proven = false;
+    clock->raised_from_hz = 0;
+    clock->probe_from_hz = 0;
+    clock->window_count = 0;
+    clock->window_errors = 0;
+    clock->fail_streak = 0;
+    clock->clean = 0;
+    return true;
+}
+
+// A try up that fails waits longer for the next one
+static void raise_backoff(scd41_clock_t *clock)
+{
+    uint32_t raise_max = (uint32_t)clock->config.raise_after * SCD41_CLOCK_RAISE_BACKOFF_MAX;
+    clock->raise_after = clock->raise_after * 2 < raise_max ? clock->raise_after * 2 : raise_max;
+}
+
+// A proven rate fails too often: back to where a try up came from, or half
+static void lower_clock(scd41_clock_t *clock, uint32_t errors)
+{
+    uint32_t from = clock->hz;
+    uint32_t hz = clock->raised_from_hz ? clock->raised_from_hz : from / 2;
+    hz = hz < clock->config.min_clock_hz ? clock->config.min_clock_hz : hz;
+    if (hz >= from) {
+        return;
+    }
+    if (clock->raised_from_hz) {
+        raise_backoff(clock);
+    }
+    if (!clock_apply(clock, hz)) {
+        return;
+    }
+    clock->fallbacks++;
+    ESP_LOGW(TAG, "%lu failed transactions at %lu kHz, bus clock down to %lu kHz", (unsigned long)errors,
+             (unsigned long)(from / 1000), (unsigned long)(hz / 1000));
+}
+
+static void raise_clock(scd41_clock_t *clock)
+{
+    uint32_t from = clock->hz;
+    uint32_t hz = from * 2 > clock->config.clock_hz ? clock->config.clock_hz : from * 2;
+    if (hz <= from || !clock_apply(clock, hz)) {
+        return;
+    }
+    clock->raised_from_hz = from;
+    clock->raises++;
+    ESP_LOGI(TAG, "%lu clean transactions at %lu kHz, bus clock up to %lu kHz", (unsigned long)clock->raise_after,
+             (unsigned long)(from / 1000), (unsigned long)(hz / 1000));
+}
+
+// A try up that never carried a transaction: the rate it came from is still the proven one
+static void revert_raise(scd41_clock_t *clock)
+{
+    uint32_t from = clock->hz, hz = clock->raised_from_hz;
+    raise_backoff(clock);
+    if (clock_apply(clock, hz)) {
+        ESP_LOGW(TAG, "Nothing got through at %lu kHz, bus clock back to %lu kHz", (unsigned long)(from / 1000),
+                 (unsigned long)(hz / 1000));
+    }
+}
+
+/*
+  Nothing on the bus ever answered. That is a missing sensor or wiring
+  too slow for the rate, so the silent sensor gets one try at the lowest
+  clock; if it does not answer there either it is absent, and the bus
+  goes back to the rate it had.
+*/
+static void probe_silent(scd41_t *dev, scd41_clock_t *clock)
+{
+    if (clock->probe_from_hz) {
+        uint32_t hz = clock->probe_from_hz;
+        if (clock_apply(clock, hz)) {
+            ESP_LOGW(TAG, "No answer at %lu kHz either, sensor absent, bus clock back to %lu kHz",
+                     (unsigned long)(clock->config.min_clock_hz / 1000), (unsigned long)(hz / 1000));
+        }
+        return;
+    }
+    if (dev->probed || clock->hz <= clock->config.min_clock_hz) {
+        return;
+    }
+    uint32_t from = clock->hz;
+    dev->probed = true;
+    dev->fail_streak = 0;
+    if (clock_apply(clock, clock->config.min_clock_hz)) {
+        clock->probe_from_hz = from;
+        ESP_LOGW(TAG, "No answer at %lu kHz, trying %lu kHz", (unsigned long)(from / 1000),
+                 (unsigned long)(clock->hz / 1000));
+    }
+}
+
+static void clock_check(scd41_t *dev, bool ok)
+{
+    scd41_clock_t *clock = dev->clock;
+    if (clock == NULL) {
+        return;
+    }
+    bool streak_ended = ok && dev->fail_streak != 0;
+    if (ok) {
+        dev->fail_streak = 0;
+        if (!dev->present) {
+            dev->present = true;
+            clock->present++;
+        }
+    } else if (dev->fail_streak < UINT16_MAX) {
+        dev->fail_streak++;
+    }
+    if (!dev->present) {
+        // a sensor that never answered says nothing about a clock others got through at
+        if (clock->present == 0 && dev->fail_streak >= SCD41_CLOCK_UNPROVEN_FAILURES) {
+            probe_silent(dev, clock);
+        }
+        return;
+    }
+
+    if (!ok) {
+        if (!clock->proven && clock->raised_from_hz && ++clock->fail_streak >= SCD41_CLOCK_UNPROVEN_FAILURES) {
+            revert_raise(clock);
+            return;
+        }
+    } else {
+        if (clock->probe_from_hz) {
+            // the lowest clock made the sensor answer: the fallback is for real
+            clock->probe_from_hz = 0;
+            clock->fallbacks++;
+            ESP_LOGW(TAG, "Sensor answers at %lu kHz, bus clock stays there", (unsigned long)(clock->hz / 1000));
+        }
+        clock->proven = true;
+        clock->fail_streak = 0;
+        clock->window_errors += streak_ended;
+        clock->clean = streak_ended ? 0 : clock->clean + 1;
+    }
+    if (clock->config.window == 0) {
+        return;
+    }
+
+    // the error rate of the window so far, taken over half a window at least: after failures the
+    // sensor health backoff spreads the transactions out, a full window could then take hours
+    uint32_t half = clock->config.window / 2;
+    uint32_t seen = ++clock->window_count > half ? clock->window_count : half;
+    if (clock->proven && clock->window_errors * 100 >= (uint32_t)clock->config.error_pct * seen) {
+        lower_clock(clock, clock->window_errors);
+        return;
+    }
+    if (clock->window_count >= clock->config.window) {
+        clock->window_count = 0;
+        clock->window_errors = 0;
+        if (clock->raised_from_hz && clock->proven) {
+            // the try up held a window: it is the rate now
+            clock->raised_from_hz = 0;
+            clock->raise_after = clock->config.raise_after;
+        }
+    }
+    if (clock->config.raise_after && clock->hz < clock->config.clock_hz && clock->clean >= clock->raise_after) {
+        raise_clock(clock);
+    }
+}
+
+static void account(scd41_t *dev, esp_err_t err, int64_t start_us)
+{
+    scd41_bus_stats_t *stats = &dev->stats;
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    stats->transactions++;
+    stats->busy_us += us;
+    if (us > stats->max_us) {
+        stats->max_us = us;
+    }
+    switch (err) {
+    case ESP_OK:                break;
+    case ESP_FAIL:              stats->nacks++; break;
+    case ESP_ERR_TIMEOUT:       stats->timeouts++; break;
+    case ESP_ERR_INVALID_CRC:   stats->crc_errors++; break;
+    default:                    stats->other_errors++; break;
+    }
+    clock_check(dev, err == ESP_OK);
+}
+
+esp_err_t scd41_send_command(scd41_t *dev, uint16_t cmd)
+{
+    uint8_t buf[2] = { (uint8_t)(cmd >> 8), (uint8_t)cmd };
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = dev->bus.write(dev->bus.ctx, buf, sizeof(buf));
+    if (cmd != SCD41_CMD_WAKE_UP) {
+        account(dev, err, start_us);
+    }
+    return err;
+}
+
+esp_err_t scd41_read_words(scd41_t *dev, uint16_t *words, size_t count)
+{
+    if (count > SCD41_MAX_WORDS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t buf[SCD41_MAX_WORDS * 3];
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = dev->bus.read(dev->bus.ctx, buf, count * 3);
+    for (size_t i = 0; err == ESP_OK && i < count; i++) {
+        const uint8_t *p = buf + i * 3;
+        uint8_t crc = scd41_crc8(p, 2);
+        if (crc != p[2]) {
+            ESP_LOGE(TAG, "Invalid CRC 0x%02x, expected 0x%02x", p[2], crc);
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        }
+        words[i] = (uint16_t)((p[0] << 8) | p[1]);
+    }
+    account(dev, err, start_us);
+    return err;
+}
+
+esp_err_t scd41_recover_bus(scd41_t *dev)
+{
+    if (dev->bus.recover == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return dev->bus.recover(dev->bus.ctx);
+}
+
+void scd41_clock_config_default(scd41_clock_config_t *config)
+{
+    config->clock_hz = CONFIG_SENSOR_I2C_CLOCK_HZ;
+    config->min_clock_hz = CONFIG_SENSOR_I2C_MIN_CLOCK_HZ;
+    config->window = CONFIG_SENSOR_I2C_FALLBACK_WINDOW;
+    config->error_pct = CONFIG_SENSOR_I2C_FALLBACK_ERROR_PCT;
+    config->raise_after = CONFIG_SENSOR_I2C_RAISE_AFTER;
+}
+
+esp_err_t scd41_clock_init(scd41_clock_t *clock, const scd41_clock_config_t *config,
+                           esp_err_t (*set)(void *ctx, uint32_t hz), void *ctx)
+{
+    if (clock == NULL || config == NULL || set == NULL || config->clock_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = set(ctx, config->clock_hz);
+    if (err != ESP_OK) {
+        return err;
+    }
+    memset(clock, 0, sizeof(*clock));
+    clock->config = *config;
+    clock->set = set;
+    clock->ctx = ctx;
+    clock->hz = config->clock_hz;
+    clock->raise_after = config->raise_after;
+    return ESP_OK;
+}
+
+void scd41_clock_attach(scd41_t *dev, scd41_clock_t *clock)
+{
+    dev->clock = clock;
+    dev->fail_streak = 0;
+    dev->present = false;
+    dev->probed = false;
+}
+
+void scd41_get_bus_stats(const scd41_t *dev, scd41_bus_stats_t *stats)
+{
+    *stats = dev->stats;
+    if (dev->clock) {
+        stats->clock_hz = dev->clock->hz;
+        stats->clock_fallbacks = dev->clock->fallbacks;
+        stats->clock_raises = dev->clock->raises;
+    }
+}
+
+// Send a command, wait for its execution time and optionally read the response
+static esp_err_t execute_cmd(scd41_t *dev, uint16_t cmd, uint32_t delay_ms, uint16_t *words, size_t count)
+{
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = scd41_send_command(dev, cmd);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (delay_ms) {
+        dev->bus.delay_ms(dev->bus.ctx, delay_ms);
+    }
+    if (words && count) {
+        return scd41_read_words(dev, words, count);
+    }
+    return ESP_OK;
+}
+
+void scd41_ticks_to_float(uint16_t t_raw, uint16_t rh_raw, float *temperature, float *humidity)
+{
+    *temperature = (float)t_raw * 175.0f / 65536.0f - 45.0f;
+    *humidity = (float)rh_raw * 100.0f / 65536.0f;
+}
+
+esp_err_t scd41_wake_up(scd41_t *dev)
+{
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The sensor does not acknowledge wake_up, so the write result is meaningless
+    scd41_send_command(dev, SCD41_CMD_WAKE_UP);
+    dev->bus.delay_ms(dev->bus.ctx, SCD41_DELAY_WAKE_UP_MS);
+    return ESP_OK;
+}
+
+esp_err_t scd41_power_down(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_POWER_DOWN, SCD41_DELAY_POWER_DOWN_MS, NULL, 0);
+}
+
+esp_err_t scd41_reinit(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_REINIT, SCD41_DELAY_REINIT_MS, NULL, 0);
+}
+
+esp_err_t scd41_get_serial_number(scd41_t *dev, uint16_t *serial0, uint16_t *serial1, uint16_t *serial2)
+{
+    uint16_t words[3];
+    esp_err_t err = execute_cmd(dev, SCD41_CMD_GET_SERIAL_NUMBER, SCD41_DELAY_GET_SERIAL_NUMBER_MS, words, 3);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *serial0 = words[0];
+    *serial1 = words[1];
+    *serial2 = words[2];
+    return ESP_OK;
+}
+
+esp_err_t scd41_start_periodic_measurement(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_START_PERIODIC_MEASUREMENT, 0, NULL, 0);
+}
+
+esp_err_t scd41_start_low_power_periodic_measurement(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_START_LOW_POWER_PERIODIC, 0, NULL, 0);
+}
+
+esp_err_t scd41_stop_periodic_measurement(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_STOP_PERIODIC_MEASUREMENT, SCD41_DELAY_STOP_PERIODIC_MS, NULL, 0);
+}
+
+esp_err_t scd41_measure_single_shot(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_MEASURE_SINGLE_SHOT, SCD41_DELAY_MEASURE_SINGLE_SHOT_MS, NULL, 0);
+}
+
+esp_err_t scd41_measure_single_shot_rht_only(scd41_t *dev)
+{
+    return execute_cmd(dev, SCD41_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY, SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS, NULL, 0);
+}
+
+esp_err_t scd41_get_data_ready_status(scd41_t *dev, bool *data_ready)
+{
+    uint16_t status;
+    esp_err_t err = execute_cmd(dev, SCD41_CMD_GET_DATA_READY_STATUS, SCD41_DELAY_GET_DATA_READY_MS, &status, 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *data_ready = scd41_data_ready(status);
+    return ESP_OK;
+}
+
+esp_err_t scd41_read_measurement_ticks(scd41_t *dev, uint16_t *co2, uint16_t *temperature, uint16_t *humidity)
+{
+    uint16_t words[3];
+    esp_err_t err = execute_cmd(dev, SCD41_CMD_READ_MEASUREMENT, SCD41_DELAY_READ_MEASUREMENT_MS, words, 3);
+    if (err != ESP_OK) {
+        return err;
+    }
+    *co2 = words[0];
+    *temperature = words[1];
+    *humidity = words[2];
+    return ESP_OK;
+}
+
+esp_err_t scd41_read_measurement(scd41_t *dev, uint16_t *co2, float *temperature, float *humidity)
+{
+    uint16_t t_raw, rh_raw;
+    esp_err_t err = scd41_read_measurement_ticks(dev, co2, &t_raw, &rh_raw);
+    if (err != ESP_OK) {
+        return err;
+    }
+    scd41_ticks_to_float(t_raw, rh_raw, temperature, humidity);
+    return ESP_OK;
+}
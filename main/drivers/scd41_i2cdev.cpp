@@ -0,0 +1,258 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_rom_sys.h>
+
+#include <scd41_i2cdev.h>
+
+#define SCD41_I2C_FREQ_HZ 100000
+
+/*
+  i2c_dev_read() and i2c_dev_write() build every transaction in a freshly
+  allocated command link. After the first transaction, which lets i2cdev
+  install and configure the port, the transfers run on the legacy driver
+  directly, with the command link in a static buffer of the binding: the
+  sample path then touches no heap. Callers hold the bus mutex.
+*/
+static esp_err_t transfer(i2c_dev_t *i2c, bool *port_ready, uint8_t *cmd_link, bool read, uint8_t *data,
+                          size_t len)
+{
+    if (!*port_ready) {
+        esp_err_t err = read ? i2c_dev_read(i2c, NULL, 0, data, len) : i2c_dev_write(i2c, NULL, 0, data, len);
+        // until one succeeds i2cdev keeps retrying the port setup as well
+        *port_ready = err == ESP_OK;
+        return err;
+    }
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(cmd_link, SCD41_I2C_CMD_LINK_SIZE);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (uint8_t)(i2c->addr << 1 | (read ? I2C_MASTER_READ : I2C_MASTER_WRITE)), true);
+    if (read) {
+        i2c_master_read(cmd, data, len, I2C_MASTER_LAST_NACK);
+    } else {
+        i2c_master_write(cmd, data, len, true);
+    }
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(i2c->port, cmd, pdMS_TO_TICKS(CONFIG_I2CDEV_TIMEOUT));
+    i2c_cmd_link_delete_static(cmd);
+    return err;
+}
+
+// Lock the bus the sensor is reached through: the mux when there is one, so
+// that no other sensor switches the channel in the middle of a transaction
+static esp_err_t bus_lock(scd41_i2cdev_t *binding)
+{
+    if (binding->mux == NULL) {
+        return i2c_dev_take_mutex(&binding->i2c);
+    }
+    scd41_i2c_mux_t *mux = binding->mux;
+    esp_err_t err = i2c_dev_take_mutex(&mux->i2c);
+    if (err != ESP_OK || mux->channel == binding->mux_channel) {
+        return err;
+    }
+    uint8_t mask = (uint8_t)(1 << binding->mux_channel);
+    err = transfer(&mux->i2c, &mux->port_ready, mux->cmd_link, false, &mask, 1);
+    if (err != ESP_OK) {
+        mux->channel = -1;
+        i2c_dev_give_mutex(&mux->i2c);
+        return err;
+    }
+    mux->channel = (int8_t)binding->mux_channel;
+    return ESP_OK;
+}
+
+static void bus_unlock(scd41_i2cdev_t *binding)
+{
+    i2c_dev_give_mutex(binding->mux ? &binding->mux->i2c : &binding->i2c);
+}
+
+static esp_err_t i2cdev_bus_write(void *ctx, const uint8_t *data, size_t len)
+{
+    scd41_i2cdev_t *binding = (scd41_i2cdev_t *) ctx;
+    esp_err_t err = bus_lock(binding);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = transfer(&binding->i2c, &binding->port_ready, binding->cmd_link, false, (uint8_t *)data, len);
+    bus_unlock(binding);
+    return err;
+}
+
+static esp_err_t i2cdev_bus_read(void *ctx, uint8_t *data, size_t len)
+{
+    scd41_i2cdev_t *binding = (scd41_i2cdev_t *) ctx;
+    esp_err_t err = bus_lock(binding);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = transfer(&binding->i2c, &binding->port_ready, binding->cmd_link, true, data, len);
+    bus_unlock(binding);
+    return err;
+}
+
+// The bus is free while the command executes, sleep rather than spin; a delay may end up to a tick early
+static void i2cdev_bus_delay_ms(void *ctx, uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms) + 1);
+}
+
+/*
+  i2cdev sets the port up again when a descriptor's config differs from
+  the port's, so the next transaction goes through i2cdev instead of the
+  static command link. Behind a mux that is the channel select.
+*/
+esp_err_t scd41_i2cdev_set_clock(scd41_i2cdev_t *binding, uint32_t hz)
+{
+    if (binding == NULL || hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    i2c_dev_t *i2c = binding->mux ? &binding->mux->i2c : &binding->i2c;
+    esp_err_t err = i2c_dev_take_mutex(i2c);
+    if (err != ESP_OK) {
+        return err;
+    }
+    binding->i2c.cfg.master.clk_speed = hz;
+    if (binding->mux) {
+        binding->mux->i2c.cfg.master.clk_speed = hz;
+        binding->mux->port_ready = false;
+        binding->mux->channel = -1;
+    } else {
+        binding->port_ready = false;
+    }
+    i2c_dev_give_mutex(i2c);
+    return ESP_OK;
+}
+
+// half an SCL period at 100 kHz
+#define BUS_RECOVERY_HALF_PERIOD_US 5
+
+/*
+  A slave reset or a glitch in the middle of a read can leave the sensor
+  driving SDA low while it waits for clocks that never come, and every
+  transaction fails from then on. Clock SCL by hand until the slave lets go
+  (at most 9 pulses finish any byte plus ACK), send a STOP, then hand the
+  pins back to the I2C controller.
+*/
+static esp_err_t i2cdev_bus_recover(void *ctx)
+{
+    scd41_i2cdev_t *binding = (scd41_i2cdev_t *) ctx;
+    i2c_dev_t *i2c = binding->mux ? &binding->mux->i2c : &binding->i2c;
+    esp_err_t err = i2c_dev_take_mutex(i2c);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    gpio_num_t sda = (gpio_num_t)i2c->cfg.sda_io_num;
+    gpio_num_t scl = (gpio_num_t)i2c->cfg.scl_io_num;
+    gpio_set_level(sda, 1);
+    gpio_set_level(scl, 1);
+    gpio_set_direction(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+
+    for (int i = 0; i < 9 && gpio_get_level(sda) == 0; i++) {
+        gpio_set_level(scl, 0);
+        esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+        gpio_set_level(scl, 1);
+        esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+    }
+
+    // STOP: SDA rises while SCL is high
+    gpio_set_level(scl, 0);
+    esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(sda, 0);
+    esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+    gpio_set_level(sda, 1);
+    esp_rom_delay_us(BUS_RECOVERY_HALF_PERIOD_US);
+    bool released = gpio_get_level(sda) != 0;
+
+    err = i2c_set_pin(i2c->port, sda, scl, i2c->cfg.sda_pullup_en, i2c->cfg.scl_pullup_en, I2C_MODE_MASTER);
+    if (binding->mux) {
+        // a stuck slave behind the mux may have garbled the selection too
+        binding->mux->channel = -1;
+    }
+    i2c_dev_give_mutex(i2c);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return released ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+static void bind(scd41_t *dev, scd41_i2cdev_t *binding)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->bus.write = i2cdev_bus_write;
+    dev->bus.read = i2cdev_bus_read;
+    dev->bus.delay_ms = i2cdev_bus_delay_ms;
+    dev->bus.recover = i2cdev_bus_recover;
+    dev->bus.ctx = binding;
+}
+
+esp_err_t scd41_i2cdev_init(scd41_t *dev, scd41_i2cdev_t *binding, i2c_port_t port, gpio_num_t sda_gpio,
+                            gpio_num_t scl_gpio)
+{
+    if (dev == NULL || binding == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_dev_t *i2c = &binding->i2c;
+    i2c->port = port;
+    i2c->addr = SCD41_I2C_ADDR;
+    i2c->cfg.sda_io_num = sda_gpio;
+    i2c->cfg.scl_io_num = scl_gpio;
+    i2c->cfg.master.clk_speed = SCD41_I2C_FREQ_HZ;
+    binding->mux = NULL;
+    binding->port_ready = false;
+    esp_err_t err = i2c_dev_create_mutex(i2c);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    bind(dev, binding);
+    return ESP_OK;
+}
+
+esp_err_t scd41_i2c_mux_init(scd41_i2c_mux_t *mux, i2c_port_t port, uint8_t addr, gpio_num_t sda_gpio,
+                             gpio_num_t scl_gpio)
+{
+    if (mux == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mux->i2c.port = port;
+    mux->i2c.addr = addr;
+    mux->i2c.cfg.sda_io_num = sda_gpio;
+    mux->i2c.cfg.scl_io_num = scl_gpio;
+    mux->i2c.cfg.master.clk_speed = SCD41_I2C_FREQ_HZ;
+    mux->channel = -1;
+    mux->port_ready = false;
+    return i2c_dev_create_mutex(&mux->i2c);
+}
+
+esp_err_t scd41_i2cdev_init_mux(scd41_t *dev, scd41_i2cdev_t *binding, scd41_i2c_mux_t *mux, uint8_t channel)
+{
+    if (dev == NULL || binding == NULL || mux == NULL || channel >= TCA9548A_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // same bus as the mux, the mux lock serialises the sensors behind it
+    binding->i2c = mux->i2c;
+    binding->i2c.addr = SCD41_I2C_ADDR;
+    binding->mux = mux;
+    binding->mux_channel = channel;
+    // the mux's first transaction sets the port up for both
+    binding->port_ready = true;
+    bind(dev, binding);
+    return ESP_OK;
+}
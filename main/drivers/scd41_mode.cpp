@@ -0,0 +1,77 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <scd41.h>
+#include <scd41_mode.h>
+
+uint32_t scd41_mode_charge_mas_per_hour(const scd41_mode_plan_t *plan, uint32_t interval_ms)
+{
+    uint64_t uas;
+    switch (plan->mode) {
+    case SCD41_MODE_PERIODIC:
+        uas = (uint64_t)SCD41_CURRENT_PERIODIC_UA * 3600;
+        break;
+    case SCD41_MODE_LOW_POWER_PERIODIC:
+        uas = (uint64_t)SCD41_CURRENT_LOW_POWER_PERIODIC_UA * 3600;
+        break;
+    case SCD41_MODE_SINGLE_SHOT: {
+        uint32_t co2_every = plan->co2_every ? plan->co2_every : 1;
+        // charge of co2_every samples, spread over co2_every intervals
+        uint64_t group_uas = SCD41_CHARGE_SINGLE_SHOT_UAS + (uint64_t)(co2_every - 1) * SCD41_CHARGE_SINGLE_SHOT_RHT_UAS;
+        uas = (uint64_t)SCD41_CURRENT_IDLE_UA * 3600 +
+              group_uas * 3600000 / ((uint64_t)(interval_ms ? interval_ms : 1) * co2_every);
+        break;
+    }
+    default:
+        uas = (uint64_t)SCD41_CURRENT_IDLE_UA * 3600;
+        break;
+    }
+    return (uint32_t)(uas / 1000);
+}
+
+scd41_mode_plan_t scd41_mode_select(uint32_t interval_ms, uint32_t co2_interval_ms, sensor_icd_mode_t icd_mode)
+{
+    // periodic delivers any interval
+    scd41_mode_plan_t best = { SCD41_MODE_PERIODIC, 1 };
+    uint32_t best_charge = scd41_mode_charge_mas_per_hour(&best, interval_ms);
+
+    scd41_mode_plan_t candidates[2];
+    size_t count = 0;
+    if (interval_ms >= SCD41_LOW_POWER_PERIODIC_INTERVAL_MS) {
+        candidates[count++] = { SCD41_MODE_LOW_POWER_PERIODIC, 1 };
+    }
+    // an always-on device keeps measuring continuously, single shots are for the battery budget
+    if (icd_mode != SENSOR_ICD_NONE && interval_ms >= SCD41_DELAY_MEASURE_SINGLE_SHOT_MS) {
+        uint16_t co2_every = 1;
+        if (icd_mode == SENSOR_ICD_LIT && co2_interval_ms > interval_ms) {
+            uint32_t n = co2_interval_ms / interval_ms;
+            co2_every = n > UINT16_MAX ? UINT16_MAX : (uint16_t)n;
+        }
+        candidates[count++] = { SCD41_MODE_SINGLE_SHOT, co2_every };
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t charge = scd41_mode_charge_mas_per_hour(&candidates[i], interval_ms);
+        if (charge < best_charge) {
+            best = candidates[i];
+            best_charge = charge;
+        }
+    }
+    return best;
+}
+
+const char *scd41_mode_name(scd41_mode_t mode)
+{
+    switch (mode) {
+    case SCD41_MODE_IDLE:               return "idle";
+    case SCD41_MODE_PERIODIC:           return "periodic";
+    case SCD41_MODE_LOW_POWER_PERIODIC: return "low power periodic";
+    case SCD41_MODE_SINGLE_SHOT:        return "single shot";
+    default:                            return "unknown";
+    }
+}
@@ -0,0 +1,816 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <atomic>
+
+#include <esp_attr.h>
+#include <esp_check.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <event_log.h>
+#include <scd4x_sensor.h>
+#include <sensor_health.h>
+#include <sensor_probe.h>
+#include <spsc_queue.h>
+
+static const char *TAG = "scd4x";
+
+air_quality_t map_co2_to_air_quality_enum(uint16_t ppm)
+{
+    if (ppm < 600)   return AIR_QUALITY_GOOD;
+    if (ppm < 1000)  return AIR_QUALITY_FAIR;
+    if (ppm < 1500)  return AIR_QUALITY_MODERATE;
+    if (ppm < 2000)  return AIR_QUALITY_POOR;
+    if (ppm < 5000)  return AIR_QUALITY_VERY_POOR;
+    return AIR_QUALITY_EXTREMELY_POOR;
+}
+
+void sensor_measurement_from_ticks(sensor_measurement_t *measurement, uint16_t co2, uint16_t t_raw, uint16_t rh_raw)
+{
+    measurement->temperature = scd41_ticks_to_centi_celsius(t_raw);
+    measurement->humidity = scd41_ticks_to_centi_percent(rh_raw);
+    measurement->co2 = co2;
+    measurement->air_quality = map_co2_to_air_quality_enum(co2);
+}
+
+esp_err_t sensor_start(scd41_t *dev)
+{
+    ESP_LOGI(TAG, "Initializing sensor...");
+    ESP_RETURN_ON_ERROR(scd41_wake_up(dev), TAG, "wake_up failed");
+    ESP_RETURN_ON_ERROR(scd41_stop_periodic_measurement(dev), TAG, "stop_periodic_measurement failed");
+    ESP_RETURN_ON_ERROR(scd41_reinit(dev), TAG, "reinit failed");
+    ESP_LOGI(TAG, "Sensor initialized");
+
+    uint16_t serial[3];
+    ESP_RETURN_ON_ERROR(scd41_get_serial_number(dev, serial, serial + 1, serial + 2), TAG, "get_serial_number failed");
+    ESP_LOGI(TAG, "Sensor serial number: 0x%04x%04x%04x", serial[0], serial[1], serial[2]);
+    return ESP_OK;
+}
+
+esp_err_t sensor_get(scd41_t *dev, float *temp, float *humidity, uint16_t *co2)
+{
+    uint16_t t_raw, rh_raw;
+    SENSOR_PROBE_BEGIN(i2c_start);
+    esp_err_t res = scd41_read_measurement_ticks(dev, co2, &t_raw, &rh_raw);
+    SENSOR_PROBE_END(SENSOR_PROBE_I2C, i2c_start);
+    if (res != ESP_OK) {
+        event_log_write(EVENT_LOG_READ_ERROR, 0, (uint16_t)res, 0, 0);
+        ESP_LOGE(TAG, "Error reading results %d (%s)", res, esp_err_to_name(res));
+        return res;
+    }
+
+    scd41_ticks_to_float(t_raw, rh_raw, temp, humidity);
+    event_log_write(EVENT_LOG_SAMPLE, 0, *co2, (uint16_t)scd41_ticks_to_centi_celsius(t_raw),
+                    scd41_ticks_to_centi_percent(rh_raw));
+    return ESP_OK;
+}
+
+// poll again this soon when the sensor had no new data yet
+#define SENSOR_POLL_RETRY_MS    250
+// a periodic measurement that has no new data this many sensor periods after it was due has stalled
+#define SENSOR_DATA_TIMEOUT_PERIODS 3
+// shared by all sensors, 4 each
+#define SENSOR_QUEUE_LEN        16
+// a read moved onto the wake grid lands this long before the grid point, the hop and commit finish before the poll
+#define SENSOR_GRID_LEAD_MS     10
+
+static_assert(SENSOR_QUEUE_LEN >= 4 * SCD4X_SENSOR_MAX, "queue too short for every sensor");
+
+typedef enum {
+    // warm start: get_serial_number is refused while the sensor measures periodically
+    SENSOR_STATE_WARM_PROBE,
+    // bring-up after sensor_task_init(), one command per step: wake_up,
+    // stop_periodic_measurement, reinit, get_serial_number and its response
+    SENSOR_STATE_BOOT_WAKE,
+    SENSOR_STATE_BOOT_STOP,
+    SENSOR_STATE_BOOT_REINIT,
+    SENSOR_STATE_BOOT_SERIAL,
+    SENSOR_STATE_BOOT_SERIAL_SENT,
+    // next step checks the measurement mode, then polls or starts a single shot
+    SENSOR_STATE_IDLE,
+    // get_data_ready_status sent, response pending
+    SENSOR_STATE_READY_SENT,
+    // single shot running
+    SENSOR_STATE_SHOT_SENT,
+    // read_measurement sent, response pending
+    SENSOR_STATE_READ_SENT,
+} sensor_state_t;
+
+typedef struct {
+    scd4x_sensor_config_t *config;
+    // position in sensor_task_init() configs, tags its measurements
+    uint8_t index;
+    // config->slot, the sensor in logs and the event log
+    uint8_t slot;
+    sensor_state_t state;
+    // esp_timer time of the next step
+    int64_t due_us;
+    // mode the sensor is in
+    scd41_mode_plan_t plan;
+    // single shots since the mode started, and the length of the last one
+    uint32_t shot_count;
+    uint32_t shot_ms;
+    // held over temperature/humidity-only shots
+    uint16_t last_co2;
+    scd4x_sensor_stats_t stats;
+    sensor_health_t health;
+    // periodic modes: esp_timer time by which new data must have shown up
+    int64_t data_due_us;
+    // resumed a periodic measurement after a warm start, no sample read since
+    bool warm_resume;
+    // warm start: the retained last sample goes out once the sensor is known to be the same one
+    bool retained_pending;
+    // esp_timer time the next sample was scheduled from, see reschedule()
+    int64_t sample_us;
+    // written by other threads: interval override (0: config->interval_ms),
+    // and set when the override or a sample request needs a look before due_us
+    std::atomic<uint32_t> demand_ms;
+    std::atomic<bool> sample_requested;
+    std::atomic<bool> interval_changed;
+} scd4x_sensor_ctx_t;
+
+static scd4x_sensor_ctx_t s_sensors[SCD4X_SENSOR_MAX];
+static size_t s_count;
+static bool s_initialized;
+// one producer: every sensor is stepped on the sensor task
+static spsc_queue<sensor_measurement_t, SENSOR_QUEUE_LEN> s_queue;
+// written by the matter thread, applies to all sensors
+static std::atomic<sensor_icd_mode_t> s_icd_mode;
+// wake grid of sensor_task_set_wake_grid(), also written by the matter thread; a step that
+// sees half of an update misplaces one sample, the next one lands right again
+static std::atomic<uint32_t> s_grid_period_ms;
+static std::atomic<uint32_t> s_grid_phase_ms;
+static std::atomic<uint8_t> s_grid_slip_pct;
+
+#define SENSOR_RETAINED_MAGIC 0x5cd41a7f
+
+// Survives software resets, watchdog resets and OTA reboots, garbage after power on.
+// One entry per registry slot, task indices move when a slot fails or the registry changes.
+typedef struct {
+    uint32_t magic;
+    struct {
+        // the sensor the entry belongs to, an entry that does not match it is not used
+        uint8_t i2c_port;
+        uint8_t mux_channel;
+        uint16_t serial[3];
+        // mode the sensor was left in
+        scd41_mode_plan_t plan;
+        bool has_sample;
+        sensor_measurement_t last;
+    } sensors[SCD4X_SENSOR_MAX];
+    uint32_t checksum;
+} sensor_retained_t;
+
+static RTC_NOINIT_ATTR sensor_retained_t s_retained;
+
+// FNV-1a over everything before the checksum
+static uint32_t retained_checksum(const sensor_retained_t *retained)
+{
+    const uint8_t *p = (const uint8_t *)retained;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(sensor_retained_t, checksum); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool retained_valid(void)
+{
+    return s_retained.magic == SENSOR_RETAINED_MAGIC && s_retained.checksum == retained_checksum(&s_retained);
+}
+
+// The entry of the slot was written for the sensor at the same port and mux channel
+static bool retained_matches(const scd4x_sensor_config_t *config)
+{
+    return s_retained.sensors[config->slot].i2c_port == config->i2c_port &&
+           s_retained.sensors[config->slot].mux_channel == config->mux_channel;
+}
+
+// Give the slot's entry to the sensor with this serial number, dropping what it held for another one
+static void retain_serial(const scd4x_sensor_ctx_t *ctx, const uint16_t serial[3])
+{
+    if (!retained_valid()) {
+        memset(&s_retained, 0, sizeof(s_retained));
+        s_retained.magic = SENSOR_RETAINED_MAGIC;
+    }
+    if (!retained_matches(ctx->config) || memcmp(s_retained.sensors[ctx->slot].serial, serial, 3 * sizeof(uint16_t)) != 0) {
+        memset(&s_retained.sensors[ctx->slot], 0, sizeof(s_retained.sensors[ctx->slot]));
+        s_retained.sensors[ctx->slot].i2c_port = ctx->config->i2c_port;
+        s_retained.sensors[ctx->slot].mux_channel = ctx->config->mux_channel;
+        memcpy(s_retained.sensors[ctx->slot].serial, serial, 3 * sizeof(uint16_t));
+    }
+    s_retained.checksum = retained_checksum(&s_retained);
+}
+
+static void retain(const scd4x_sensor_ctx_t *ctx, const scd41_mode_plan_t *plan,
+                   const sensor_measurement_t *measurement)
+{
+    // the bring-up gave the entry to this sensor, see retain_serial()
+    if (!retained_valid() || !retained_matches(ctx->config)) {
+        return;
+    }
+    if (plan) {
+        s_retained.sensors[ctx->slot].plan = *plan;
+    }
+    if (measurement) {
+        s_retained.sensors[ctx->slot].last = *measurement;
+        s_retained.sensors[ctx->slot].has_sample = true;
+    }
+    s_retained.checksum = retained_checksum(&s_retained);
+}
+
+// Queue the previous boot's last sample, under this boot's task index
+static void publish_retained(scd4x_sensor_ctx_t *ctx)
+{
+    if (!ctx->retained_pending) {
+        return;
+    }
+    ctx->retained_pending = false;
+    sensor_measurement_t last = s_retained.sensors[ctx->slot].last;
+    last.sensor = ctx->index;
+    last.retained = true;
+    if (s_queue.push(last)) {
+        ctx->config->cb(ctx->config->user_data);
+    }
+}
+
+static void notify_health(scd4x_sensor_ctx_t *ctx)
+{
+    if (ctx->config->health_cb) {
+        ctx->config->health_cb(ctx->config->user_data);
+    }
+}
+
+static uint32_t interval_ms(const scd4x_sensor_ctx_t *ctx)
+{
+    uint32_t demand_ms = ctx->demand_ms.load(std::memory_order_relaxed);
+    return demand_ms ? demand_ms : ctx->config->interval_ms;
+}
+
+static bool is_periodic(scd41_mode_t mode)
+{
+    return mode == SCD41_MODE_PERIODIC || mode == SCD41_MODE_LOW_POWER_PERIODIC;
+}
+
+/*
+  Shift for a sample due at due_us so that its read lands SENSOR_GRID_LEAD_MS
+  before a wake on the grid: a read up to that much late for one is pulled
+  back, otherwise it waits for the next one if that is within the slip. 0
+  without a grid or when the next wake is too far. A single shot is read
+  one shot length after it starts, periodic data right after the data
+  ready poll.
+*/
+static int64_t grid_shift_us(scd4x_sensor_ctx_t *ctx, int64_t due_us)
+{
+    int64_t period_us = (int64_t)s_grid_period_ms.load(std::memory_order_relaxed) * 1000;
+    if (period_us == 0) {
+        return 0;
+    }
+    uint32_t read_ms = SCD41_DELAY_READ_MEASUREMENT_MS;
+    if (ctx->plan.mode == SCD41_MODE_SINGLE_SHOT) {
+        read_ms += ctx->shot_count % ctx->plan.co2_every == 0 ? SCD41_DELAY_MEASURE_SINGLE_SHOT_MS
+                                                              : SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS;
+    } else {
+        read_ms += SCD41_DELAY_GET_DATA_READY_MS;
+    }
+    // how far the read plus the lead is past the last wake
+    int64_t lead_us = (int64_t)SENSOR_GRID_LEAD_MS * 1000;
+    int64_t past_us = (due_us + (int64_t)read_ms * 1000 + lead_us
+                       - (int64_t)s_grid_phase_ms.load(std::memory_order_relaxed) * 1000) % period_us;
+    if (past_us < 0) {
+        past_us += period_us;
+    }
+    int64_t max_slip_us = (int64_t)interval_ms(ctx) * 10 * s_grid_slip_pct.load(std::memory_order_relaxed);
+    int64_t shift_us = period_us - past_us;
+    if (past_us <= lead_us) {
+        shift_us = -past_us;
+    } else if (ctx->plan.mode == SCD41_MODE_SINGLE_SHOT && past_us < shift_us && past_us <= max_slip_us) {
+        // a shot can start early just as well, the nearer wake keeps the average interval
+        shift_us = -past_us;
+    } else if (shift_us > max_slip_us) {
+        return 0;
+    }
+    ctx->stats.aligned++;
+    return shift_us;
+}
+
+// wait_ms until the next sample from now, shifted onto the wake grid
+static uint32_t next_sample_ms(scd4x_sensor_ctx_t *ctx, uint32_t wait_ms)
+{
+    int64_t wait_us = (int64_t)wait_ms * 1000;
+    wait_us += grid_shift_us(ctx, esp_timer_get_time() + wait_us);
+    return wait_us > 0 ? (uint32_t)((wait_us + 999) / 1000) : 0;
+}
+
+// The periodic measurement must deliver within after_ms plus a few sensor periods
+static void expect_data(scd4x_sensor_ctx_t *ctx, uint32_t after_ms)
+{
+    uint32_t period_ms = ctx->plan.mode == SCD41_MODE_LOW_POWER_PERIODIC ? SCD41_LOW_POWER_PERIODIC_INTERVAL_MS
+                                                                         : SCD41_PERIODIC_INTERVAL_MS;
+    ctx->data_due_us = esp_timer_get_time() + ((int64_t)after_ms + SENSOR_DATA_TIMEOUT_PERIODS * period_ms) * 1000;
+}
+
+static void queue_measurement(scd4x_sensor_ctx_t *ctx, uint16_t co2, const uint16_t words[3])
+{
+    sensor_measurement_t measurement = {};
+    sensor_measurement_from_ticks(&measurement, co2, words[1], words[2]);
+    measurement.sensor = ctx->index;
+    event_log_write(EVENT_LOG_SAMPLE, ctx->slot, co2, (uint16_t)measurement.temperature, measurement.humidity);
+    retain(ctx, NULL, &measurement);
+    ctx->warm_resume = false;
+    ctx->stats.samples++;
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_SAMPLES, 1);
+    if (sensor_health_success(&ctx->health)) {
+        event_log_write(EVENT_LOG_HEALTH, ctx->slot, SENSOR_HEALTH_OK, 0, 0);
+        ESP_LOGI(TAG, "Sensor %u recovered", ctx->slot);
+        notify_health(ctx);
+    }
+    if (!s_queue.push(measurement)) {
+        ctx->stats.dropped++;
+        return;
+    }
+    ctx->config->cb(ctx->config->user_data);
+}
+
+/*
+  Move the sensor towards plan. Leaving a periodic mode takes a
+  stop_periodic_measurement first, which blocks the sensor for 500 ms, so
+  a switch can span two steps. Returns true with *wait_ms set while the
+  switch is still in progress.
+*/
+static bool switch_mode(scd4x_sensor_ctx_t *ctx, const scd41_mode_plan_t *plan, uint32_t *wait_ms, esp_err_t *err)
+{
+    scd41_t *dev = ctx->config->dev;
+    if (is_periodic(ctx->plan.mode)) {
+        *err = scd41_send_command(dev, SCD41_CMD_STOP_PERIODIC_MEASUREMENT);
+        if (*err != ESP_OK) {
+            return true;
+        }
+        ctx->plan.mode = SCD41_MODE_IDLE;
+        retain(ctx, &ctx->plan, NULL);
+        *wait_ms = SCD41_DELAY_STOP_PERIODIC_MS;
+        return true;
+    }
+
+    switch (plan->mode) {
+    case SCD41_MODE_PERIODIC:
+        *err = scd41_send_command(dev, SCD41_CMD_START_PERIODIC_MEASUREMENT);
+        *wait_ms = SCD41_PERIODIC_INTERVAL_MS;
+        break;
+    case SCD41_MODE_LOW_POWER_PERIODIC:
+        *err = scd41_send_command(dev, SCD41_CMD_START_LOW_POWER_PERIODIC);
+        *wait_ms = SCD41_LOW_POWER_PERIODIC_INTERVAL_MS;
+        break;
+    default:
+        // single shots are started per sample
+        *err = ESP_OK;
+        *wait_ms = 0;
+        break;
+    }
+    if (*err != ESP_OK) {
+        return true;
+    }
+
+    ctx->plan = *plan;
+    retain(ctx, &ctx->plan, NULL);
+    if (*wait_ms != 0) {
+        expect_data(ctx, *wait_ms);
+    }
+    ctx->shot_count = 0;
+    ctx->stats.mode_switches++;
+    uint32_t charge = scd41_mode_charge_mas_per_hour(plan, interval_ms(ctx));
+    event_log_write(EVENT_LOG_MODE, ctx->slot, plan->mode, plan->co2_every, (uint16_t)(charge < UINT16_MAX ? charge : UINT16_MAX));
+    ESP_LOGI(TAG, "Sensor %u measurement mode: %s, CO2 every %u samples, about %lu mA·s/h", ctx->slot,
+             scd41_mode_name(plan->mode), plan->co2_every, (unsigned long)charge);
+    // a fresh periodic measurement is not there before one sensor period
+    return *wait_ms != 0;
+}
+
+static uint32_t step(scd4x_sensor_ctx_t *ctx)
+{
+    scd41_t *dev = ctx->config->dev;
+    esp_err_t err = ESP_OK;
+    switch (ctx->state) {
+    case SENSOR_STATE_WARM_PROBE:
+        if (scd41_send_command(dev, SCD41_CMD_GET_SERIAL_NUMBER) == ESP_OK) {
+            // idle and awake: nothing to stop or reinit
+            ctx->state = SENSOR_STATE_BOOT_SERIAL_SENT;
+            return SCD41_DELAY_GET_SERIAL_NUMBER_MS;
+        }
+        if (is_periodic(s_retained.sensors[ctx->slot].plan.mode)) {
+            // most likely still measuring: poll in the retained mode, a failure falls back to the bring-up
+            ctx->plan = s_retained.sensors[ctx->slot].plan;
+            ctx->warm_resume = true;
+            ctx->stats.warm_resumes++;
+            ctx->stats.ready_us = esp_timer_get_time();
+            expect_data(ctx, 0);
+            ESP_LOGI(TAG, "Sensor %u resuming %s measurement", ctx->slot, scd41_mode_name(ctx->plan.mode));
+            // a sensor put in after the reset would be idle, not measuring
+            publish_retained(ctx);
+            ctx->state = SENSOR_STATE_IDLE;
+            return 0;
+        }
+        ctx->state = SENSOR_STATE_BOOT_WAKE;
+        return 0;
+
+    case SENSOR_STATE_BOOT_WAKE:
+        // The sensor does not acknowledge wake_up, so the write result is meaningless
+        scd41_send_command(dev, SCD41_CMD_WAKE_UP);
+        ctx->state = SENSOR_STATE_BOOT_STOP;
+        return SCD41_DELAY_WAKE_UP_MS;
+
+    case SENSOR_STATE_BOOT_STOP:
+        err = scd41_send_command(dev, SCD41_CMD_STOP_PERIODIC_MEASUREMENT);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_BOOT_REINIT;
+        return SCD41_DELAY_STOP_PERIODIC_MS;
+
+    case SENSOR_STATE_BOOT_REINIT:
+        err = scd41_send_command(dev, SCD41_CMD_REINIT);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_BOOT_SERIAL;
+        return SCD41_DELAY_REINIT_MS;
+
+    case SENSOR_STATE_BOOT_SERIAL:
+        err = scd41_send_command(dev, SCD41_CMD_GET_SERIAL_NUMBER);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_BOOT_SERIAL_SENT;
+        return SCD41_DELAY_GET_SERIAL_NUMBER_MS;
+
+    case SENSOR_STATE_BOOT_SERIAL_SENT: {
+        uint16_t serial[3];
+        err = scd41_read_words(dev, serial, 3);
+        if (err != ESP_OK) {
+            break;
+        }
+        ESP_LOGI(TAG, "Sensor %u serial number: 0x%04x%04x%04x", ctx->slot, serial[0], serial[1], serial[2]);
+        if (ctx->retained_pending &&
+            memcmp(s_retained.sensors[ctx->slot].serial, serial, 3 * sizeof(uint16_t)) != 0) {
+            ESP_LOGW(TAG, "Sensor %u is not the one of the previous boot, retained state dropped", ctx->slot);
+            ctx->retained_pending = false;
+        }
+        retain_serial(ctx, serial);
+        publish_retained(ctx);
+        ctx->stats.ready_us = esp_timer_get_time();
+        ctx->state = SENSOR_STATE_IDLE;
+        return 0;
+    }
+
+    case SENSOR_STATE_IDLE: {
+        scd41_mode_plan_t plan = scd41_mode_select(interval_ms(ctx), ctx->config->co2_interval_ms,
+                                                   s_icd_mode.load(std::memory_order_relaxed));
+        if (plan.mode != ctx->plan.mode) {
+            uint32_t wait_ms;
+            if (switch_mode(ctx, &plan, &wait_ms, &err)) {
+                if (err != ESP_OK) {
+                    break;
+                }
+                return wait_ms;
+            }
+        }
+        ctx->plan.co2_every = plan.co2_every;
+
+        if (ctx->plan.mode == SCD41_MODE_SINGLE_SHOT) {
+            bool co2 = ctx->shot_count % ctx->plan.co2_every == 0;
+            err = scd41_send_command(dev, co2 ? SCD41_CMD_MEASURE_SINGLE_SHOT : SCD41_CMD_MEASURE_SINGLE_SHOT_RHT_ONLY);
+            if (err != ESP_OK) {
+                break;
+            }
+            ctx->shot_ms = co2 ? SCD41_DELAY_MEASURE_SINGLE_SHOT_MS : SCD41_DELAY_MEASURE_SINGLE_SHOT_RHT_MS;
+            ctx->state = SENSOR_STATE_SHOT_SENT;
+            return ctx->shot_ms;
+        }
+
+        err = scd41_send_command(dev, SCD41_CMD_GET_DATA_READY_STATUS);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_READY_SENT;
+        return SCD41_DELAY_GET_DATA_READY_MS;
+    }
+
+    case SENSOR_STATE_READY_SENT: {
+        uint16_t status;
+        err = scd41_read_words(dev, &status, 1);
+        if (err != ESP_OK) {
+            break;
+        }
+        if (!scd41_data_ready(status)) {
+            ctx->stats.not_ready++;
+            if (esp_timer_get_time() > ctx->data_due_us) {
+                // the sensor answers but stopped measuring
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            ctx->state = SENSOR_STATE_IDLE;
+            return SENSOR_POLL_RETRY_MS;
+        }
+        err = scd41_send_command(dev, SCD41_CMD_READ_MEASUREMENT);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_READ_SENT;
+        return SCD41_DELAY_READ_MEASUREMENT_MS;
+    }
+
+    case SENSOR_STATE_SHOT_SENT:
+        err = scd41_send_command(dev, SCD41_CMD_READ_MEASUREMENT);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_READ_SENT;
+        return SCD41_DELAY_READ_MEASUREMENT_MS;
+
+    case SENSOR_STATE_READ_SENT: {
+        uint16_t words[3];
+        SENSOR_PROBE_BEGIN(i2c_start);
+        err = scd41_read_words(dev, words, 3);
+        SENSOR_PROBE_END(SENSOR_PROBE_I2C, i2c_start);
+        if (err != ESP_OK) {
+            break;
+        }
+        ctx->state = SENSOR_STATE_IDLE;
+        ctx->sample_us = esp_timer_get_time();
+        if (ctx->plan.mode != SCD41_MODE_SINGLE_SHOT) {
+            uint32_t wait_ms = next_sample_ms(ctx, interval_ms(ctx));
+            expect_data(ctx, wait_ms);
+            queue_measurement(ctx, words[0], words);
+            return wait_ms;
+        }
+
+        // temperature/humidity-only shots report CO2 as 0
+        if (ctx->shot_count++ % ctx->plan.co2_every == 0) {
+            ctx->last_co2 = words[0];
+        }
+        queue_measurement(ctx, ctx->last_co2, words);
+        // the shot itself already took part of the interval
+        ctx->sample_us -= (int64_t)ctx->shot_ms * 1000;
+        return next_sample_ms(ctx, interval_ms(ctx) > ctx->shot_ms ? interval_ms(ctx) - ctx->shot_ms : 0);
+    }
+    }
+
+    // any failed transaction ends the cycle, sensor_health decides how and when to start over
+    ctx->stats.read_errors++;
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_READ_ERRORS, 1);
+    event_log_write(EVENT_LOG_READ_ERROR, ctx->slot, (uint16_t)err, ctx->state, 0);
+    ESP_LOGE(TAG, "Sensor %u error reading results %d (%s)", ctx->slot, err, esp_err_to_name(err));
+    if (ctx->warm_resume) {
+        // the sensor was not measuring after all
+        ctx->warm_resume = false;
+        ctx->plan = { SCD41_MODE_IDLE, 1 };
+        ctx->stats.ready_us = 0;
+        ctx->state = SENSOR_STATE_BOOT_WAKE;
+        return 0;
+    }
+    bool bringup = ctx->state < SENSOR_STATE_IDLE;
+    if (bringup) {
+        ctx->stats.bringup_failures++;
+    }
+
+    sensor_health_state_t was = ctx->health.state;
+    uint32_t wait_ms;
+    bool reset = sensor_health_failure(&ctx->health, interval_ms(ctx), &wait_ms) == SENSOR_RECOVERY_RESET;
+    if (reset) {
+        // a slave holding SDA low survives any number of retries, free the bus, then a full bring-up
+        esp_err_t recover_err = scd41_recover_bus(dev);
+        if (recover_err == ESP_OK) {
+            ctx->stats.bus_recoveries++;
+        }
+        ESP_LOGW(TAG, "Sensor %u: %lu failures in a row, bus recovery %s, next bring-up in %lu s", ctx->slot,
+                 (unsigned long)ctx->health.consecutive_failures, esp_err_to_name(recover_err),
+                 (unsigned long)(wait_ms / 1000));
+        ctx->plan = { SCD41_MODE_IDLE, 1 };
+        bringup = true;
+    }
+    if (ctx->health.state != was || reset) {
+        uint32_t wait_s = wait_ms / 1000;
+        event_log_write(EVENT_LOG_HEALTH, ctx->slot, ctx->health.state, (uint16_t)ctx->health.consecutive_failures,
+                        (uint16_t)(wait_s < UINT16_MAX ? wait_s : UINT16_MAX));
+    }
+    ctx->state = bringup ? SENSOR_STATE_BOOT_WAKE : SENSOR_STATE_IDLE;
+    notify_health(ctx);
+    return wait_ms;
+}
+
+/*
+  Apply what other threads asked for since the last step. Only a sensor
+  waiting for its next sample moves: a shorter interval counts from the
+  last sample (then onto the wake grid), a sample request makes it due
+  now. Command waits and failure backoff are left alone.
+*/
+static void reschedule(scd4x_sensor_ctx_t *ctx, int64_t now)
+{
+    bool changed = ctx->interval_changed.exchange(false, std::memory_order_relaxed);
+    bool requested = ctx->sample_requested.exchange(false, std::memory_order_relaxed);
+    if (ctx->state != SENSOR_STATE_IDLE || ctx->health.consecutive_failures || ctx->due_us <= now) {
+        return;
+    }
+    int64_t due_us = ctx->due_us;
+    if (changed && ctx->sample_us) {
+        int64_t next_us = ctx->sample_us + (int64_t)interval_ms(ctx) * 1000;
+        due_us = next_us > now ? next_us : now;
+        due_us += grid_shift_us(ctx, due_us);
+        if (due_us < now) {
+            due_us = now;
+        }
+    }
+    if (requested) {
+        due_us = now;
+        ctx->stats.requested++;
+    }
+    if (due_us < ctx->due_us) {
+        ctx->due_us = due_us;
+    }
+}
+
+// Log a change of the bus clock the step's transactions led to, once for the sensor that caused it
+static void note_clock(scd4x_sensor_ctx_t *ctx, uint32_t from_hz)
+{
+    const scd41_clock_t *clock = ctx->config->dev->clock;
+    if (clock == NULL || clock->hz == from_hz) {
+        return;
+    }
+    event_log_write(EVENT_LOG_BUS_CLOCK, ctx->slot, (uint16_t)(clock->hz / 1000), (uint16_t)(from_hz / 1000),
+                    (uint16_t)clock->fallbacks);
+}
+
+/*
+  Every sensor keeps its own deadline and the task sleeps until the
+  earliest one, so the command execution time of one sensor is spent
+  stepping the others instead of adding up.
+*/
+uint32_t sensor_task_step(void)
+{
+    if (!s_initialized) {
+        return SENSOR_POLL_RETRY_MS;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+    for (size_t i = 0; i < s_count; i++) {
+        scd4x_sensor_ctx_t *ctx = &s_sensors[i];
+        reschedule(ctx, now);
+        if (ctx->due_us <= now) {
+            const scd41_clock_t *clock = ctx->config->dev->clock;
+            uint32_t clock_hz = clock ? clock->hz : 0;
+            SENSOR_PROBE_BEGIN(step_start);
+            uint32_t wait_ms = step(ctx);
+            SENSOR_PROBE_END(SENSOR_PROBE_STEP, step_start);
+            note_clock(ctx, clock_hz);
+            // from the end of the step: the command it sent is executing now
+            ctx->due_us = esp_timer_get_time() + (int64_t)wait_ms * 1000;
+        }
+        if (ctx->due_us < next_us) {
+            next_us = ctx->due_us;
+        }
+    }
+    now = esp_timer_get_time();
+    return next_us > now ? (uint32_t)((next_us - now + 999) / 1000) : 0;
+}
+
+void sensor_task_set_icd_mode(sensor_icd_mode_t icd_mode)
+{
+    s_icd_mode.store(icd_mode, std::memory_order_relaxed);
+}
+
+void sensor_task_set_wake_grid(uint32_t period_ms, int64_t anchor_us, uint8_t slip_pct)
+{
+    s_grid_slip_pct.store(slip_pct, std::memory_order_relaxed);
+    s_grid_phase_ms.store(period_ms ? (uint32_t)(anchor_us / 1000 % period_ms) : 0, std::memory_order_relaxed);
+    s_grid_period_ms.store(period_ms, std::memory_order_relaxed);
+}
+
+void sensor_task_set_interval(size_t sensor, uint32_t interval_ms)
+{
+    scd4x_sensor_ctx_t *ctx = &s_sensors[sensor];
+    uint32_t was_ms = ctx->demand_ms.exchange(interval_ms, std::memory_order_relaxed);
+    if (was_ms == interval_ms) {
+        return;
+    }
+    ctx->interval_changed.store(true, std::memory_order_relaxed);
+    // a longer interval applies from the next sample, only a shorter one needs the task now
+    if (was_ms == 0 || interval_ms == 0 || interval_ms < was_ms) {
+        sensor_task_wake();
+    }
+}
+
+void sensor_task_request_sample(size_t sensor)
+{
+    s_sensors[sensor].sample_requested.store(true, std::memory_order_relaxed);
+    sensor_task_wake();
+}
+
+size_t sensor_task_count(void)
+{
+    return s_count;
+}
+
+void sensor_task_get_plan(size_t sensor, scd41_mode_plan_t *plan)
+{
+    *plan = s_sensors[sensor].plan;
+}
+
+bool sensor_measurement_pop(sensor_measurement_t *measurement)
+{
+    return s_queue.pop(measurement);
+}
+
+void sensor_task_get_stats(size_t sensor, scd4x_sensor_stats_t *stats)
+{
+    *stats = s_sensors[sensor].stats;
+}
+
+void sensor_task_get_health(size_t sensor, sensor_health_t *health)
+{
+    *health = s_sensors[sensor].health;
+}
+
+void sensor_task_get_bus_stats(size_t sensor, scd41_bus_stats_t *stats)
+{
+    scd41_get_bus_stats(s_sensors[sensor].config->dev, stats);
+}
+
+esp_err_t sensor_task_init(scd4x_sensor_config_t *configs, size_t count)
+{
+    if (configs == NULL || count == 0 || count > SCD4X_SENSOR_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        // we need the callback so that we can start notifying application layer
+        if (configs[i].dev == NULL || configs[i].cb == NULL || configs[i].slot >= SCD4X_SENSOR_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_queue.reset();
+    s_icd_mode.store(configs[0].icd_mode, std::memory_order_relaxed);
+    bool retained = retained_valid();
+    int64_t now = esp_timer_get_time();
+    for (size_t i = 0; i < count; i++) {
+        scd4x_sensor_ctx_t *ctx = &s_sensors[i];
+        // keep the pointer to config
+        ctx->config = &configs[i];
+        ctx->index = (uint8_t)i;
+        ctx->slot = configs[i].slot;
+        // the slot's entry is only trusted for the sensor at the same port and mux channel
+        bool warm = configs[i].warm_start && retained && retained_matches(&configs[i]);
+        ctx->state = warm ? SENSOR_STATE_WARM_PROBE : SENSOR_STATE_BOOT_WAKE;
+        ctx->due_us = now;
+        // the bring-up leaves the sensor idle, the first sample starts the selected mode
+        ctx->plan = { SCD41_MODE_IDLE, 1 };
+        ctx->shot_count = 0;
+        ctx->warm_resume = false;
+        ctx->retained_pending = warm && s_retained.sensors[ctx->slot].has_sample;
+        ctx->sample_us = 0;
+        ctx->demand_ms.store(0, std::memory_order_relaxed);
+        ctx->sample_requested.store(false, std::memory_order_relaxed);
+        ctx->interval_changed.store(false, std::memory_order_relaxed);
+        memset(&ctx->stats, 0, sizeof(ctx->stats));
+        sensor_health_init(&ctx->health);
+    }
+    s_count = count;
+    s_initialized = true;
+
+    esp_err_t err = sensor_task_create();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "sensor task creation failed, err:%d", err);
+        s_initialized = false;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "%u scd4x initialized successfully%s", (unsigned)count,
+             configs[0].warm_start && retained ? ", warm start" : "");
+    return ESP_OK;
+}
+
+esp_err_t sensor_task_deinit(void)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sensor_task_delete();
+    for (size_t i = 0; i < s_count; i++) {
+        s_sensors[i].config = NULL;
+    }
+    s_count = 0;
+    s_initialized = false;
+    return ESP_OK;
+}
@@ -0,0 +1,54 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <scd4x_sensor.h>
+
+#define SENSOR_TASK_STACK_SIZE  3072
+// below the Matter and OpenThread tasks: sampling is never urgent
+#define SENSOR_TASK_PRIORITY    (tskIDLE_PRIORITY + 1)
+
+static TaskHandle_t s_task;
+
+static void sensor_task(void *arg)
+{
+    for (;;) {
+        uint32_t wait_ms = sensor_task_step();
+        // the timeout may expire up to one tick early, the sensor needs the full execution time;
+        // a notification from sensor_task_wake() ends the wait early, the step then re-checks every deadline
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms) + 1);
+    }
+}
+
+esp_err_t sensor_task_create(void)
+{
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTaskCreate(sensor_task, "sensor", SENSOR_TASK_STACK_SIZE, NULL, SENSOR_TASK_PRIORITY, &s_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void sensor_task_wake(void)
+{
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void sensor_task_delete(void)
+{
+    if (s_task) {
+        vTaskDelete(s_task);
+        s_task = NULL;
+    }
+}
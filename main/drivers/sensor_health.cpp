@@ -0,0 +1,59 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <sdkconfig.h>
+
+#include <sensor_health.h>
+
+void sensor_health_init(sensor_health_t *health)
+{
+    memset(health, 0, sizeof(*health));
+}
+
+sensor_recovery_t sensor_health_failure(sensor_health_t *health, uint32_t interval_ms, uint32_t *wait_ms)
+{
+    health->failures++;
+    uint32_t n = ++health->consecutive_failures;
+    health->state = n >= SENSOR_HEALTH_FAILED_AFTER ? SENSOR_HEALTH_FAILED : SENSOR_HEALTH_DEGRADED;
+
+    if (n < SENSOR_HEALTH_RECOVER_AFTER) {
+        *wait_ms = interval_ms;
+        return SENSOR_RECOVERY_RETRY;
+    }
+
+    // interval, 2x, 4x, ... capped
+    uint64_t max_ms = (uint64_t)CONFIG_SENSOR_HEALTH_MAX_BACKOFF_SEC * 1000;
+    uint32_t shift = n - SENSOR_HEALTH_RECOVER_AFTER;
+    uint64_t backoff_ms = shift < 32 ? (uint64_t)interval_ms << shift : max_ms;
+    *wait_ms = (uint32_t)(backoff_ms < max_ms ? backoff_ms : max_ms);
+    health->resets++;
+    return SENSOR_RECOVERY_RESET;
+}
+
+bool sensor_health_success(sensor_health_t *health)
+{
+    if (health->consecutive_failures == 0) {
+        return false;
+    }
+    health->consecutive_failures = 0;
+    health->state = SENSOR_HEALTH_OK;
+    health->recoveries++;
+    return true;
+}
+
+const char *sensor_health_name(sensor_health_state_t state)
+{
+    switch (state) {
+    case SENSOR_HEALTH_OK:          return "ok";
+    case SENSOR_HEALTH_DEGRADED:    return "degraded";
+    case SENSOR_HEALTH_FAILED:      return "failed";
+    default:                        return "unknown";
+    }
+}
@@ -0,0 +1,126 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <sensor_probe.h>
+
+#if CONFIG_SENSOR_PROBES
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static sensor_probe_snapshot_t s_probes;
+
+static const char *const s_probe_names[SENSOR_PROBE_COUNT] = {
+    [SENSOR_PROBE_STEP] = "step",
+    [SENSOR_PROBE_I2C] = "i2c_read",
+    [SENSOR_PROBE_HOP] = "hop",
+    [SENSOR_PROBE_WRITE] = "attr_write",
+};
+
+static const char *const s_counter_names[SENSOR_COUNTER_COUNT] = {
+    [SENSOR_COUNTER_SAMPLES] = "samples",
+    [SENSOR_COUNTER_READ_ERRORS] = "read_errors",
+    [SENSOR_COUNTER_UPDATES] = "updates",
+    [SENSOR_COUNTER_SUPPRESSED] = "suppressed",
+    [SENSOR_COUNTER_DIRTY_MARKS] = "dirty_marks",
+};
+
+void sensor_probe_record(sensor_probe_t probe, uint32_t cycles)
+{
+    sensor_probe_hist_t *hist = &s_probes.hist[probe];
+    // floor(log2(cycles)), 0 for 0 and 1
+    int bucket = cycles > 1 ? 31 - __builtin_clz(cycles) : 0;
+    if (bucket >= SENSOR_PROBE_BUCKETS) {
+        bucket = SENSOR_PROBE_BUCKETS - 1;
+    }
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->total += cycles;
+    if (cycles > hist->max) {
+        hist->max = cycles;
+    }
+}
+
+void sensor_probe_add(sensor_counter_t counter, uint32_t n)
+{
+    s_probes.counters[counter] += n;
+}
+
+void sensor_probe_snapshot(sensor_probe_snapshot_t *snapshot)
+{
+    memcpy(snapshot, &s_probes, sizeof(*snapshot));
+}
+
+void sensor_probe_reset(void)
+{
+    memset(&s_probes, 0, sizeof(s_probes));
+}
+
+void sensor_probe_print(void)
+{
+    sensor_probe_snapshot_t snapshot;
+    sensor_probe_snapshot(&snapshot);
+
+    for (int i = 0; i < SENSOR_COUNTER_COUNT; i++) {
+        printf("%-12s %" PRIu32 "\n", s_counter_names[i], snapshot.counters[i]);
+    }
+    for (int p = 0; p < SENSOR_PROBE_COUNT; p++) {
+        const sensor_probe_hist_t *hist = &snapshot.hist[p];
+        printf("%-12s count %" PRIu32 " mean %" PRIu32 " max %" PRIu32 " cycles\n", s_probe_names[p], hist->count,
+               hist->count ? (uint32_t)(hist->total / hist->count) : 0, hist->max);
+        for (int b = 0; b < SENSOR_PROBE_BUCKETS; b++) {
+            if (hist->buckets[b]) {
+                printf("  >= 2^%-2d %" PRIu32 "\n", b, hist->buckets[b]);
+            }
+        }
+    }
+}
+
+static uint8_t *put_u16(uint8_t *p, uint32_t v)
+{
+    if (v > UINT16_MAX) {
+        v = UINT16_MAX;
+    }
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p = put_u16(p, v & 0xffff);
+    return put_u16(p, v >> 16);
+}
+
+size_t sensor_probe_encode(uint8_t *buf, size_t len)
+{
+    if (len < SENSOR_PROBE_ENCODED_LEN) {
+        return 0;
+    }
+
+    sensor_probe_snapshot_t snapshot;
+    sensor_probe_snapshot(&snapshot);
+
+    uint8_t *p = buf;
+    *p++ = SENSOR_PROBE_ENCODING_VERSION;
+    for (int i = 0; i < SENSOR_COUNTER_COUNT; i++) {
+        p = put_u32(p, snapshot.counters[i]);
+    }
+    for (int i = 0; i < SENSOR_PROBE_COUNT; i++) {
+        const sensor_probe_hist_t *hist = &snapshot.hist[i];
+        p = put_u32(p, hist->count);
+        p = put_u32(p, hist->max);
+        for (int b = 0; b < SENSOR_PROBE_BUCKETS; b++) {
+            p = put_u16(p, hist->buckets[b]);
+        }
+    }
+    return (size_t)(p - buf);
+}
+
+#endif // CONFIG_SENSOR_PROBES
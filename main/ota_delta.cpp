@@ -0,0 +1,332 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <ota_delta.h>
+
+/*
+  Patch layout, little endian:
+    0  magic     u32  "DLT1"
+    4  old_size  u32
+    8  old_crc   u32
+   12  new_size  u32
+   16  new_crc   u32
+   20  the operations, LZ compressed
+  LZ: a flag byte comes before every 8 tokens, bit 0 first. A clear bit is
+  a literal byte, a set bit a match of two bytes: distance - 1 in 11 bits,
+  low byte first, and length - 3 in the top 5 bits of the second byte.
+  Operations are varints of 7 bit groups, least significant first. They
+  end with the last byte of the new image.
+*/
+#define DELTA_MAGIC         0x31544c44u
+#define WINDOW_MASK         (OTA_DELTA_WINDOW_SIZE - 1)
+#define MATCH_MIN           3
+
+static_assert((OTA_DELTA_WINDOW_SIZE & WINDOW_MASK) == 0, "window must be a power of 2");
+
+// nibble table, 64 bytes instead of 1 KB
+static const uint32_t s_crc_table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+uint32_t ota_delta_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ s_crc_table[crc & 0xf];
+        crc = (crc >> 4) ^ s_crc_table[crc & 0xf];
+    }
+    return ~crc;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+void ota_delta_pack_header(const ota_delta_header_t *header, uint8_t out[OTA_DELTA_HEADER_SIZE])
+{
+    put_u32(&out[0], DELTA_MAGIC);
+    put_u32(&out[4], header->old_size);
+    put_u32(&out[8], header->old_crc);
+    put_u32(&out[12], header->new_size);
+    put_u32(&out[16], header->new_crc);
+}
+
+bool ota_delta_is_patch(const uint8_t *data, size_t len)
+{
+    return len >= 4 && get_u32(data) == DELTA_MAGIC;
+}
+
+void ota_delta_init(ota_delta_t *delta, ota_delta_read_t read, ota_delta_write_t write, void *ctx)
+{
+    memset(delta, 0, sizeof(*delta));
+    delta->read = read;
+    delta->write = write;
+    delta->ctx = ctx;
+}
+
+static void fail(ota_delta_t *delta, esp_err_t err)
+{
+    if (delta->err == ESP_OK) {
+        delta->err = err;
+    }
+}
+
+static void flush_out(ota_delta_t *delta)
+{
+    if (delta->out_len == 0 || delta->err != ESP_OK) {
+        return;
+    }
+    delta->new_crc = ota_delta_crc32(delta->new_crc, delta->out_buf, delta->out_len);
+    fail(delta, delta->write(delta->out_buf, delta->out_len, delta->ctx));
+    delta->out_len = 0;
+}
+
+static void emit(ota_delta_t *delta, uint8_t value)
+{
+    if (delta->new_len >= delta->header.new_size) {
+        fail(delta, ESP_ERR_INVALID_SIZE);
+        return;
+    }
+    delta->out_buf[delta->out_len++] = value;
+    delta->new_len++;
+    if (delta->out_len == OTA_DELTA_BUF_SIZE) {
+        flush_out(delta);
+    }
+}
+
+static uint8_t old_byte(ota_delta_t *delta)
+{
+    uint32_t pos = delta->old_pos++;
+    if (pos - delta->old_buf_offset >= delta->old_buf_len) {
+        uint32_t len = delta->header.old_size - pos;
+        delta->old_buf_offset = pos;
+        delta->old_buf_len = len < OTA_DELTA_BUF_SIZE ? len : OTA_DELTA_BUF_SIZE;
+        esp_err_t err = delta->read(pos, delta->old_buf, delta->old_buf_len, delta->ctx);
+        if (err != ESP_OK) {
+            delta->old_buf_len = 0;
+            fail(delta, err);
+            return 0;
+        }
+    }
+    return delta->old_buf[pos - delta->old_buf_offset];
+}
+
+// n bytes of the old image straight into the output buffer
+static void copy_old(ota_delta_t *delta, uint32_t n)
+{
+    while (n > 0 && delta->err == ESP_OK) {
+        uint32_t len = OTA_DELTA_BUF_SIZE - delta->out_len;
+        len = n < len ? n : len;
+        fail(delta, delta->read(delta->old_pos, &delta->out_buf[delta->out_len], len, delta->ctx));
+        delta->out_len += len;
+        delta->new_len += len;
+        delta->old_pos += len;
+        n -= len;
+        if (delta->out_len == OTA_DELTA_BUF_SIZE) {
+            flush_out(delta);
+        }
+    }
+}
+
+static bool fits(const ota_delta_t *delta, ota_delta_op_t op, uint32_t n)
+{
+    if (op != OTA_DELTA_OP_DATA && (uint64_t)delta->old_pos + n > delta->header.old_size) {
+        return false;
+    }
+    return (uint64_t)delta->new_len + n <= delta->header.new_size;
+}
+
+static void start_op(ota_delta_t *delta, uint32_t value)
+{
+    ota_delta_op_t op = (ota_delta_op_t)(value & 3);
+    uint32_t n = value >> 2;
+    if (op == OTA_DELTA_OP_SEEK) {
+        int64_t pos = (int64_t)delta->old_pos + (int32_t)((n >> 1) ^ -(n & 1));
+        if (pos < 0 || pos > delta->header.old_size) {
+            fail(delta, ESP_ERR_INVALID_SIZE);
+            return;
+        }
+        delta->old_pos = (uint32_t)pos;
+        return;
+    }
+    if (!fits(delta, op, n)) {
+        fail(delta, ESP_ERR_INVALID_SIZE);
+        return;
+    }
+    if (op == OTA_DELTA_OP_COPY) {
+        copy_old(delta, n);
+    } else {
+        delta->op = op;
+        delta->op_left = n;
+    }
+}
+
+// one byte of the decompressed operations
+static void op_byte(ota_delta_t *delta, uint8_t value)
+{
+    if (delta->op_left > 0) {
+        delta->op_left--;
+        emit(delta, delta->op == OTA_DELTA_OP_ADD ? (uint8_t)(old_byte(delta) + value) : value);
+        return;
+    }
+    // the image is complete, anything further is garbage
+    if (delta->new_len == delta->header.new_size && delta->varint_shift == 0) {
+        fail(delta, ESP_ERR_INVALID_SIZE);
+        return;
+    }
+    if (delta->varint_shift == 28 && (value & 0x70)) {
+        fail(delta, ESP_ERR_INVALID_SIZE);
+        return;
+    }
+    delta->varint |= (uint32_t)(value & 0x7f) << delta->varint_shift;
+    if (value & 0x80) {
+        delta->varint_shift += 7;
+        if (delta->varint_shift > 28) {
+            fail(delta, ESP_ERR_INVALID_SIZE);
+        }
+        return;
+    }
+    uint32_t varint = delta->varint;
+    delta->varint = 0;
+    delta->varint_shift = 0;
+    start_op(delta, varint);
+}
+
+static void put(ota_delta_t *delta, uint8_t value)
+{
+    delta->window[delta->window_pos] = value;
+    delta->window_pos = (delta->window_pos + 1) & WINDOW_MASK;
+    op_byte(delta, value);
+}
+
+static void lz_byte(ota_delta_t *delta, uint8_t value)
+{
+    if (delta->flag_bits == 0) {
+        delta->flags = value;
+        delta->flag_bits = 8;
+        return;
+    }
+    if (!(delta->flags & 1)) {
+        delta->flags >>= 1;
+        delta->flag_bits--;
+        put(delta, value);
+        return;
+    }
+    if (!delta->have_match_lo) {
+        delta->match_lo = value;
+        delta->have_match_lo = true;
+        return;
+    }
+    delta->have_match_lo = false;
+    delta->flags >>= 1;
+    delta->flag_bits--;
+    uint32_t distance = (delta->match_lo | ((value & 7) << 8)) + 1;
+    uint32_t length = (value >> 3) + MATCH_MIN;
+    for (uint32_t i = 0; i < length && delta->err == ESP_OK; i++) {
+        put(delta, delta->window[(delta->window_pos - distance) & WINDOW_MASK]);
+    }
+}
+
+bool ota_delta_check_pending(const ota_delta_t *delta)
+{
+    return delta->header_len == OTA_DELTA_HEADER_SIZE && !delta->checked && delta->err == ESP_OK;
+}
+
+esp_err_t ota_delta_check_step(ota_delta_t *delta, uint32_t reads)
+{
+    if (!ota_delta_check_pending(delta)) {
+        return delta->err;
+    }
+    for (; reads > 0 && delta->check_pos < delta->header.old_size && delta->err == ESP_OK; reads--) {
+        uint32_t len = delta->header.old_size - delta->check_pos;
+        len = len < OTA_DELTA_BUF_SIZE ? len : OTA_DELTA_BUF_SIZE;
+        fail(delta, delta->read(delta->check_pos, delta->old_buf, len, delta->ctx));
+        delta->check_crc = ota_delta_crc32(delta->check_crc, delta->old_buf, len);
+        delta->check_pos += len;
+    }
+    if (delta->err != ESP_OK) {
+        return delta->err;
+    }
+    if (delta->check_pos < delta->header.old_size) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    delta->checked = true;
+    if (delta->check_crc != delta->header.old_crc) {
+        fail(delta, ESP_ERR_INVALID_STATE);
+    }
+    return delta->err;
+}
+
+esp_err_t ota_delta_feed(ota_delta_t *delta, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    if (delta->header_len < OTA_DELTA_HEADER_SIZE && delta->err == ESP_OK) {
+        size_t take = OTA_DELTA_HEADER_SIZE - delta->header_len;
+        take = len < take ? len : take;
+        memcpy(&delta->header_buf[delta->header_len], data, take);
+        delta->header_len += take;
+        i = take;
+        if (delta->header_len == OTA_DELTA_HEADER_SIZE) {
+            if (!ota_delta_is_patch(delta->header_buf, OTA_DELTA_HEADER_SIZE)) {
+                fail(delta, ESP_ERR_INVALID_VERSION);
+            } else {
+                delta->header.old_size = get_u32(&delta->header_buf[4]);
+                delta->header.old_crc = get_u32(&delta->header_buf[8]);
+                delta->header.new_size = get_u32(&delta->header_buf[12]);
+                delta->header.new_crc = get_u32(&delta->header_buf[16]);
+            }
+        }
+    }
+    if (i < len && ota_delta_check_pending(delta)) {
+        ota_delta_check_step(delta, UINT32_MAX);
+    }
+    for (; i < len && delta->err == ESP_OK; i++) {
+        lz_byte(delta, data[i]);
+    }
+    return delta->err;
+}
+
+esp_err_t ota_delta_finish(ota_delta_t *delta)
+{
+    if (delta->err != ESP_OK) {
+        return delta->err;
+    }
+    if (delta->header_len < OTA_DELTA_HEADER_SIZE || !delta->checked || delta->new_len < delta->header.new_size ||
+        delta->op_left > 0 || delta->varint_shift > 0 || delta->have_match_lo) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    flush_out(delta);
+    if (delta->err == ESP_OK && delta->new_crc != delta->header.new_crc) {
+        fail(delta, ESP_ERR_INVALID_CRC);
+    }
+    return delta->err;
+}
+
+const ota_delta_header_t *ota_delta_get_header(const ota_delta_t *delta)
+{
+    return delta->header_len == OTA_DELTA_HEADER_SIZE && delta->err != ESP_ERR_INVALID_VERSION ?
+           &delta->header : NULL;
+}
+
+uint32_t ota_delta_written(const ota_delta_t *delta)
+{
+    return delta->new_len;
+}
@@ -0,0 +1,142 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Delta OTA patches: the new app image rebuilt from the running one.
+
+  A patch is a header and a compressed list of operations. After an
+  app-only change most of the new image is the old one, moved around and
+  with addresses changed here and there; the operations copy it from the
+  running slot, add the few changed bytes to it and carry only the truly
+  new bytes. host/tools/ota_delta creates patches.
+
+  The applier takes the patch in pieces of any size as they arrive, reads
+  the running image through a callback and writes the new one in order
+  through another, in the fixed memory of ota_delta_t (2.6 KB on the
+  32 bit targets; 3.6 KB with the requestor's 1 KB block buffer). It checks that the running image is the one the patch
+  was made from before writing anything, and the CRC of the new image at
+  the end. Reading the whole running image for that check takes a while,
+  so a caller on an event loop feeds the header alone and then runs the
+  check in bounded steps with ota_delta_check_step().
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#define OTA_DELTA_HEADER_SIZE   20
+// LZ window of the compressed operations
+#define OTA_DELTA_WINDOW_SIZE   2048
+#define OTA_DELTA_BUF_SIZE      256
+// reads of OTA_DELTA_BUF_SIZE per ota_delta_check_step() for callers without a bound of their own, 4 KB
+#define OTA_DELTA_CHECK_READS   16
+
+// Operations, each a varint whose low 2 bits are the kind and the rest n
+typedef enum {
+    // n bytes of the old image as they are
+    OTA_DELTA_OP_COPY,
+    // n bytes of the old image, each plus the next patch byte
+    OTA_DELTA_OP_ADD,
+    // n new bytes from the patch
+    OTA_DELTA_OP_DATA,
+    // move in the old image by n, zigzag coded
+    OTA_DELTA_OP_SEEK,
+} ota_delta_op_t;
+
+typedef struct {
+    uint32_t old_size;
+    // CRC-32 of the old and the new image
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+} ota_delta_header_t;
+
+// Read len bytes of the running image at offset
+typedef esp_err_t (*ota_delta_read_t)(uint32_t offset, uint8_t *data, size_t len, void *ctx);
+// Write the next len bytes of the new image
+typedef esp_err_t (*ota_delta_write_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    ota_delta_read_t read;
+    ota_delta_write_t write;
+    void *ctx;
+
+    uint8_t header_buf[OTA_DELTA_HEADER_SIZE];
+    uint8_t header_len;
+    ota_delta_header_t header;
+    // check of the old image against header.old_crc: bytes read so far and their CRC
+    uint32_t check_pos;
+    uint32_t check_crc;
+    bool checked;
+
+    // LZ decoder: flags of the next 8 tokens, first byte of a match
+    uint8_t flags;
+    uint8_t flag_bits;
+    bool have_match_lo;
+    uint8_t match_lo;
+    uint16_t window_pos;
+    uint8_t window[OTA_DELTA_WINDOW_SIZE];
+
+    // operation being decoded
+    uint32_t varint;
+    uint8_t varint_shift;
+    ota_delta_op_t op;
+    uint32_t op_left;
+
+    // position in the old image, bytes of the new one so far and their CRC
+    uint32_t old_pos;
+    uint32_t new_len;
+    uint32_t new_crc;
+
+    uint8_t old_buf[OTA_DELTA_BUF_SIZE];
+    uint32_t old_buf_offset;
+    uint16_t old_buf_len;
+    uint8_t out_buf[OTA_DELTA_BUF_SIZE];
+    uint16_t out_len;
+
+    esp_err_t err;
+} ota_delta_t;
+
+// Whether data, the start of an image, is a patch
+bool ota_delta_is_patch(const uint8_t *data, size_t len);
+
+void ota_delta_init(ota_delta_t *delta, ota_delta_read_t read, ota_delta_write_t write, void *ctx);
+
+// The next len bytes of the patch. Once the header is in, operations are only
+// applied after the old image was checked; if the check is still pending, this
+// runs the rest of it first. Errors stick:
+//   ESP_ERR_INVALID_VERSION   not a patch, or a newer format
+//   ESP_ERR_INVALID_STATE     the running image is not the one the patch was made from
+//   ESP_ERR_INVALID_SIZE      the patch reads or writes past an image
+//   anything read or write returned
+esp_err_t ota_delta_feed(ota_delta_t *delta, const uint8_t *data, size_t len);
+
+// The header is in, the old image not checked yet
+bool ota_delta_check_pending(const ota_delta_t *delta);
+
+// Up to reads reads of the old image for the check: ESP_ERR_NOT_FINISHED while more
+// are left, ESP_OK once it matches, ESP_ERR_INVALID_STATE if it does not
+esp_err_t ota_delta_check_step(ota_delta_t *delta, uint32_t reads);
+
+// After the last byte: ESP_ERR_NOT_FINISHED if the patch was cut short, ESP_ERR_INVALID_CRC on a CRC mismatch
+esp_err_t ota_delta_finish(ota_delta_t *delta);
+
+// NULL until the header is in
+const ota_delta_header_t *ota_delta_get_header(const ota_delta_t *delta);
+
+// Bytes of the new image written so far
+uint32_t ota_delta_written(const ota_delta_t *delta);
+
+// CRC-32 (IEEE 802.3) of data, continuing crc; start with 0
+uint32_t ota_delta_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+// Header in patch byte order, for the patch creator
+void ota_delta_pack_header(const ota_delta_header_t *header, uint8_t out[OTA_DELTA_HEADER_SIZE]);
@@ -0,0 +1,367 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_matter_ota.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+
+#include <app/clusters/ota-requestor/ExtendedOTARequestorDriver.h>
+#include <app/clusters/ota-requestor/OTADownloader.h>
+#include <app/clusters/ota-requestor/OTARequestorInterface.h>
+#include <lib/core/OTAImageHeader.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <platform/OTAImageProcessor.h>
+
+#include <ota_delta.h>
+#include <ota_delta_requestor.h>
+
+using namespace chip;
+using namespace chip::DeviceLayer;
+
+static const char *TAG = "ota_delta";
+
+// the requestor's BDX block size
+#define OTA_BLOCK_MAX   1024
+
+typedef enum {
+    // fewer than 4 payload bytes seen
+    PAYLOAD_UNKNOWN,
+    PAYLOAD_FULL,
+    PAYLOAD_DELTA,
+} payload_kind_t;
+
+class DeltaImageProcessor : public OTAImageProcessorInterface
+{
+public:
+    CHIP_ERROR PrepareDownload() override;
+    CHIP_ERROR Finalize() override;
+    CHIP_ERROR Apply() override;
+    CHIP_ERROR Abort() override;
+    CHIP_ERROR ProcessBlock(ByteSpan &block) override;
+    bool IsFirstImageRun() override;
+    CHIP_ERROR ConfirmCurrentImage() override;
+    void SetOTADownloader(OTADownloader *downloader) { m_downloader = downloader; }
+
+private:
+    static void HandlePrepareDownload(intptr_t context);
+    static void HandleProcessBlock(intptr_t context);
+    static void HandleBlockRest(intptr_t context);
+    static void HandleFinalize(intptr_t context);
+    static void HandleAbort(intptr_t context);
+    static void HandleApply(intptr_t context);
+
+    OTADownloader *m_downloader = nullptr;
+};
+
+// everything below belongs to the matter thread
+static DeltaImageProcessor s_processor;
+static ExtendedOTARequestorDriver s_driver;
+static OTAImageHeaderParser s_header_parser;
+static const esp_partition_t *s_update_part;
+static const esp_partition_t *s_running_part;
+static esp_ota_handle_t s_ota_handle;
+static uint8_t s_block[OTA_BLOCK_MAX];
+static size_t s_block_len;
+// payload of the block from here on not written yet
+static size_t s_block_pos;
+// between PrepareDownload and Finalize or Abort
+static bool s_active;
+static payload_kind_t s_kind;
+static uint8_t s_magic[4];
+static size_t s_magic_len;
+// patch bytes fed to the applier
+static uint32_t s_patch_len;
+// 2.6 KB, 3.6 KB with s_block; static so a download never depends on the heap
+static ota_delta_t s_delta;
+
+static void post_state(OtaState state)
+{
+    ChipDeviceEvent event;
+    event.Type = DeviceEventType::kOtaStateChanged;
+    event.OtaStateChanged.newState = state;
+    PlatformMgr().PostEventOrDie(&event);
+}
+
+static esp_err_t running_read(uint32_t offset, uint8_t *data, size_t len, void *ctx)
+{
+    return esp_partition_read(s_running_part, offset, data, len);
+}
+
+static esp_err_t update_write(const uint8_t *data, size_t len, void *ctx)
+{
+    return esp_ota_write(s_ota_handle, data, len);
+}
+
+// Write from the start of data, *used tells how far. A patch's header goes in on its own,
+// so that the check of the running image can run in steps before any operation
+static esp_err_t write_payload(const uint8_t *data, size_t len, size_t *used)
+{
+    *used = 0;
+    // the first bytes tell a patch from a full image
+    if (s_kind == PAYLOAD_UNKNOWN) {
+        size_t take = sizeof(s_magic) - s_magic_len;
+        take = len < take ? len : take;
+        memcpy(&s_magic[s_magic_len], data, take);
+        s_magic_len += take;
+        *used = take;
+        if (s_magic_len < sizeof(s_magic)) {
+            return ESP_OK;
+        }
+        if (ota_delta_is_patch(s_magic, sizeof(s_magic))) {
+            s_kind = PAYLOAD_DELTA;
+            s_patch_len = 0;
+            ota_delta_init(&s_delta, running_read, update_write, NULL);
+            ESP_LOGI(TAG, "Delta patch against the running image");
+        } else {
+            s_kind = PAYLOAD_FULL;
+            return esp_ota_write(s_ota_handle, s_magic, sizeof(s_magic));
+        }
+        data = s_magic;
+        len = sizeof(s_magic);
+    } else if (s_kind == PAYLOAD_FULL) {
+        *used = len;
+        return esp_ota_write(s_ota_handle, data, len);
+    }
+
+    if (s_patch_len < OTA_DELTA_HEADER_SIZE && len > OTA_DELTA_HEADER_SIZE - s_patch_len) {
+        len = OTA_DELTA_HEADER_SIZE - s_patch_len;
+    }
+    bool had_header = ota_delta_get_header(&s_delta) != NULL;
+    esp_err_t err = ota_delta_feed(&s_delta, data, len);
+    s_patch_len += len;
+    if (data != s_magic) {
+        *used = len;
+    }
+    const ota_delta_header_t *header = ota_delta_get_header(&s_delta);
+    if (!had_header && header) {
+        ESP_LOGI(TAG, "Patch rebuilds %" PRIu32 " bytes from %" PRIu32, header->new_size, header->old_size);
+    }
+    return err;
+}
+
+static void download_failed(OTADownloader *downloader, esp_err_t err)
+{
+    s_active = false;
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "The running image is not the one the patch was made from");
+    } else {
+        ESP_LOGE(TAG, "Image write failed: %s", esp_err_to_name(err));
+    }
+    downloader->EndDownload(CHIP_ERROR_WRITE_FAILED);
+    post_state(kOtaDownloadFailed);
+}
+
+CHIP_ERROR DeltaImageProcessor::PrepareDownload()
+{
+    return PlatformMgr().ScheduleWork(HandlePrepareDownload, reinterpret_cast<intptr_t>(this));
+}
+
+CHIP_ERROR DeltaImageProcessor::Finalize()
+{
+    return PlatformMgr().ScheduleWork(HandleFinalize, reinterpret_cast<intptr_t>(this));
+}
+
+CHIP_ERROR DeltaImageProcessor::Apply()
+{
+    return PlatformMgr().ScheduleWork(HandleApply, reinterpret_cast<intptr_t>(this));
+}
+
+CHIP_ERROR DeltaImageProcessor::Abort()
+{
+    return PlatformMgr().ScheduleWork(HandleAbort, reinterpret_cast<intptr_t>(this));
+}
+
+CHIP_ERROR DeltaImageProcessor::ProcessBlock(ByteSpan &block)
+{
+    if (block.data() == nullptr || block.empty()) {
+        return CHIP_ERROR_INVALID_ARGUMENT;
+    }
+    if (block.size() > sizeof(s_block)) {
+        return CHIP_ERROR_BUFFER_TOO_SMALL;
+    }
+    // the downloader reuses its buffer once this returns
+    memcpy(s_block, block.data(), block.size());
+    s_block_len = block.size();
+    return PlatformMgr().ScheduleWork(HandleProcessBlock, reinterpret_cast<intptr_t>(this));
+}
+
+bool DeltaImageProcessor::IsFirstImageRun()
+{
+    OTARequestorInterface *requestor = GetRequestorInstance();
+    return requestor != nullptr &&
+           requestor->GetCurrentUpdateState() == OTARequestorInterface::OTAUpdateStateEnum::kApplying;
+}
+
+CHIP_ERROR DeltaImageProcessor::ConfirmCurrentImage()
+{
+    OTARequestorInterface *requestor = GetRequestorInstance();
+    if (requestor == nullptr) {
+        return CHIP_ERROR_INTERNAL;
+    }
+    uint32_t version;
+    ReturnErrorOnFailure(ConfigurationMgr().GetSoftwareVersion(version));
+    return version == requestor->GetTargetVersion() ? CHIP_NO_ERROR : CHIP_ERROR_INCORRECT_STATE;
+}
+
+void DeltaImageProcessor::HandlePrepareDownload(intptr_t context)
+{
+    DeltaImageProcessor *processor = reinterpret_cast<DeltaImageProcessor *>(context);
+    if (processor->m_downloader == nullptr) {
+        ESP_LOGE(TAG, "No downloader");
+        return;
+    }
+    s_running_part = esp_ota_get_running_partition();
+    s_update_part = esp_ota_get_next_update_partition(NULL);
+    if (s_update_part == NULL) {
+        processor->m_downloader->OnPreparedForDownload(CHIP_ERROR_NOT_FOUND);
+        return;
+    }
+    esp_err_t err = esp_ota_begin(s_update_part, OTA_WITH_SEQUENTIAL_WRITES, &s_ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        processor->m_downloader->OnPreparedForDownload(CHIP_ERROR_INTERNAL);
+        return;
+    }
+    s_header_parser.Init();
+    s_kind = PAYLOAD_UNKNOWN;
+    s_magic_len = 0;
+    s_active = true;
+    processor->mParams.downloadedBytes = 0;
+    processor->m_downloader->OnPreparedForDownload(CHIP_NO_ERROR);
+    post_state(kOtaDownloadInProgress);
+}
+
+void DeltaImageProcessor::HandleProcessBlock(intptr_t context)
+{
+    DeltaImageProcessor *processor = reinterpret_cast<DeltaImageProcessor *>(context);
+    if (processor->m_downloader == nullptr) {
+        return;
+    }
+    ByteSpan block(s_block, s_block_len);
+    if (s_header_parser.IsInitialized()) {
+        OTAImageHeader header;
+        CHIP_ERROR error = s_header_parser.AccumulateAndDecode(block, header);
+        if (error == CHIP_ERROR_BUFFER_TOO_SMALL) {
+            processor->m_downloader->FetchNextData();
+            return;
+        }
+        if (error != CHIP_NO_ERROR) {
+            ESP_LOGE(TAG, "Bad OTA image header: %" CHIP_ERROR_FORMAT, error.Format());
+            processor->m_downloader->EndDownload(error);
+            post_state(kOtaDownloadFailed);
+            return;
+        }
+        processor->mParams.totalFileBytes = header.mPayloadSize;
+        s_header_parser.Clear();
+    }
+    processor->mParams.downloadedBytes += block.size();
+    s_block_pos = (size_t)(block.data() - s_block);
+    HandleBlockRest(context);
+}
+
+/*
+  The patch's base is the whole running image, up to 1.9 MB to read and
+  CRC. The check runs OTA_DELTA_CHECK_READS reads (4 KB) per turn of the
+  event loop, and the next block is fetched only once it is done; BDX is
+  receiver driven, so the sender just waits.
+*/
+void DeltaImageProcessor::HandleBlockRest(intptr_t context)
+{
+    DeltaImageProcessor *processor = reinterpret_cast<DeltaImageProcessor *>(context);
+    if (processor->m_downloader == nullptr || !s_active) {
+        return;
+    }
+    for (;;) {
+        if (s_kind == PAYLOAD_DELTA && ota_delta_check_pending(&s_delta)) {
+            esp_err_t err = ota_delta_check_step(&s_delta, OTA_DELTA_CHECK_READS);
+            if (err == ESP_ERR_NOT_FINISHED) {
+                if (PlatformMgr().ScheduleWork(HandleBlockRest, context) != CHIP_NO_ERROR) {
+                    download_failed(processor->m_downloader, ESP_ERR_NO_MEM);
+                }
+                return;
+            }
+            if (err != ESP_OK) {
+                download_failed(processor->m_downloader, err);
+                return;
+            }
+        }
+        if (s_block_pos >= s_block_len) {
+            break;
+        }
+        size_t used;
+        esp_err_t err = write_payload(&s_block[s_block_pos], s_block_len - s_block_pos, &used);
+        if (err != ESP_OK) {
+            download_failed(processor->m_downloader, err);
+            return;
+        }
+        s_block_pos += used;
+    }
+    processor->m_downloader->FetchNextData();
+}
+
+void DeltaImageProcessor::HandleFinalize(intptr_t context)
+{
+    s_active = false;
+    esp_err_t err = s_kind == PAYLOAD_DELTA ? ota_delta_finish(&s_delta) : ESP_OK;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Patch incomplete or rebuilt image corrupt: %s", esp_err_to_name(err));
+        esp_ota_abort(s_ota_handle);
+        post_state(kOtaDownloadFailed);
+        return;
+    }
+    // checks the image the way the bootloader will
+    err = esp_ota_end(s_ota_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_end failed: %s", esp_err_to_name(err));
+        post_state(kOtaDownloadFailed);
+        return;
+    }
+    if (s_kind == PAYLOAD_DELTA) {
+        ESP_LOGI(TAG, "Image of %" PRIu32 " bytes rebuilt from a %llu byte patch", ota_delta_written(&s_delta),
+                 (unsigned long long)reinterpret_cast<DeltaImageProcessor *>(context)->mParams.downloadedBytes);
+    }
+    post_state(kOtaDownloadComplete);
+}
+
+void DeltaImageProcessor::HandleAbort(intptr_t context)
+{
+    s_active = false;
+    esp_ota_abort(s_ota_handle);
+    post_state(kOtaDownloadAborted);
+}
+
+void DeltaImageProcessor::HandleApply(intptr_t context)
+{
+    post_state(kOtaApplyInProgress);
+    esp_err_t err = esp_ota_set_boot_partition(s_update_part);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed: %s", esp_err_to_name(err));
+        post_state(kOtaApplyFailed);
+        return;
+    }
+    post_state(kOtaApplyComplete);
+    // time for the apply events to be handled, e.g. the sample history to be flushed
+    SystemLayer().StartTimer(System::Clock::Seconds32(2), [](System::Layer *, void *) { esp_restart(); }, nullptr);
+}
+
+esp_err_t ota_delta_requestor_init(void)
+{
+    // esp_matter builds the requestor and the BDX downloader around these when it starts
+    static esp_matter_ota_requestor_impl_t impl = {
+        .driver = &s_driver,
+        .image_processor = &s_processor,
+    };
+    esp_matter_ota_config_t config = {};
+    config.impl = &impl;
+    return esp_matter_ota_requestor_set_config(config);
+}
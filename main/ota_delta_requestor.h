@@ -0,0 +1,25 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  OTA image processor that takes delta patches (ota_delta.h) as well as
+  full images.
+
+  The payload after the Matter OTA header decides: a patch is applied
+  against the running slot as its blocks arrive and the rebuilt image is
+  written to the update slot; anything else is written as it is, so a
+  provider with full images still works. Blocks are copied into a static
+  buffer, nothing is allocated per block.
+*/
+
+#pragma once
+
+#include <esp_err.h>
+
+// Before esp_matter::start(): hand the OTA requestor this image processor
+esp_err_t ota_delta_requestor_init(void);
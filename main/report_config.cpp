@@ -0,0 +1,79 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <nvs.h>
+
+#include <report_config.h>
+
+static const char *TAG = "report_config";
+
+#define REPORT_NVS_NAMESPACE "report"
+
+static const char *const s_keys[SENSOR_ATTR_COUNT] = {
+    [SENSOR_ATTR_TEMPERATURE] = "temperature",
+    [SENSOR_ATTR_HUMIDITY] = "humidity",
+    [SENSOR_ATTR_CO2] = "co2",
+    [SENSOR_ATTR_AIR_QUALITY] = "air_quality",
+    [SENSOR_ATTR_CO2_PEAK] = "co2_peak",
+    [SENSOR_ATTR_CO2_AVERAGE] = "co2_average",
+};
+
+esp_err_t report_config_load(sensor_report_policy_t policy[SENSOR_ATTR_COUNT])
+{
+    sensor_report_policy_default(policy);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(REPORT_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // nothing stored yet
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed, err:%d", err);
+        return err;
+    }
+
+    for (int attr = 0; attr < SENSOR_ATTR_COUNT; attr++) {
+        sensor_report_policy_t stored;
+        size_t len = sizeof(stored);
+        err = nvs_get_blob(handle, s_keys[attr], &stored, &len);
+        if (err == ESP_OK && len == sizeof(stored)) {
+            policy[attr] = stored;
+            ESP_LOGI(TAG, "%s: deadband %lu, interval %lu..%lu s", s_keys[attr], (unsigned long)stored.deadband,
+                     (unsigned long)stored.min_interval_s, (unsigned long)stored.max_interval_s);
+        }
+    }
+    nvs_close(handle);
+    return ESP_OK;
+}
+
+esp_err_t report_config_save(sensor_attr_t attr, const sensor_report_policy_t *policy)
+{
+    if (attr >= SENSOR_ATTR_COUNT || policy == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(REPORT_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed, err:%d", err);
+        return err;
+    }
+    err = nvs_set_blob(handle, s_keys[attr], policy, sizeof(*policy));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+const char *report_config_key(sensor_attr_t attr)
+{
+    return attr < SENSOR_ATTR_COUNT ? s_keys[attr] : "?";
+}
@@ -0,0 +1,22 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <esp_err.h>
+
+#include <sensor_commit.h>
+
+// Kconfig defaults overridden by whatever is stored in NVS namespace "report".
+// Each attribute is a sensor_report_policy_t blob under its own key.
+esp_err_t report_config_load(sensor_report_policy_t policy[SENSOR_ATTR_COUNT]);
+
+esp_err_t report_config_save(sensor_attr_t attr, const sensor_report_policy_t *policy);
+
+// NVS key of attr, also its name on the console
+const char *report_config_key(sensor_attr_t attr);
@@ -0,0 +1,107 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sdkconfig.h>
+
+#include <sensor_adapt.h>
+
+#define ADAPT_FRAC_BITS     8
+// level gain 1/2, trend gain 1/8: settles in a few samples, follows a ramp without lag
+#define ADAPT_ALPHA_SHIFT   1
+#define ADAPT_BETA_SHIFT    3
+#define MS_PER_MINUTE       60000
+
+void sensor_adapt_config_default(sensor_adapt_config_t *config)
+{
+    config->min_ms = CONFIG_SENSOR_SAMPLE_INTERVAL_SEC * 1000;
+    config->max_ms = config->min_ms;
+    config->tolerance_ppm = CONFIG_SENSOR_ADAPTIVE_TOLERANCE_PPM;
+}
+
+static uint32_t clamp(const sensor_adapt_config_t *config, uint32_t interval_ms)
+{
+    if (interval_ms > config->max_ms) {
+        interval_ms = config->max_ms;
+    }
+    return interval_ms < config->min_ms ? config->min_ms : interval_ms;
+}
+
+void sensor_adapt_set_range(sensor_adapt_t *adapt, uint32_t min_ms, uint32_t max_ms)
+{
+    adapt->config.min_ms = min_ms;
+    adapt->config.max_ms = max_ms > min_ms ? max_ms : min_ms;
+    adapt->interval_ms = clamp(&adapt->config, adapt->interval_ms);
+}
+
+void sensor_adapt_init(sensor_adapt_t *adapt, const sensor_adapt_config_t *config)
+{
+    memset(adapt, 0, sizeof(*adapt));
+    adapt->config = *config;
+    sensor_adapt_set_range(adapt, config->min_ms, config->max_ms);
+    adapt->interval_ms = config->min_ms;
+}
+
+uint32_t sensor_adapt_update(sensor_adapt_t *adapt, uint16_t co2_ppm, int64_t now_us)
+{
+    const sensor_adapt_config_t *config = &adapt->config;
+    int32_t z = (int32_t)co2_ppm << ADAPT_FRAC_BITS;
+    if (adapt->samples == 0) {
+        adapt->level = z;
+        adapt->trend = 0;
+        adapt->last_us = now_us;
+        adapt->samples = 1;
+        adapt->interval_ms = config->min_ms;
+        return adapt->interval_ms;
+    }
+
+    int64_t dt_ms = (now_us - adapt->last_us) / 1000;
+    if (dt_ms <= 0) {
+        // two samples within the same millisecond, nothing to learn
+        return adapt->interval_ms;
+    }
+    adapt->last_us = now_us;
+
+    int32_t predicted = adapt->level + (int32_t)((int64_t)adapt->trend * dt_ms / MS_PER_MINUTE);
+    int32_t error = z - predicted;
+    adapt->level = predicted + (error >> ADAPT_ALPHA_SHIFT);
+    adapt->trend += (int32_t)(((int64_t)error * MS_PER_MINUTE / dt_ms) >> ADAPT_BETA_SHIFT);
+    if (adapt->samples < UINT8_MAX) {
+        adapt->samples++;
+    }
+
+    int32_t tolerance = (int32_t)config->tolerance_ppm << ADAPT_FRAC_BITS;
+    // twice the tolerance, so sensor noise (about 5 ppm) alone does not count
+    if (abs(error) > 2 * tolerance) {
+        adapt->surprises++;
+        adapt->interval_ms = config->min_ms;
+        return adapt->interval_ms;
+    }
+    if (adapt->samples < 3) {
+        adapt->interval_ms = config->min_ms;
+        return adapt->interval_ms;
+    }
+
+    // time for the trend to cover the tolerance, growing at most 2x per sample
+    uint32_t target_ms = UINT32_MAX;
+    if (adapt->trend != 0) {
+        int64_t ms = (int64_t)tolerance * MS_PER_MINUTE / abs(adapt->trend);
+        target_ms = ms < UINT32_MAX ? (uint32_t)ms : UINT32_MAX;
+    }
+    uint32_t grow_ms = adapt->interval_ms <= UINT32_MAX / 2 ? adapt->interval_ms * 2 : UINT32_MAX;
+    adapt->interval_ms = clamp(config, target_ms < grow_ms ? target_ms : grow_ms);
+    return adapt->interval_ms;
+}
+
+uint32_t sensor_adapt_snap(sensor_adapt_t *adapt)
+{
+    adapt->interval_ms = adapt->config.min_ms;
+    return adapt->interval_ms;
+}
@@ -0,0 +1,57 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sample interval from how fast CO2 moves.
+
+  An alpha-beta filter (the steady state of a Kalman filter on CO2 level
+  and trend) predicts each sample from the previous ones. The next
+  interval is the time the trend needs to move CO2 by the tolerance, at
+  most twice the current interval, so a flat room slowly backs off. A
+  sample more than twice the tolerance from its prediction, somebody
+  walking in, snaps straight back to the shortest interval. Integer only.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    // interval range, min_ms also while the filter settles
+    uint32_t min_ms;
+    uint32_t max_ms;
+    // ppm allowed to drift between samples; twice this off the prediction is a surprise
+    uint16_t tolerance_ppm;
+} sensor_adapt_config_t;
+
+typedef struct {
+    sensor_adapt_config_t config;
+    // ppm with 8 fractional bits, and its trend in the same unit per minute
+    int32_t level;
+    int32_t trend;
+    int64_t last_us;
+    uint32_t interval_ms;
+    // samples seen, the trend is trusted from the third on
+    uint8_t samples;
+    // predictions more than twice the tolerance off
+    uint32_t surprises;
+} sensor_adapt_t;
+
+// Kconfig defaults (CONFIG_SENSOR_ADAPTIVE_*), min_ms and max_ms both the sample interval
+void sensor_adapt_config_default(sensor_adapt_config_t *config);
+
+void sensor_adapt_init(sensor_adapt_t *adapt, const sensor_adapt_config_t *config);
+
+// Change the interval range, e.g. when the demand changes; the current interval is clamped into it
+void sensor_adapt_set_range(sensor_adapt_t *adapt, uint32_t min_ms, uint32_t max_ms);
+
+// Feed the CO2 of a sample taken at now_us, returns the interval until the next one
+uint32_t sensor_adapt_update(sensor_adapt_t *adapt, uint16_t co2_ppm, int64_t now_us);
+
+// Back to the shortest interval, as after a surprise, e.g. when a sample needs confirming; returns it
+uint32_t sensor_adapt_snap(sensor_adapt_t *adapt);
@@ -0,0 +1,98 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <sdkconfig.h>
+
+#include <sensor_alarm.h>
+
+void sensor_alarm_config_default(sensor_alarm_config_t *config)
+{
+    config->levels[0].rise_ppm = CONFIG_SENSOR_CO2_ALARM_VENTILATE_PPM;
+    config->levels[0].fall_ppm = CONFIG_SENSOR_CO2_ALARM_VENTILATE_PPM - CONFIG_SENSOR_CO2_ALARM_HYSTERESIS_PPM;
+    config->levels[1].rise_ppm = CONFIG_SENSOR_CO2_ALARM_HIGH_PPM;
+    config->levels[1].fall_ppm = CONFIG_SENSOR_CO2_ALARM_HIGH_PPM - CONFIG_SENSOR_CO2_ALARM_HYSTERESIS_PPM;
+    config->debounce = CONFIG_SENSOR_CO2_ALARM_DEBOUNCE;
+}
+
+bool sensor_alarm_config_valid(const sensor_alarm_config_t *config)
+{
+    if (config->debounce == 0) {
+        return false;
+    }
+    uint16_t below = 0;
+    for (const sensor_alarm_threshold_t &level : config->levels) {
+        if (level.rise_ppm == 0) {
+            break;
+        }
+        if (level.fall_ppm >= level.rise_ppm || level.rise_ppm <= below) {
+            return false;
+        }
+        below = level.rise_ppm;
+    }
+    return true;
+}
+
+void sensor_alarm_init(sensor_alarm_t *alarm, const sensor_alarm_config_t *config)
+{
+    memset(alarm, 0, sizeof(*alarm));
+    alarm->config = *config;
+}
+
+void sensor_alarm_set_config(sensor_alarm_t *alarm, const sensor_alarm_config_t *config)
+{
+    alarm->config = *config;
+    alarm->pending = alarm->level;
+    alarm->pending_count = 0;
+}
+
+// Level CO2 points to coming from the current one: up while it reaches rise, down while it is below fall
+static uint8_t target_level(const sensor_alarm_t *alarm, uint16_t co2_ppm)
+{
+    const sensor_alarm_threshold_t *levels = alarm->config.levels;
+    uint8_t level = alarm->level;
+    while (level < SENSOR_ALARM_LEVELS && levels[level].rise_ppm != 0 && co2_ppm >= levels[level].rise_ppm) {
+        level++;
+    }
+    if (level != alarm->level) {
+        return level;
+    }
+    // a level switched off by new thresholds is left at once
+    while (level > 0 && (levels[level - 1].rise_ppm == 0 || co2_ppm < levels[level - 1].fall_ppm)) {
+        level--;
+    }
+    return level;
+}
+
+sensor_alarm_result_t sensor_alarm_update(sensor_alarm_t *alarm, uint16_t co2_ppm)
+{
+    uint8_t target = target_level(alarm, co2_ppm);
+    if (target == alarm->level) {
+        alarm->pending = alarm->level;
+        alarm->pending_count = 0;
+        return SENSOR_ALARM_STEADY;
+    }
+    if (target != alarm->pending) {
+        alarm->pending = target;
+        alarm->pending_count = 0;
+    }
+    if (++alarm->pending_count < alarm->config.debounce) {
+        return SENSOR_ALARM_PENDING;
+    }
+    alarm->level = target;
+    alarm->pending_count = 0;
+    alarm->changes++;
+    return SENSOR_ALARM_CHANGED;
+}
+
+const char *sensor_alarm_level_name(uint8_t level)
+{
+    static const char *const names[SENSOR_ALARM_LEVELS + 1] = { "normal", "ventilate", "high" };
+    return level <= SENSOR_ALARM_LEVELS ? names[level] : "?";
+}
@@ -0,0 +1,72 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  CO2 alarm levels from the filtered CO2.
+
+  Level n is entered once CO2 reaches its rise threshold and left once CO2
+  drops below its fall threshold, so a value between the two keeps
+  whatever level it had. A new level only counts after debounce
+  consecutive samples agreed on it; the first of them reports a pending
+  change, so the caller can bring the next sample closer. Runs on the
+  matter thread only.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// levels above normal: 1 ventilate, 2 high
+#define SENSOR_ALARM_LEVELS 2
+
+typedef struct {
+    // ppm, fall_ppm below rise_ppm; a level with rise_ppm 0 is off, and so are the ones above it
+    uint16_t rise_ppm;
+    uint16_t fall_ppm;
+} sensor_alarm_threshold_t;
+
+typedef struct {
+    sensor_alarm_threshold_t levels[SENSOR_ALARM_LEVELS];
+    // samples in a row that must agree before the level changes, at least 1
+    uint8_t debounce;
+} sensor_alarm_config_t;
+
+typedef struct {
+    sensor_alarm_config_t config;
+    // 0 normal, 1..SENSOR_ALARM_LEVELS
+    uint8_t level;
+    // level the last samples point to and how many agreed so far
+    uint8_t pending;
+    uint8_t pending_count;
+    // level changes since init
+    uint32_t changes;
+} sensor_alarm_t;
+
+typedef enum {
+    SENSOR_ALARM_STEADY,
+    // a sample points to another level, not confirmed yet
+    SENSOR_ALARM_PENDING,
+    // the level changed with this sample
+    SENSOR_ALARM_CHANGED,
+} sensor_alarm_result_t;
+
+// Kconfig defaults (CONFIG_SENSOR_CO2_ALARM_*)
+void sensor_alarm_config_default(sensor_alarm_config_t *config);
+
+// Thresholds usable as they are: fall below rise, rising with the level
+bool sensor_alarm_config_valid(const sensor_alarm_config_t *config);
+
+void sensor_alarm_init(sensor_alarm_t *alarm, const sensor_alarm_config_t *config);
+
+// New thresholds, the level is kept and the next sample decides
+void sensor_alarm_set_config(sensor_alarm_t *alarm, const sensor_alarm_config_t *config);
+
+// Feed the filtered CO2 of a sample
+sensor_alarm_result_t sensor_alarm_update(sensor_alarm_t *alarm, uint16_t co2_ppm);
+
+const char *sensor_alarm_level_name(uint8_t level);
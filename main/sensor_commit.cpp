@@ -0,0 +1,138 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <sensor_commit.h>
+
+void sensor_report_policy_default(sensor_report_policy_t policy[SENSOR_ATTR_COUNT])
+{
+    policy[SENSOR_ATTR_TEMPERATURE] = {
+        .deadband = CONFIG_SENSOR_REPORT_TEMPERATURE_DEADBAND,
+        .min_interval_s = CONFIG_SENSOR_REPORT_TEMPERATURE_MIN_INTERVAL_SEC,
+        .max_interval_s = CONFIG_SENSOR_REPORT_TEMPERATURE_MAX_INTERVAL_SEC,
+    };
+    policy[SENSOR_ATTR_HUMIDITY] = {
+        .deadband = CONFIG_SENSOR_REPORT_HUMIDITY_DEADBAND,
+        .min_interval_s = CONFIG_SENSOR_REPORT_HUMIDITY_MIN_INTERVAL_SEC,
+        .max_interval_s = CONFIG_SENSOR_REPORT_HUMIDITY_MAX_INTERVAL_SEC,
+    };
+    policy[SENSOR_ATTR_CO2] = {
+        .deadband = CONFIG_SENSOR_REPORT_CO2_DEADBAND,
+        .min_interval_s = CONFIG_SENSOR_REPORT_CO2_MIN_INTERVAL_SEC,
+        .max_interval_s = CONFIG_SENSOR_REPORT_CO2_MAX_INTERVAL_SEC,
+    };
+    // every class change of the enum is worth a report
+    policy[SENSOR_ATTR_AIR_QUALITY] = {
+        .deadband = 0,
+        .min_interval_s = CONFIG_SENSOR_REPORT_AIR_QUALITY_MIN_INTERVAL_SEC,
+        .max_interval_s = CONFIG_SENSOR_REPORT_AIR_QUALITY_MAX_INTERVAL_SEC,
+    };
+    // the window aggregates follow the CO2 policy
+    policy[SENSOR_ATTR_CO2_PEAK] = policy[SENSOR_ATTR_CO2];
+    policy[SENSOR_ATTR_CO2_AVERAGE] = policy[SENSOR_ATTR_CO2];
+}
+
+void sensor_commit_init(sensor_commit_t *commit, const sensor_report_policy_t policy[SENSOR_ATTR_COUNT])
+{
+    memset(commit, 0, sizeof(*commit));
+    memcpy(commit->policy, policy, sizeof(commit->policy));
+}
+
+static int32_t attr_value(const sensor_measurement_t *measurement, int attr)
+{
+    switch (attr) {
+    case SENSOR_ATTR_TEMPERATURE:   return measurement->temperature;
+    case SENSOR_ATTR_HUMIDITY:      return measurement->humidity;
+    case SENSOR_ATTR_CO2:           return measurement->co2;
+    case SENSOR_ATTR_AIR_QUALITY:   return measurement->air_quality;
+    case SENSOR_ATTR_CO2_PEAK:      return measurement->co2_peak;
+    case SENSOR_ATTR_CO2_AVERAGE:   return measurement->co2_average;
+    default:                        return 0;
+    }
+}
+
+uint32_t sensor_commit_changes(const sensor_commit_t *commit, const sensor_measurement_t *measurement,
+                               int64_t now_us, uint32_t *heartbeat)
+{
+    uint32_t due = 0;
+    *heartbeat = 0;
+
+    for (int attr = 0; attr < SENSOR_ATTR_COUNT; attr++) {
+        uint32_t bit = SENSOR_ATTR_BIT(attr);
+        // a retained sample comes without a window, peak and average wait for a fresh one
+        if (measurement->retained && (attr == SENSOR_ATTR_CO2_PEAK || attr == SENSOR_ATTR_CO2_AVERAGE)) {
+            continue;
+        }
+        if (!(commit->committed_mask & bit)) {
+            due |= bit;
+            continue;
+        }
+
+        const sensor_report_policy_t *policy = &commit->policy[attr];
+        int64_t since_us = now_us - commit->last_write_us[attr];
+        if (policy->max_interval_s && since_us >= (int64_t)policy->max_interval_s * 1000000) {
+            due |= bit;
+            *heartbeat |= bit;
+            continue;
+        }
+        if (since_us < (int64_t)policy->min_interval_s * 1000000) {
+            continue;
+        }
+
+        uint32_t delta = (uint32_t)abs(attr_value(measurement, attr) - attr_value(&commit->committed, attr));
+        if (delta > 0 && delta >= policy->deadband) {
+            due |= bit;
+        }
+    }
+    return due;
+}
+
+uint32_t sensor_commit_apply(sensor_commit_t *commit, const sensor_measurement_t *measurement,
+                             sensor_attr_write_cb_t write, void *ctx)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint32_t heartbeat;
+    uint32_t due = sensor_commit_changes(commit, measurement, now_us, &heartbeat);
+    if (due == 0) {
+        return 0;
+    }
+
+    for (int attr = 0; attr < SENSOR_ATTR_COUNT; attr++) {
+        if (due & SENSOR_ATTR_BIT(attr)) {
+            write((sensor_attr_t)attr, measurement, heartbeat & SENSOR_ATTR_BIT(attr), ctx);
+            commit->last_write_us[attr] = now_us;
+        }
+    }
+
+    sensor_measurement_t *last = &commit->committed;
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_TEMPERATURE)) {
+        last->temperature = measurement->temperature;
+    }
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_HUMIDITY)) {
+        last->humidity = measurement->humidity;
+    }
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_CO2)) {
+        last->co2 = measurement->co2;
+    }
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_AIR_QUALITY)) {
+        last->air_quality = measurement->air_quality;
+    }
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_CO2_PEAK)) {
+        last->co2_peak = measurement->co2_peak;
+    }
+    if (due & SENSOR_ATTR_BIT(SENSOR_ATTR_CO2_AVERAGE)) {
+        last->co2_average = measurement->co2_average;
+    }
+    commit->committed_mask |= due;
+    return due;
+}
@@ -0,0 +1,77 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Change-aware commit of one sample to the measured attributes.
+
+  The whole sample crosses to the Matter thread once and only attributes
+  whose Matter value moved far enough from the last committed one are
+  written, so sensor noise neither dirties a path nor produces a report.
+  Each attribute has its own report policy:
+
+  - deadband: a value is written once it differs from the last written
+    value by at least this much (0 writes on any change)
+  - min_interval_s: nothing is written sooner than this after the
+    previous write
+  - max_interval_s: after this long the current value is written, and
+    reported even if unchanged, as a heartbeat (0 disables)
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <scd4x_sensor.h>
+
+typedef enum {
+    SENSOR_ATTR_TEMPERATURE,
+    SENSOR_ATTR_HUMIDITY,
+    SENSOR_ATTR_CO2,
+    SENSOR_ATTR_AIR_QUALITY,
+    SENSOR_ATTR_CO2_PEAK,
+    SENSOR_ATTR_CO2_AVERAGE,
+    SENSOR_ATTR_COUNT,
+} sensor_attr_t;
+
+#define SENSOR_ATTR_BIT(attr) (1u << (attr))
+
+typedef struct {
+    // in the Matter unit of the attribute: 0.01 °C, 0.01 %, ppm, enum step
+    uint32_t deadband;
+    uint32_t min_interval_s;
+    uint32_t max_interval_s;
+} sensor_report_policy_t;
+
+// Write one attribute of the measurement to the data model. force_report is
+// set for heartbeats, where the value may equal what is already stored.
+using sensor_attr_write_cb_t = void (*)(sensor_attr_t attr, const sensor_measurement_t *measurement,
+                                        bool force_report, void *ctx);
+
+typedef struct {
+    // values as last written to the data model
+    sensor_measurement_t committed;
+    // SENSOR_ATTR_BIT of every attribute written at least once
+    uint32_t committed_mask;
+    int64_t last_write_us[SENSOR_ATTR_COUNT];
+    sensor_report_policy_t policy[SENSOR_ATTR_COUNT];
+} sensor_commit_t;
+
+// Report policies from Kconfig (CONFIG_SENSOR_REPORT_*)
+void sensor_report_policy_default(sensor_report_policy_t policy[SENSOR_ATTR_COUNT]);
+
+void sensor_commit_init(sensor_commit_t *commit, const sensor_report_policy_t policy[SENSOR_ATTR_COUNT]);
+
+// Attributes of measurement that are due to be written at now_us. Attributes
+// written only because max_interval_s elapsed are also set in *heartbeat.
+uint32_t sensor_commit_changes(const sensor_commit_t *commit, const sensor_measurement_t *measurement,
+                               int64_t now_us, uint32_t *heartbeat);
+
+// Write the due attributes and remember them as committed. Must run on the
+// thread that owns the data model. Returns the mask of written attributes.
+uint32_t sensor_commit_apply(sensor_commit_t *commit, const sensor_measurement_t *measurement,
+                             sensor_attr_write_cb_t write, void *ctx);
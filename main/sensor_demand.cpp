@@ -0,0 +1,106 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <sensor_demand.h>
+
+void sensor_demand_init(sensor_demand_t *demand, size_t count, const uint32_t base_ms[], uint32_t maintenance_ms)
+{
+    memset(demand, 0, sizeof(*demand));
+    demand->count = count;
+    for (size_t i = 0; i < count; i++) {
+        demand->base_ms[i] = base_ms[i];
+    }
+    demand->maintenance_ms = maintenance_ms;
+}
+
+static sensor_demand_subscription_t *find(sensor_demand_t *demand, const void *key)
+{
+    for (auto &subscription : demand->subscriptions) {
+        if (subscription.key == key) {
+            return &subscription;
+        }
+    }
+    return NULL;
+}
+
+void sensor_demand_subscribe(sensor_demand_t *demand, const void *key, uint32_t sensor_mask, uint32_t max_interval_ms)
+{
+    if (key == NULL) {
+        return;
+    }
+    if (sensor_mask == 0) {
+        sensor_demand_unsubscribe(demand, key, 0);
+        return;
+    }
+    sensor_demand_subscription_t *subscription = find(demand, key);
+    if (subscription == NULL) {
+        subscription = find(demand, NULL);
+    }
+    if (subscription == NULL) {
+        // no room: serve it at full rate rather than too slowly
+        for (size_t i = 0; i < SCD4X_SENSOR_MAX; i++) {
+            if ((sensor_mask & (1u << i)) && demand->overflow[i] < UINT8_MAX) {
+                demand->overflow[i]++;
+            }
+        }
+        return;
+    }
+    subscription->key = key;
+    subscription->sensor_mask = sensor_mask;
+    subscription->max_interval_ms = max_interval_ms;
+}
+
+void sensor_demand_unsubscribe(sensor_demand_t *demand, const void *key, uint32_t sensor_mask)
+{
+    sensor_demand_subscription_t *subscription = key ? find(demand, key) : NULL;
+    if (subscription) {
+        memset(subscription, 0, sizeof(*subscription));
+        return;
+    }
+    // not tracked, so it either did not fit or never covered a sensor
+    for (size_t i = 0; i < SCD4X_SENSOR_MAX; i++) {
+        if ((sensor_mask & (1u << i)) && demand->overflow[i]) {
+            demand->overflow[i]--;
+        }
+    }
+}
+
+uint32_t sensor_demand_interval_ms(const sensor_demand_t *demand, size_t sensor)
+{
+    uint32_t base_ms = demand->base_ms[sensor];
+    if (demand->overflow[sensor]) {
+        return base_ms;
+    }
+    uint32_t interval_ms = demand->maintenance_ms;
+    for (const auto &subscription : demand->subscriptions) {
+        if ((subscription.sensor_mask & (1u << sensor)) && subscription.max_interval_ms < interval_ms) {
+            interval_ms = subscription.max_interval_ms;
+        }
+    }
+    return interval_ms > base_ms ? interval_ms : base_ms;
+}
+
+bool sensor_demand_subscribed(const sensor_demand_t *demand, size_t sensor)
+{
+    if (demand->overflow[sensor]) {
+        return true;
+    }
+    for (const auto &subscription : demand->subscriptions) {
+        if (subscription.sensor_mask & (1u << sensor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sensor_demand_on_read(const sensor_demand_t *demand, size_t sensor, int64_t sample_age_us)
+{
+    return !sensor_demand_subscribed(demand, sensor) && sample_age_us >= (int64_t)demand->base_ms[sensor] * 1000;
+}
@@ -0,0 +1,64 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sampling rate from the subscriptions on the sensor endpoints.
+
+  Each subscription that covers a sensor's measured attributes asks for a
+  sample at least every max interval. A sensor samples at the tightest of
+  those, never faster than its configured interval and never slower than
+  the maintenance interval, which is also the rate with no subscriber at
+  all. Runs on the matter thread only.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <scd4x_sensor.h>
+
+// subscriptions tracked at once, later ones count as asking for the configured interval
+#define SENSOR_DEMAND_MAX_SUBSCRIPTIONS 16
+
+typedef struct {
+    // identifies the subscription (the ReadHandler), NULL for a free entry
+    const void *key;
+    // bit i: covers sensor i
+    uint32_t sensor_mask;
+    uint32_t max_interval_ms;
+} sensor_demand_subscription_t;
+
+typedef struct {
+    size_t count;
+    // fastest rate per sensor: its configured interval
+    uint32_t base_ms[SCD4X_SENSOR_MAX];
+    uint32_t maintenance_ms;
+    sensor_demand_subscription_t subscriptions[SENSOR_DEMAND_MAX_SUBSCRIPTIONS];
+    // per sensor, subscriptions covering it that did not fit: they pin it to its base interval until they end
+    uint8_t overflow[SCD4X_SENSOR_MAX];
+} sensor_demand_t;
+
+void sensor_demand_init(sensor_demand_t *demand, size_t count, const uint32_t base_ms[], uint32_t maintenance_ms);
+
+// Add or update a subscription, sensor_mask 0 removes it
+void sensor_demand_subscribe(sensor_demand_t *demand, const void *key, uint32_t sensor_mask, uint32_t max_interval_ms);
+
+// sensor_mask as the subscription was added with, it releases one that did not fit
+void sensor_demand_unsubscribe(sensor_demand_t *demand, const void *key, uint32_t sensor_mask);
+
+// Sample interval the sensor should run at now
+uint32_t sensor_demand_interval_ms(const sensor_demand_t *demand, size_t sensor);
+
+// Any subscription covers the sensor
+bool sensor_demand_subscribed(const sensor_demand_t *demand, size_t sensor);
+
+// A plain read of the sensor's attributes arrived and its last sample is
+// sample_age_us old: worth a fresh sample when no subscription keeps the
+// sensor sampling and the last one is older than the configured interval
+bool sensor_demand_on_read(const sensor_demand_t *demand, size_t sensor, int64_t sample_age_us);
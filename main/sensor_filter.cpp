@@ -0,0 +1,146 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <sdkconfig.h>
+
+#include <sensor_filter.h>
+
+#define EMA_FRACTION_BITS 8
+
+// upper CO2 bound (ppm) of AIR_QUALITY_GOOD .. AIR_QUALITY_VERY_POOR, as in map_co2_to_air_quality_enum()
+static const uint16_t k_air_quality_bounds[] = { 600, 1000, 1500, 2000, 5000 };
+
+void sensor_filter_config_default(sensor_filter_config_t *config)
+{
+#if CONFIG_SENSOR_FILTER_EMA
+    config->type = SENSOR_FILTER_EMA;
+#elif CONFIG_SENSOR_FILTER_MEDIAN
+    config->type = SENSOR_FILTER_MEDIAN;
+#else
+    config->type = SENSOR_FILTER_NONE;
+#endif
+    config->ema_shift = CONFIG_SENSOR_FILTER_EMA_SHIFT;
+    config->median_window = CONFIG_SENSOR_FILTER_MEDIAN_WINDOW;
+    config->air_quality_hysteresis_pct = CONFIG_SENSOR_AIR_QUALITY_HYSTERESIS_PCT;
+    config->interval_ms = CONFIG_SENSOR_SAMPLE_INTERVAL_SEC * 1000;
+}
+
+void sensor_filter_init(sensor_filter_t *filter, const sensor_filter_config_t *config)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->config = *config;
+    if (filter->config.median_window < 3) {
+        filter->config.median_window = 3;
+    }
+    if (filter->config.median_window > SENSOR_FILTER_MEDIAN_MAX_WINDOW) {
+        filter->config.median_window = SENSOR_FILTER_MEDIAN_MAX_WINDOW;
+    }
+    // the median of an even window would sit between two samples
+    filter->config.median_window |= 1;
+    filter->air_quality = AIR_QUALITY_UNKNOWN;
+}
+
+// span: the sample stands for this many intervals, at most SENSOR_FILTER_MAX_SPAN
+static int32_t ema_step(sensor_filter_channel_t *ch, int32_t x, uint8_t shift, uint32_t span)
+{
+    int32_t scaled = x * (1 << EMA_FRACTION_BITS);
+    if (ch->count == 0) {
+        ch->ema = scaled;
+        ch->count = 1;
+    } else {
+        for (uint32_t i = 0; i < span && ch->ema != scaled; i++) {
+            ch->ema += (scaled - ch->ema) / (1 << shift);
+        }
+    }
+    // round to nearest
+    return (ch->ema + (1 << (EMA_FRACTION_BITS - 1))) >> EMA_FRACTION_BITS;
+}
+
+// Window is at most SENSOR_FILTER_MEDIAN_MAX_WINDOW, so the sorted insert is constant time
+static int32_t median_step(sensor_filter_channel_t *ch, int32_t x, uint8_t window)
+{
+    if (ch->count == window) {
+        // drop the oldest sample from the sorted copy
+        int32_t oldest = ch->ring[ch->next];
+        uint8_t i = 0;
+        while (ch->sorted[i] != oldest) {
+            i++;
+        }
+        memmove(&ch->sorted[i], &ch->sorted[i + 1], (ch->count - i - 1) * sizeof(int32_t));
+        ch->count--;
+    }
+    ch->ring[ch->next] = x;
+    ch->next = (uint8_t)((ch->next + 1) % window);
+
+    uint8_t i = ch->count;
+    while (i > 0 && ch->sorted[i - 1] > x) {
+        ch->sorted[i] = ch->sorted[i - 1];
+        i--;
+    }
+    ch->sorted[i] = x;
+    ch->count++;
+    return ch->sorted[ch->count / 2];
+}
+
+static int32_t filter_step(const sensor_filter_config_t *config, sensor_filter_channel_t *ch, int32_t x,
+                           uint32_t span)
+{
+    switch (config->type) {
+    case SENSOR_FILTER_EMA:     return ema_step(ch, x, config->ema_shift, span);
+    case SENSOR_FILTER_MEDIAN:  return median_step(ch, x, config->median_window);
+    default:                    return x;
+    }
+}
+
+air_quality_t air_quality_classify(uint16_t ppm, air_quality_t current, uint8_t hysteresis_pct)
+{
+    if (current == AIR_QUALITY_UNKNOWN) {
+        return map_co2_to_air_quality_enum(ppm);
+    }
+
+    // boundary k separates class k + 1 from class k + 2
+    int cls = current;
+    while (cls < AIR_QUALITY_EXTREMELY_POOR) {
+        uint32_t bound = k_air_quality_bounds[cls - 1];
+        if (ppm < bound + bound * hysteresis_pct / 100) {
+            break;
+        }
+        cls++;
+    }
+    while (cls > AIR_QUALITY_GOOD) {
+        uint32_t bound = k_air_quality_bounds[cls - 2];
+        if (ppm + bound * hysteresis_pct / 100 >= bound) {
+            break;
+        }
+        cls--;
+    }
+    return (air_quality_t)cls;
+}
+
+void sensor_filter_apply(sensor_filter_t *filter, sensor_measurement_t *measurement, int64_t now_us)
+{
+    const sensor_filter_config_t *config = &filter->config;
+    // intervals since the previous sample, rounded, at least one
+    uint32_t span = 1;
+    if (config->interval_ms && filter->last_us && now_us > filter->last_us) {
+        int64_t interval_us = (int64_t)config->interval_ms * 1000;
+        int64_t n = (now_us - filter->last_us + interval_us / 2) / interval_us;
+        span = n < 1 ? 1 : n > SENSOR_FILTER_MAX_SPAN ? SENSOR_FILTER_MAX_SPAN : (uint32_t)n;
+    }
+    filter->last_us = now_us;
+
+    measurement->temperature = (int16_t)filter_step(config, &filter->temperature, measurement->temperature, span);
+    measurement->humidity = (uint16_t)filter_step(config, &filter->humidity, measurement->humidity, span);
+    measurement->co2 = (uint16_t)filter_step(config, &filter->co2, measurement->co2, span);
+
+    filter->air_quality = air_quality_classify(measurement->co2, filter->air_quality,
+                                               config->air_quality_hysteresis_pct);
+    measurement->air_quality = filter->air_quality;
+}
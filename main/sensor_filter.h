@@ -0,0 +1,79 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Streaming filter between the sensor and the commit.
+
+  Temperature, humidity and CO2 each go through the same O(1) per sample
+  filter, an integer EMA or a short windowed median. AirQuality is then
+  classified from the filtered CO2 with hysteresis around every boundary:
+  the class only moves once CO2 is past the boundary by the hysteresis
+  band, so a value hovering on a boundary no longer flips the enum.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <scd4x_sensor.h>
+
+#define SENSOR_FILTER_MEDIAN_MAX_WINDOW 9
+// longest gap, in intervals, the EMA catches up on in one sample
+#define SENSOR_FILTER_MAX_SPAN 64
+
+typedef enum : uint8_t {
+    SENSOR_FILTER_NONE,
+    // y += (x - y) / 2^ema_shift
+    SENSOR_FILTER_EMA,
+    // median of the last median_window samples
+    SENSOR_FILTER_MEDIAN,
+} sensor_filter_type_t;
+
+typedef struct {
+    sensor_filter_type_t type;
+    uint8_t ema_shift;
+    // odd, 3..SENSOR_FILTER_MEDIAN_MAX_WINDOW
+    uint8_t median_window;
+    // AirQuality hysteresis around each CO2 boundary, percent of the boundary
+    uint8_t air_quality_hysteresis_pct;
+    // sample interval the EMA weight is meant for: a sample after n intervals
+    // moves the average as far as n equal samples would, so a slower or
+    // adaptive schedule keeps the same time constant instead of lagging
+    uint32_t interval_ms;
+} sensor_filter_config_t;
+
+typedef struct {
+    // EMA state with 8 fractional bits
+    int32_t ema;
+    // median: ring of the last samples and the same samples sorted
+    int32_t ring[SENSOR_FILTER_MEDIAN_MAX_WINDOW];
+    int32_t sorted[SENSOR_FILTER_MEDIAN_MAX_WINDOW];
+    uint8_t count;
+    uint8_t next;
+} sensor_filter_channel_t;
+
+typedef struct {
+    sensor_filter_config_t config;
+    sensor_filter_channel_t temperature;
+    sensor_filter_channel_t humidity;
+    sensor_filter_channel_t co2;
+    air_quality_t air_quality;
+    // esp_timer time of the previous sample
+    int64_t last_us;
+} sensor_filter_t;
+
+// Filter configuration from Kconfig (CONFIG_SENSOR_FILTER_*)
+void sensor_filter_config_default(sensor_filter_config_t *config);
+
+void sensor_filter_init(sensor_filter_t *filter, const sensor_filter_config_t *config);
+
+// Filter measurement, taken at now_us, in place and classify AirQuality from the filtered CO2
+void sensor_filter_apply(sensor_filter_t *filter, sensor_measurement_t *measurement, int64_t now_us);
+
+// AirQuality for ppm, keeping current unless ppm is past a boundary by its hysteresis band
+air_quality_t air_quality_classify(uint16_t ppm, air_quality_t current, uint8_t hysteresis_pct);
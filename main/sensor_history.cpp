@@ -0,0 +1,429 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+#include <sensor_history.h>
+
+static const char *TAG = "history";
+
+/*
+  Block layout, little endian:
+    0  magic    u16
+    2  sensor   u8
+    3  count    u8
+    4  seq      u32
+    8  boot     u16
+   10  length   u16  data bytes after the header
+   12  checksum u32  FNV-1a over bytes 0..11 and the data
+  Data are nibbles, low nibble of a byte first. A value is a varint of 3 bit
+  groups, least significant first, bit 3 set when another group follows.
+  Signed values are zigzag coded. The first sample is time, CO2, temperature,
+  humidity as they are; the others are the change of the time step, then
+  the differences of CO2, temperature and humidity.
+*/
+#define HISTORY_MAGIC           0x4843
+#define HISTORY_DATA_SIZE       (SENSOR_HISTORY_BLOCK_SIZE - SENSOR_HISTORY_HEADER_SIZE)
+#define HISTORY_DATA_NIBBLES    (HISTORY_DATA_SIZE * 2)
+// 4 varints of 33 bits at most
+#define HISTORY_SAMPLE_NIBBLES  48
+#define FNV_OFFSET              2166136261u
+#define FNV_PRIME               16777619u
+
+typedef struct {
+    uint8_t block[SENSOR_HISTORY_BLOCK_SIZE];
+    uint16_t nibbles;
+    uint8_t count;
+    sensor_history_sample_t last;
+    int32_t last_step;
+} open_block_t;
+
+typedef struct {
+    uint8_t nibbles[HISTORY_SAMPLE_NIBBLES];
+    uint8_t count;
+} nibble_buf_t;
+
+static open_block_t s_open[SCD4X_SENSOR_MAX];
+// the newest sealed blocks, seq at index seq % CONFIG_SENSOR_HISTORY_RAM_BLOCKS
+static uint8_t s_ram[CONFIG_SENSOR_HISTORY_RAM_BLOCKS][SENSOR_HISTORY_BLOCK_SIZE];
+static uint32_t s_ram_count;
+static sensor_history_store_t s_store;
+static bool s_has_store;
+static uint32_t s_next_seq;
+static uint16_t s_boot;
+static sensor_history_stats_t s_stats;
+static uint32_t s_sealed_bytes;
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, v & 0xffff);
+    put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint32_t checksum(const uint8_t *block, uint16_t length)
+{
+    uint32_t h = FNV_OFFSET;
+    for (size_t i = 0; i < SENSOR_HISTORY_HEADER_SIZE - 4 + length; i++) {
+        // skip the checksum itself
+        uint8_t b = block[i < SENSOR_HISTORY_HEADER_SIZE - 4 ? i : i + 4];
+        h = (h ^ b) * FNV_PRIME;
+    }
+    return h;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static void put_varint(nibble_buf_t *buf, uint32_t v)
+{
+    do {
+        uint8_t nibble = v & 0x7;
+        v >>= 3;
+        if (v) {
+            nibble |= 0x8;
+        }
+        buf->nibbles[buf->count++] = nibble;
+    } while (v);
+}
+
+static void encode(const open_block_t *open, const sensor_history_sample_t *sample, nibble_buf_t *buf)
+{
+    buf->count = 0;
+    if (open->count == 0) {
+        put_varint(buf, sample->time_s);
+        put_varint(buf, sample->co2);
+        put_varint(buf, zigzag(sample->temperature));
+        put_varint(buf, sample->humidity);
+        return;
+    }
+    int32_t step = (int32_t)(sample->time_s - open->last.time_s);
+    put_varint(buf, zigzag(step - open->last_step));
+    put_varint(buf, zigzag((int32_t)sample->co2 - open->last.co2));
+    put_varint(buf, zigzag((int32_t)sample->temperature - open->last.temperature));
+    put_varint(buf, zigzag((int32_t)sample->humidity - open->last.humidity));
+}
+
+// Fill the header of open's block into block, a copy or the block itself
+static void seal_into(const open_block_t *open, size_t sensor, uint32_t seq, uint8_t *block)
+{
+    if (block != open->block) {
+        memcpy(block, open->block, SENSOR_HISTORY_BLOCK_SIZE);
+    }
+    uint16_t length = (open->nibbles + 1) / 2;
+    // erased flash is 0xff, leave the rest of the page alone
+    memset(block + SENSOR_HISTORY_HEADER_SIZE + length, 0xff, HISTORY_DATA_SIZE - length);
+    put16(block, HISTORY_MAGIC);
+    block[2] = sensor;
+    block[3] = open->count;
+    put32(block + 4, seq);
+    put16(block + 8, s_boot);
+    put16(block + 10, length);
+    put32(block + 12, checksum(block, length));
+}
+
+static bool parse_header(const uint8_t *block, sensor_history_block_info_t *info)
+{
+    if (get16(block) != HISTORY_MAGIC) {
+        return false;
+    }
+    info->sensor = block[2];
+    info->count = block[3];
+    info->seq = get32(block + 4);
+    info->boot = get16(block + 8);
+    info->length = get16(block + 10);
+    return info->length <= HISTORY_DATA_SIZE && get32(block + 12) == checksum(block, info->length);
+}
+
+static void store_write(uint32_t seq, const uint8_t *block)
+{
+    uint32_t index = seq % s_store.blocks;
+    if (index % s_store.blocks_per_sector == 0) {
+        if (s_store.erase(index / s_store.blocks_per_sector, s_store.ctx) != ESP_OK) {
+            s_stats.write_errors++;
+            return;
+        }
+        s_stats.erases++;
+    }
+    if (s_store.write(index, block, s_store.ctx) != ESP_OK) {
+        s_stats.write_errors++;
+        return;
+    }
+    s_stats.writes++;
+}
+
+static void seal(size_t sensor)
+{
+    open_block_t *open = &s_open[sensor];
+    uint32_t seq = s_next_seq++;
+    uint8_t *block = s_ram[seq % CONFIG_SENSOR_HISTORY_RAM_BLOCKS];
+    seal_into(open, sensor, seq, block);
+    s_sealed_bytes += get16(block + 10);
+    if (s_ram_count < CONFIG_SENSOR_HISTORY_RAM_BLOCKS) {
+        s_ram_count++;
+    }
+    s_stats.sealed++;
+    if (s_has_store) {
+        store_write(seq, block);
+    }
+    memset(open->block, 0, sizeof(open->block));
+    open->nibbles = 0;
+    open->count = 0;
+    open->last_step = 0;
+}
+
+static bool page_blank(const uint8_t *block)
+{
+    for (size_t i = 0; i < SENSOR_HISTORY_BLOCK_SIZE; i++) {
+        if (block[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t sensor_history_init(const sensor_history_store_t *store)
+{
+    memset(s_open, 0, sizeof(s_open));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_sealed_bytes = 0;
+    s_ram_count = 0;
+    s_next_seq = 0;
+    s_boot = 0;
+    s_has_store = store && store->blocks > 0 && store->blocks_per_sector > 0;
+    if (!s_has_store) {
+        return ESP_OK;
+    }
+    s_store = *store;
+    if (s_store.blocks % s_store.blocks_per_sector != 0) {
+        ESP_LOGE(TAG, "%lu blocks are not whole sectors of %lu", (unsigned long)s_store.blocks,
+                 (unsigned long)s_store.blocks_per_sector);
+        s_has_store = false;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t block[SENSOR_HISTORY_BLOCK_SIZE];
+    bool found = false;
+    sensor_history_block_info_t newest = {};
+    for (uint32_t i = 0; i < s_store.blocks; i++) {
+        sensor_history_block_info_t info;
+        if (s_store.read(i, block, s_store.ctx) != ESP_OK || !parse_header(block, &info)) {
+            continue;
+        }
+        if (info.seq % s_store.blocks == i && (!found || info.seq > newest.seq)) {
+            newest = info;
+            found = true;
+        }
+    }
+    if (found) {
+        s_next_seq = newest.seq + 1;
+        s_boot = newest.boot + 1;
+    }
+    // a write cut short by a reset leaves a page that is neither valid nor blank, go past it
+    while (s_next_seq % s_store.blocks_per_sector != 0) {
+        if (s_store.read(s_next_seq % s_store.blocks, block, s_store.ctx) == ESP_OK && page_blank(block)) {
+            break;
+        }
+        s_next_seq++;
+    }
+    ESP_LOGI(TAG, "boot %u, next block %lu of %lu", s_boot, (unsigned long)s_next_seq,
+             (unsigned long)s_store.blocks);
+    return ESP_OK;
+}
+
+void sensor_history_add(size_t sensor, const sensor_measurement_t *measurement, uint32_t time_s)
+{
+    if (sensor >= SCD4X_SENSOR_MAX) {
+        return;
+    }
+    open_block_t *open = &s_open[sensor];
+    sensor_history_sample_t sample = {
+        .time_s = time_s,
+        .co2 = measurement->co2,
+        .temperature = measurement->temperature,
+        .humidity = measurement->humidity,
+    };
+    nibble_buf_t buf;
+    encode(open, &sample, &buf);
+    if (open->nibbles + buf.count > HISTORY_DATA_NIBBLES || open->count == UINT8_MAX) {
+        seal(sensor);
+        encode(open, &sample, &buf);
+    }
+
+    uint8_t *data = open->block + SENSOR_HISTORY_HEADER_SIZE;
+    for (size_t i = 0; i < buf.count; i++, open->nibbles++) {
+        data[open->nibbles / 2] |= buf.nibbles[i] << (open->nibbles % 2 ? 4 : 0);
+    }
+    if (open->count > 0) {
+        open->last_step = (int32_t)(time_s - open->last.time_s);
+    }
+    open->last = sample;
+    open->count++;
+    s_stats.samples++;
+}
+
+void sensor_history_flush(void)
+{
+    for (size_t i = 0; i < SCD4X_SENSOR_MAX; i++) {
+        if (s_open[i].count > 0) {
+            seal(i);
+        }
+    }
+}
+
+void sensor_history_range(uint32_t *first, uint32_t *next)
+{
+    uint32_t span = s_ram_count;
+    if (s_has_store && s_store.blocks > span) {
+        span = s_store.blocks;
+    }
+    *next = s_next_seq;
+    *first = s_next_seq > span ? s_next_seq - span : 0;
+}
+
+bool sensor_history_copy_block(uint32_t seq, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE])
+{
+    if (seq >= s_next_seq) {
+        return false;
+    }
+    if (s_next_seq - seq <= s_ram_count) {
+        memcpy(block, s_ram[seq % CONFIG_SENSOR_HISTORY_RAM_BLOCKS], SENSOR_HISTORY_BLOCK_SIZE);
+        return true;
+    }
+    if (!s_has_store || s_next_seq - seq > s_store.blocks) {
+        return false;
+    }
+    sensor_history_block_info_t info;
+    return s_store.read(seq % s_store.blocks, block, s_store.ctx) == ESP_OK && parse_header(block, &info) &&
+           info.seq == seq;
+}
+
+bool sensor_history_copy_open(size_t sensor, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE])
+{
+    if (sensor >= SCD4X_SENSOR_MAX || s_open[sensor].count == 0) {
+        return false;
+    }
+    // not sealed yet, so no seq
+    seal_into(&s_open[sensor], sensor, UINT32_MAX, block);
+    return true;
+}
+
+void sensor_history_get_stats(sensor_history_stats_t *stats)
+{
+    *stats = s_stats;
+    stats->bytes = s_sealed_bytes;
+    for (size_t i = 0; i < SCD4X_SENSOR_MAX; i++) {
+        stats->bytes += (s_open[i].nibbles + 1) / 2;
+    }
+}
+
+static bool get_varint(const uint8_t *data, uint16_t nibbles, uint16_t *pos, uint32_t *v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 33; shift += 3) {
+        if (*pos >= nibbles) {
+            return false;
+        }
+        uint8_t nibble = (data[*pos / 2] >> (*pos % 2 ? 4 : 0)) & 0xf;
+        (*pos)++;
+        *v |= (uint32_t)(nibble & 0x7) << shift;
+        if (!(nibble & 0x8)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sensor_history_decode(const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], sensor_history_block_info_t *info,
+                           void (*cb)(const sensor_history_sample_t *sample, void *ctx), void *ctx)
+{
+    if (!parse_header(block, info)) {
+        return false;
+    }
+    const uint8_t *data = block + SENSOR_HISTORY_HEADER_SIZE;
+    uint16_t nibbles = info->length * 2;
+    uint16_t pos = 0;
+    sensor_history_sample_t sample = {};
+    int32_t step = 0;
+    for (size_t i = 0; i < info->count; i++) {
+        uint32_t v[4];
+        for (size_t j = 0; j < 4; j++) {
+            if (!get_varint(data, nibbles, &pos, &v[j])) {
+                return false;
+            }
+        }
+        if (i == 0) {
+            sample.time_s = v[0];
+            sample.co2 = v[1];
+            sample.temperature = unzigzag(v[2]);
+            sample.humidity = v[3];
+        } else {
+            step += unzigzag(v[0]);
+            sample.time_s += step;
+            sample.co2 += unzigzag(v[1]);
+            sample.temperature += unzigzag(v[2]);
+            sample.humidity += unzigzag(v[3]);
+        }
+        if (cb) {
+            cb(&sample, ctx);
+        }
+    }
+    return true;
+}
+
+static void print_sample(const sensor_history_sample_t *sample, void *ctx)
+{
+    const sensor_history_block_info_t *info = (const sensor_history_block_info_t *)ctx;
+    int t = sample->temperature;
+    printf("%u,%u,%lu,%u,%s%d.%02d,%u.%02u\n", info->boot, info->sensor, (unsigned long)sample->time_s, sample->co2,
+           t < 0 ? "-" : "", abs(t) / 100, abs(t) % 100, sample->humidity / 100, sample->humidity % 100);
+}
+
+void sensor_history_print_block(const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], bool hex)
+{
+    sensor_history_block_info_t info;
+    if (!parse_header(block, &info)) {
+        return;
+    }
+    if (hex) {
+        // the unused tail is 0xff, history_decode fills it back in
+        for (size_t i = 0; i < SENSOR_HISTORY_HEADER_SIZE + info.length; i++) {
+            printf("%02x", block[i]);
+        }
+        printf("\n");
+        return;
+    }
+    sensor_history_decode(block, &info, print_sample, &info);
+}
@@ -0,0 +1,108 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sample history, compressed into flash page sized blocks.
+
+  Each sensor fills its own block. A block starts with the absolute
+  values of its first sample, every further sample stores the change of
+  the sample spacing and the differences of CO2, temperature and humidity
+  as zigzag varints of 4 bit groups, so a small change takes half a byte.
+  A steady room costs 2 to 3 bytes per sample instead of the 10 of the raw
+  values.
+
+  A full block is sealed, kept in a RAM ring of the newest
+  CONFIG_SENSOR_HISTORY_RAM_BLOCKS and written to the block store in one
+  page write. The store is a ring too: block seq goes to index
+  seq % blocks, and a sector is erased only when the ring enters it.
+
+  Times are esp_timer seconds in the boot the block was written in, boots
+  are counted by the history itself. Everything but the store's own
+  functions runs on the matter thread.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#include <scd4x_sensor.h>
+
+// one flash program page
+#define SENSOR_HISTORY_BLOCK_SIZE   256
+#define SENSOR_HISTORY_HEADER_SIZE  16
+
+typedef struct {
+    // esp_timer seconds
+    uint32_t time_s;
+    uint16_t co2;
+    // 0.01 °C and 0.01 %, as the Matter attributes
+    int16_t temperature;
+    uint16_t humidity;
+} sensor_history_sample_t;
+
+typedef struct {
+    // blocks are numbered in the order they were sealed
+    uint32_t seq;
+    uint16_t boot;
+    uint8_t sensor;
+    uint8_t count;
+    // bytes used after the header
+    uint16_t length;
+} sensor_history_block_info_t;
+
+// Where sealed blocks go after RAM, e.g. a flash partition (sensor_history_flash.h)
+typedef struct {
+    // blocks the store holds, 0 keeps the history in RAM
+    uint32_t blocks;
+    // blocks per erase unit, a write to the first block of one erases it
+    uint32_t blocks_per_sector;
+    esp_err_t (*read)(uint32_t index, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx);
+    esp_err_t (*erase)(uint32_t sector, void *ctx);
+    esp_err_t (*write)(uint32_t index, const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx);
+    void *ctx;
+} sensor_history_store_t;
+
+typedef struct {
+    uint32_t samples;
+    // encoded sample bytes, headers excluded
+    uint32_t bytes;
+    uint32_t sealed;
+    uint32_t writes;
+    uint32_t erases;
+    uint32_t write_errors;
+} sensor_history_stats_t;
+
+// Start over, then find the newest block in store (NULL: RAM only) and continue after it
+esp_err_t sensor_history_init(const sensor_history_store_t *store);
+
+// Add a committed sample of sensor (its registry slot) taken at time_s
+void sensor_history_add(size_t sensor, const sensor_measurement_t *measurement, uint32_t time_s);
+
+// Seal every partly filled block, e.g. before a planned restart
+void sensor_history_flush(void);
+
+// Sealed blocks that may still exist: [*first, *next)
+void sensor_history_range(uint32_t *first, uint32_t *next);
+
+// Copy sealed block seq from RAM or the store, false if it is gone
+bool sensor_history_copy_block(uint32_t seq, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE]);
+
+// Copy the block sensor is filling, sealed on the copy, false while it is empty
+bool sensor_history_copy_open(size_t sensor, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE]);
+
+void sensor_history_get_stats(sensor_history_stats_t *stats);
+
+// One CSV line per sample (boot,sensor,time_s,co2,temperature,humidity), or the block as one hex line
+void sensor_history_print_block(const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], bool hex);
+
+// Check a block and call cb for each sample, oldest first; false if the block is not valid
+bool sensor_history_decode(const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], sensor_history_block_info_t *info,
+                           void (*cb)(const sensor_history_sample_t *sample, void *ctx), void *ctx);
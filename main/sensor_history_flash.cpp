@@ -0,0 +1,54 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <esp_log.h>
+#include <esp_partition.h>
+
+#include <sensor_history_flash.h>
+
+static const char *TAG = "history";
+
+static esp_err_t flash_read(uint32_t index, uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    const esp_partition_t *part = (const esp_partition_t *)ctx;
+    return esp_partition_read(part, index * SENSOR_HISTORY_BLOCK_SIZE, block, SENSOR_HISTORY_BLOCK_SIZE);
+}
+
+static esp_err_t flash_erase(uint32_t sector, void *ctx)
+{
+    const esp_partition_t *part = (const esp_partition_t *)ctx;
+    return esp_partition_erase_range(part, sector * part->erase_size, part->erase_size);
+}
+
+static esp_err_t flash_write(uint32_t index, const uint8_t block[SENSOR_HISTORY_BLOCK_SIZE], void *ctx)
+{
+    const esp_partition_t *part = (const esp_partition_t *)ctx;
+    // one page program; the block is page aligned so it never crosses a page
+    return esp_partition_write(part, index * SENSOR_HISTORY_BLOCK_SIZE, block, SENSOR_HISTORY_BLOCK_SIZE);
+}
+
+esp_err_t sensor_history_flash_store(sensor_history_store_t *store)
+{
+    const esp_partition_t *part =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, SENSOR_HISTORY_PARTITION);
+    if (!part) {
+        ESP_LOGW(TAG, "No \"%s\" partition, history stays in RAM", SENSOR_HISTORY_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->erase_size % SENSOR_HISTORY_BLOCK_SIZE != 0 || part->size % part->erase_size != 0) {
+        ESP_LOGE(TAG, "\"%s\" partition is not whole sectors", SENSOR_HISTORY_PARTITION);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    store->blocks = part->size / SENSOR_HISTORY_BLOCK_SIZE;
+    store->blocks_per_sector = part->erase_size / SENSOR_HISTORY_BLOCK_SIZE;
+    store->read = flash_read;
+    store->erase = flash_erase;
+    store->write = flash_write;
+    store->ctx = (void *)part;
+    return ESP_OK;
+}
@@ -0,0 +1,19 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <esp_err.h>
+
+#include <sensor_history.h>
+
+#define SENSOR_HISTORY_PARTITION "history"
+
+// History block store on the "history" data partition (partitions.csv),
+// ESP_ERR_NOT_FOUND when the partition table has none
+esp_err_t sensor_history_flash_store(sensor_history_store_t *store);
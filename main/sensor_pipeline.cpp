@@ -0,0 +1,46 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <sensor_history.h>
+#include <sensor_pipeline.h>
+#include <sensor_probe.h>
+
+static void commit(sensor_pipeline_t *pipeline, const sensor_measurement_t *measurement)
+{
+    uint32_t written = sensor_commit_apply(&pipeline->commit, measurement, pipeline->write, pipeline->write_ctx);
+    SENSOR_PROBE_COUNT(SENSOR_COUNTER_SUPPRESSED, SENSOR_ATTR_COUNT - __builtin_popcount(written));
+}
+
+bool sensor_pipeline_apply(sensor_pipeline_t *pipeline, sensor_measurement_t *measurement, int64_t now_us)
+{
+    if (measurement->retained) {
+        commit(pipeline, measurement);
+        return false;
+    }
+    if (pipeline->adapt) {
+        // unfiltered: the filter's lag would hide the trend
+        sensor_task_set_interval(measurement->sensor, sensor_adapt_update(pipeline->adapt, measurement->co2, now_us));
+    }
+    sensor_filter_apply(&pipeline->filter, measurement, now_us);
+    if (pipeline->alarm) {
+        uint8_t previous = pipeline->alarm->level;
+        sensor_alarm_result_t result = sensor_alarm_update(pipeline->alarm, measurement->co2);
+        if (result != SENSOR_ALARM_STEADY && pipeline->alarm_cb) {
+            pipeline->alarm_cb(measurement->sensor, result, previous, measurement->co2, pipeline->alarm_ctx);
+        }
+    }
+    sensor_window_add(&pipeline->co2_window, measurement->co2, now_us);
+    sensor_window_peak(&pipeline->co2_window, &measurement->co2_peak);
+    sensor_window_average(&pipeline->co2_window, &measurement->co2_average);
+    commit(pipeline, measurement);
+    if (pipeline->history) {
+        // a full block goes to flash right here, in a wake the sample already paid for
+        sensor_history_add(pipeline->slot, measurement, (uint32_t)(now_us / 1000000));
+    }
+    return true;
+}
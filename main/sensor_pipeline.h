@@ -0,0 +1,60 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  What the Matter thread does with each drained measurement, one copy for
+  app_main.cpp and the host benches.
+
+  A retained measurement (the previous boot's last values) only goes to
+  the attributes: it is no new reading, so it stays out of the trend,
+  filter, alarm, window and history. A fresh one sets the adaptive
+  interval from the unfiltered CO2, goes through the filter, the CO2
+  alarm and the peak/average window, is committed to the attributes and
+  added to the sample history. Adaptive sampling, the alarm and the
+  history are optional per sensor. Matter thread only.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <scd4x_sensor.h>
+#include <sensor_adapt.h>
+#include <sensor_alarm.h>
+#include <sensor_commit.h>
+#include <sensor_filter.h>
+#include <sensor_window.h>
+
+// A sample moved the alarm: result is SENSOR_ALARM_PENDING or SENSOR_ALARM_CHANGED, previous
+// the level before it, co2_ppm the filtered CO2. sensor is the task index of the measurement.
+using sensor_pipeline_alarm_cb_t = void (*)(size_t sensor, sensor_alarm_result_t result, uint8_t previous,
+                                            uint16_t co2_ppm, void *ctx);
+
+// One per sensor, set up by the caller with the init functions of each part
+typedef struct {
+    sensor_filter_t filter;
+    sensor_window_t co2_window;
+    sensor_commit_t commit;
+    // writes the due attributes, see sensor_commit_apply()
+    sensor_attr_write_cb_t write;
+    void *write_ctx;
+    // NULL: the sample interval is left alone
+    sensor_adapt_t *adapt;
+    // NULL: no CO2 alarm
+    sensor_alarm_t *alarm;
+    sensor_pipeline_alarm_cb_t alarm_cb;
+    void *alarm_ctx;
+    // add fresh samples to sensor_history.h, under the registry slot
+    bool history;
+    uint8_t slot;
+} sensor_pipeline_t;
+
+// Run one drained measurement through the pipeline at now_us, measurement ends up as committed.
+// Returns false for a retained measurement, true for a fresh one.
+bool sensor_pipeline_apply(sensor_pipeline_t *pipeline, sensor_measurement_t *measurement, int64_t now_us);
@@ -0,0 +1,119 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <esp_log.h>
+#include <nvs.h>
+#include <sdkconfig.h>
+
+#include <sensor_registry.h>
+
+static const char *TAG = "sensor_registry";
+
+#define REGISTRY_NVS_NAMESPACE  "sensors"
+#define REGISTRY_NVS_KEY        "slots"
+
+// Kconfig channel -1 is SENSOR_MUX_NONE
+#define KCONFIG_SLOT(n) {                                                       \
+        .i2c_port = CONFIG_SENSOR##n##_I2C_PORT,                                \
+        .sda_gpio = CONFIG_SENSOR##n##_SDA_GPIO,                                \
+        .scl_gpio = CONFIG_SENSOR##n##_SCL_GPIO,                                \
+        .mux_channel = (uint8_t)CONFIG_SENSOR##n##_MUX_CHANNEL,                 \
+        .interval_s = CONFIG_SENSOR##n##_INTERVAL_SEC,                          \
+    }
+
+static void load_kconfig(sensor_registry_t *registry)
+{
+    static const sensor_slot_t slots[] = {
+        KCONFIG_SLOT(1),
+#if CONFIG_SENSOR_COUNT >= 2
+        KCONFIG_SLOT(2),
+#endif
+#if CONFIG_SENSOR_COUNT >= 3
+        KCONFIG_SLOT(3),
+#endif
+#if CONFIG_SENSOR_COUNT >= 4
+        KCONFIG_SLOT(4),
+#endif
+    };
+    static_assert(sizeof(slots) / sizeof(slots[0]) <= SCD4X_SENSOR_MAX, "more Kconfig slots than sensors");
+    registry->count = sizeof(slots) / sizeof(slots[0]);
+    memcpy(registry->slots, slots, sizeof(slots));
+}
+
+esp_err_t sensor_registry_load(sensor_registry_t *registry)
+{
+    load_kconfig(registry);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(REGISTRY_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // nothing stored yet
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed, err:%d", err);
+        return err;
+    }
+
+    sensor_slot_t stored[SCD4X_SENSOR_MAX];
+    size_t len = sizeof(stored);
+    err = nvs_get_blob(handle, REGISTRY_NVS_KEY, stored, &len);
+    nvs_close(handle);
+    if (err == ESP_OK && len > 0 && len % sizeof(stored[0]) == 0) {
+        registry->count = len / sizeof(stored[0]);
+        memcpy(registry->slots, stored, len);
+        ESP_LOGI(TAG, "%u sensors from NVS", (unsigned)registry->count);
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Ignoring stored sensor table, err:%d len:%u", err, (unsigned)len);
+    }
+    return ESP_OK;
+}
+
+esp_err_t sensor_registry_save(const sensor_registry_t *registry)
+{
+    if (registry == NULL || registry->count == 0 || registry->count > SCD4X_SENSOR_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(REGISTRY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open failed, err:%d", err);
+        return err;
+    }
+    err = nvs_set_blob(handle, REGISTRY_NVS_KEY, registry->slots, registry->count * sizeof(registry->slots[0]));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t sensor_registry_erase(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(REGISTRY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_erase_key(handle, REGISTRY_NVS_KEY);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK;
+    }
+    nvs_close(handle);
+    return err;
+}
+
+uint32_t sensor_slot_interval_ms(const sensor_slot_t *slot)
+{
+    return (slot->interval_s ? slot->interval_s : CONFIG_SENSOR_SAMPLE_INTERVAL_SEC) * 1000;
+}
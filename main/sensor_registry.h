@@ -0,0 +1,52 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Where the SCD4x sensors of this node sit on the I2C buses.
+
+  The Kconfig "Sensors" menu gives the build default. A table stored in
+  NVS namespace "sensors" under key "slots" (an array of sensor_slot_t)
+  replaces it as a whole, so a node can be rewired without a new image.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_err.h>
+
+#include <scd4x_sensor.h>
+
+// sensor_slot_t::mux_channel of a sensor wired to the bus directly
+#define SENSOR_MUX_NONE 0xff
+
+typedef struct {
+    uint8_t i2c_port;
+    uint8_t sda_gpio;
+    uint8_t scl_gpio;
+    // TCA9548A channel, or SENSOR_MUX_NONE
+    uint8_t mux_channel;
+    // seconds between samples, 0: CONFIG_SENSOR_SAMPLE_INTERVAL_SEC
+    uint16_t interval_s;
+} sensor_slot_t;
+
+typedef struct {
+    size_t count;
+    sensor_slot_t slots[SCD4X_SENSOR_MAX];
+} sensor_registry_t;
+
+esp_err_t sensor_registry_load(sensor_registry_t *registry);
+
+esp_err_t sensor_registry_save(const sensor_registry_t *registry);
+
+// Drop the stored table, the next load falls back to Kconfig
+esp_err_t sensor_registry_erase(void);
+
+// Sample interval of a slot in milliseconds
+uint32_t sensor_slot_interval_ms(const sensor_slot_t *slot);
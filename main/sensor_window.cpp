@@ -0,0 +1,82 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <sensor_window.h>
+
+void sensor_window_init(sensor_window_t *window, uint32_t window_s, int64_t now_us)
+{
+    memset(window, 0, sizeof(*window));
+    window->window_s = window_s;
+    window->bucket_us = (int64_t)window_s * 1000000 / SENSOR_WINDOW_BUCKETS;
+    if (window->bucket_us <= 0) {
+        window->bucket_us = 1;
+    }
+    window->bucket_start_us = now_us;
+}
+
+// Drop every bucket that slid out of the window by now_us
+static void slide(sensor_window_t *window, int64_t now_us)
+{
+    int64_t steps = (now_us - window->bucket_start_us) / window->bucket_us;
+    if (steps <= 0) {
+        return;
+    }
+    window->bucket_start_us += steps * window->bucket_us;
+    if (steps > SENSOR_WINDOW_BUCKETS) {
+        steps = SENSOR_WINDOW_BUCKETS;
+    }
+    for (int64_t i = 0; i < steps; i++) {
+        window->head = (uint8_t)((window->head + 1) % SENSOR_WINDOW_BUCKETS);
+        sensor_window_bucket_t *bucket = &window->buckets[window->head];
+        window->sum -= bucket->sum;
+        window->count -= bucket->count;
+        memset(bucket, 0, sizeof(*bucket));
+    }
+}
+
+void sensor_window_add(sensor_window_t *window, uint16_t value, int64_t now_us)
+{
+    slide(window, now_us);
+
+    sensor_window_bucket_t *bucket = &window->buckets[window->head];
+    if (bucket->count == 0 || value > bucket->max) {
+        bucket->max = value;
+    }
+    if (bucket->count == UINT16_MAX) {
+        // more samples than a bucket can count, the ones so far are enough for the average
+        return;
+    }
+    bucket->count++;
+    bucket->sum += value;
+    window->count++;
+    window->sum += value;
+}
+
+bool sensor_window_peak(const sensor_window_t *window, uint16_t *peak)
+{
+    bool found = false;
+    for (int i = 0; i < SENSOR_WINDOW_BUCKETS; i++) {
+        const sensor_window_bucket_t *bucket = &window->buckets[i];
+        if (bucket->count && (!found || bucket->max > *peak)) {
+            *peak = bucket->max;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool sensor_window_average(const sensor_window_t *window, uint16_t *average)
+{
+    if (window->count == 0) {
+        return false;
+    }
+    *average = (uint16_t)((window->sum + window->count / 2) / window->count);
+    return true;
+}
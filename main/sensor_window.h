@@ -0,0 +1,50 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Sliding window peak and average in constant memory.
+
+  The window is split into SENSOR_WINDOW_BUCKETS time buckets that each
+  keep the maximum, sum and count of their samples. When time moves past
+  a bucket the oldest one is dropped, so the window slides in steps of
+  window_s / SENSOR_WINDOW_BUCKETS and never stores individual samples.
+  Used for the PeakMeasuredValue and AverageMeasuredValue attributes of
+  the CO2 concentration cluster.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define SENSOR_WINDOW_BUCKETS 12
+
+typedef struct {
+    uint16_t max;
+    uint16_t count;
+    uint32_t sum;
+} sensor_window_bucket_t;
+
+typedef struct {
+    uint32_t window_s;
+    int64_t bucket_us;
+    // start of the newest bucket, buckets[head]
+    int64_t bucket_start_us;
+    uint8_t head;
+    sensor_window_bucket_t buckets[SENSOR_WINDOW_BUCKETS];
+    // totals over all buckets
+    uint64_t sum;
+    uint32_t count;
+} sensor_window_t;
+
+void sensor_window_init(sensor_window_t *window, uint32_t window_s, int64_t now_us);
+
+void sensor_window_add(sensor_window_t *window, uint16_t value, int64_t now_us);
+
+// Both return false while the window holds no sample
+bool sensor_window_peak(const sensor_window_t *window, uint16_t *peak);
+bool sensor_window_average(const sensor_window_t *window, uint16_t *average);
@@ -0,0 +1,106 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <telemetry.h>
+
+// by telemetry_task_t
+static const char *const s_task_names[TELEMETRY_TASK_COUNT] = {
+    "sensor",
+    "CHIP",
+    "esp_timer",
+    "ot_task",
+};
+
+#if CONFIG_SENSOR_ALLOC_WATCH
+static std::atomic<TaskHandle_t> s_sensor_task;
+// the matter thread while it drains, NULL otherwise
+static std::atomic<TaskHandle_t> s_drain_task;
+static TaskHandle_t s_chip_task;
+static std::atomic<uint32_t> s_sample_allocs;
+
+// CONFIG_HEAP_USE_HOOKS, called on every allocation of every task, possibly with the cache off
+extern "C" void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task != NULL && (task == s_sensor_task.load(std::memory_order_relaxed) ||
+                         task == s_drain_task.load(std::memory_order_relaxed))) {
+        s_sample_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+extern "C" void IRAM_ATTR esp_heap_trace_free_hook(void *ptr)
+{
+}
+
+void telemetry_watch_start(void)
+{
+    s_chip_task = xTaskGetCurrentTaskHandle();
+    s_sensor_task = xTaskGetHandle(s_task_names[TELEMETRY_TASK_SENSOR]);
+}
+
+void telemetry_drain_begin(void)
+{
+    s_drain_task = s_chip_task;
+}
+
+void telemetry_drain_end(void)
+{
+    s_drain_task = NULL;
+}
+#endif
+
+void telemetry_read(telemetry_t *telemetry)
+{
+    memset(telemetry, 0, sizeof(*telemetry));
+    telemetry->heap_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    telemetry->heap_free_min = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    telemetry->heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+    telemetry->heap_blocks = info.allocated_blocks;
+#if CONFIG_SENSOR_ALLOC_WATCH
+    telemetry->sample_allocs = s_sample_allocs.load(std::memory_order_relaxed);
+#endif
+    for (int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+        TaskHandle_t task = xTaskGetHandle(s_task_names[i]);
+        if (task) {
+            // bytes: StackType_t is a byte in ESP-IDF
+            telemetry->stack_free_min[i] = uxTaskGetStackHighWaterMark(task);
+        }
+    }
+}
+
+const char *telemetry_task_name(telemetry_task_t task)
+{
+    return task < TELEMETRY_TASK_COUNT ? s_task_names[task] : "?";
+}
+
+void telemetry_print(const telemetry_t *telemetry)
+{
+    printf("heap: %lu free, %lu lowest, %lu largest block, %lu blocks allocated\n",
+           (unsigned long)telemetry->heap_free, (unsigned long)telemetry->heap_free_min,
+           (unsigned long)telemetry->heap_largest_block, (unsigned long)telemetry->heap_blocks);
+#if CONFIG_SENSOR_ALLOC_WATCH
+    printf("sample path allocations: %lu\n", (unsigned long)telemetry->sample_allocs);
+#endif
+    for (int i = 0; i < TELEMETRY_TASK_COUNT; i++) {
+        if (telemetry->stack_free_min[i]) {
+            printf("stack %-10s %5lu bytes never used\n", s_task_names[i],
+                   (unsigned long)telemetry->stack_free_min[i]);
+        }
+    }
+}
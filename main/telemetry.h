@@ -0,0 +1,65 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  Heap and stack telemetry.
+
+  Free heap, its low-water mark and the largest free block show a leak or
+  fragmentation long before an allocation fails; the stack high-water
+  marks show how close each task came to its stack size.
+
+  With CONFIG_SENSOR_ALLOC_WATCH a heap hook also counts every allocation
+  made on the sample path once it is running: on the sensor task, and on
+  the matter thread between telemetry_drain_begin() and _end(). The path
+  is meant to be allocation free, anything counted there is a bug.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <sdkconfig.h>
+
+typedef enum {
+    TELEMETRY_TASK_SENSOR,
+    TELEMETRY_TASK_CHIP,
+    TELEMETRY_TASK_ESP_TIMER,
+    TELEMETRY_TASK_OPENTHREAD,
+    TELEMETRY_TASK_COUNT,
+} telemetry_task_t;
+
+typedef struct {
+    // MALLOC_CAP_DEFAULT heap, bytes
+    uint32_t heap_free;
+    uint32_t heap_free_min;
+    uint32_t heap_largest_block;
+    uint32_t heap_blocks;
+    // allocations on the sample path since telemetry_watch_start()
+    uint32_t sample_allocs;
+    // bytes of stack never used, 0 for a task that does not exist
+    uint32_t stack_free_min[TELEMETRY_TASK_COUNT];
+} telemetry_t;
+
+void telemetry_read(telemetry_t *telemetry);
+
+const char *telemetry_task_name(telemetry_task_t task);
+
+void telemetry_print(const telemetry_t *telemetry);
+
+#if CONFIG_SENSOR_ALLOC_WATCH
+// The sample path is up (first sample committed), start counting
+void telemetry_watch_start(void);
+
+// Around the drain on the matter thread
+void telemetry_drain_begin(void);
+void telemetry_drain_end(void);
+#else
+static inline void telemetry_watch_start(void) {}
+static inline void telemetry_drain_begin(void) {}
+static inline void telemetry_drain_end(void) {}
+#endif
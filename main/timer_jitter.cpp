@@ -0,0 +1,97 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <timer_jitter.h>
+
+static const char *TAG = "timer_jitter";
+
+// log a summary about once a minute
+#define TIMER_JITTER_LOG_PERIOD_US (60 * 1000000LL)
+
+typedef struct {
+    esp_timer_handle_t timer;
+    int64_t period_us;
+    int64_t expected_us;
+    int64_t last_log_us;
+    timer_jitter_stats_t stats;
+} timer_jitter_ctx_t;
+
+static timer_jitter_ctx_t s_ctx;
+
+static void jitter_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t late_us = now - s_ctx.expected_us;
+    s_ctx.expected_us += s_ctx.period_us;
+
+    timer_jitter_stats_t *stats = &s_ctx.stats;
+    stats->samples++;
+    stats->total_us += late_us;
+    if (late_us > stats->max_us) {
+        stats->max_us = late_us;
+    }
+    if (late_us > TIMER_JITTER_LATE_US) {
+        stats->late++;
+    }
+
+    if (now - s_ctx.last_log_us >= TIMER_JITTER_LOG_PERIOD_US) {
+        s_ctx.last_log_us = now;
+        ESP_LOGI(TAG, "esp_timer lateness: mean %lld us, max %lld us, late %lu/%lu",
+                 (long long)(stats->total_us / stats->samples), (long long)stats->max_us,
+                 (unsigned long)stats->late, (unsigned long)stats->samples);
+    }
+}
+
+esp_err_t timer_jitter_start(uint32_t period_ms)
+{
+    if (s_ctx.timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&s_ctx, 0, sizeof(s_ctx));
+    esp_timer_create_args_t args = {
+        .callback = jitter_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "timer_jitter",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&args, &s_ctx.timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_ctx.period_us = (int64_t)period_ms * 1000;
+    s_ctx.expected_us = esp_timer_get_time() + s_ctx.period_us;
+    s_ctx.last_log_us = esp_timer_get_time();
+    err = esp_timer_start_periodic(s_ctx.timer, s_ctx.period_us);
+    if (err != ESP_OK) {
+        esp_timer_delete(s_ctx.timer);
+        s_ctx.timer = NULL;
+    }
+    return err;
+}
+
+void timer_jitter_stop(void)
+{
+    if (s_ctx.timer) {
+        esp_timer_stop(s_ctx.timer);
+        esp_timer_delete(s_ctx.timer);
+        s_ctx.timer = NULL;
+    }
+}
+
+void timer_jitter_get(timer_jitter_stats_t *stats)
+{
+    *stats = s_ctx.stats;
+}
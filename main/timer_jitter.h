@@ -0,0 +1,37 @@
+/*
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+/*
+  esp_timer task jitter probe.
+
+  A periodic esp_timer that measures how late each of its callbacks runs.
+  Anything that blocks the shared esp_timer task (e.g. an I2C transfer in
+  a timer callback) shows up as lateness here.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <esp_err.h>
+
+// callbacks later than this count as late
+#define TIMER_JITTER_LATE_US 500
+
+typedef struct {
+    uint32_t samples;
+    uint32_t late;
+    int64_t max_us;
+    int64_t total_us;
+} timer_jitter_stats_t;
+
+esp_err_t timer_jitter_start(uint32_t period_ms);
+
+void timer_jitter_stop(void);
+
+void timer_jitter_get(timer_jitter_stats_t *stats);